@@ -50,6 +50,12 @@
 //#include "dosbox.h"
 #include "dbopl.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DBOPL_SSE2
+#include <emmintrin.h>
+#include "SDL_cpuinfo.h"
+#endif
+
 #ifdef _MSC_VER
 #define inline __inline
 #endif
@@ -1267,7 +1273,331 @@ Bit32u Chip__WriteAddr(Chip *self, Bit32u port, Bit8u val ) {
   return 0;
 }
 
+#ifdef DBOPL_SSE2
+/*
+  SSE2 block renderer for the opl2 two operator channels
+
+  Up to four sm2FM/sm2AM channels run side by side, one per lane, through
+  the same integer steps as Channel__BlockTemplate and
+  Operator__TemplateVolume, so the output is bit-exact with the scalar
+  path. Only the wave and volume table lookups are done a lane at a time.
+*/
+
+#define LANES 4
+
+typedef union {
+  __m128i v;
+  Bit32s i[LANES];
+} Lanes;
+
+typedef struct {
+  __m128i waveIndex, waveCurrent, currentLevel;
+  __m128i volume, rateIndex, state;
+  __m128i attackAdd, decayAdd, releaseAdd, sustainLevel, sustainHold;
+  __m128i waveOffset, waveMask;
+  //Derived from state, only changes when a lane changes state
+  __m128i isOff, isAttack, isDecay, isRelease, envelope;
+  int moving, attacking;
+} OperatorLanes;
+
+typedef struct {
+  OperatorLanes op[2];
+  __m128i old0, old1;
+  //Bits of the feedback shift, feedbackBits has those used by any lane
+  __m128i feedback[5];
+  int feedbackBits;
+  //-1 for the AM channels
+  __m128i amMask;
+} ChannelLanes;
+
+static int dbopl_simd;
+
+//mask ? a : b
+static inline __m128i Lanes__Select( __m128i mask, __m128i a, __m128i b ) {
+  return _mm_or_si128( _mm_and_si128( mask, a ), _mm_andnot_si128( mask, b ) );
+}
+
+//Low 32 bits of the lane products, the same for signed and unsigned
+static inline __m128i Lanes__Mul( __m128i a, __m128i b ) {
+  __m128i even = _mm_mul_epu32( a, b );
+  __m128i odd = _mm_mul_epu32( _mm_srli_si128( a, 4 ), _mm_srli_si128( b, 4 ) );
+  return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+                             _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+static void OperatorLanes__UpdateState( OperatorLanes *self ) {
+  __m128i state = self->state;
+  __m128i isSustain = _mm_cmpeq_epi32( state, _mm_set1_epi32( SUSTAIN ) );
+  self->isOff = _mm_cmpeq_epi32( state, _mm_set1_epi32( OFF ) );
+  self->isAttack = _mm_cmpeq_epi32( state, _mm_set1_epi32( ATTACK ) );
+  self->isDecay = _mm_cmpeq_epi32( state, _mm_set1_epi32( DECAY ) );
+  //Sustain without the sustain bit set releases like release does
+  self->isRelease = _mm_or_si128( _mm_cmpeq_epi32( state, _mm_set1_epi32( RELEASE ) ),
+                                  _mm_andnot_si128( self->sustainHold, isSustain ) );
+  self->moving = _mm_movemask_epi8( _mm_or_si128( self->isAttack,
+                   _mm_or_si128( self->isDecay, self->isRelease ) ) );
+  self->attacking = _mm_movemask_epi8( self->isAttack );
+  self->envelope = Lanes__Select( self->isOff, _mm_set1_epi32( ENV_MAX ), self->volume );
+}
+
+static void ChannelLanes__Load( ChannelLanes *self, Channel **chan, int count ) {
+  Lanes reg[2][13], old0, old1, fb, am;
+  int l, o, b;
+
+  memset( reg, 0, sizeof( reg ) );
+  memset( &old0, 0, sizeof( old0 ) );
+  memset( &old1, 0, sizeof( old1 ) );
+  memset( &fb, 0, sizeof( fb ) );
+  memset( &am, 0, sizeof( am ) );
+  self->feedbackBits = 0;
+  //Unused lanes stay OFF with zero levels and never make a sound
+  for ( l = 0; l < count; l++ ) {
+    Channel *ch = chan[l];
+    for ( o = 0; o < 2; o++ ) {
+      Operator *op = &ch->op[o];
+      reg[o][0].i[l] = op->waveIndex;
+      reg[o][1].i[l] = op->waveCurrent;
+      reg[o][2].i[l] = op->currentLevel;
+      reg[o][3].i[l] = op->volume;
+      reg[o][4].i[l] = op->rateIndex;
+      reg[o][5].i[l] = op->state;
+      reg[o][6].i[l] = op->attackAdd;
+      reg[o][7].i[l] = op->decayAdd;
+      reg[o][8].i[l] = op->releaseAdd;
+      reg[o][9].i[l] = op->sustainLevel;
+      reg[o][10].i[l] = ( op->reg20 & MASK_SUSTAIN ) ? -1 : 0;
+      reg[o][11].i[l] = (Bit32s)( op->waveBase - WaveTable );
+      reg[o][12].i[l] = op->waveMask;
+    }
+    old0.i[l] = ch->old[0];
+    old1.i[l] = ch->old[1];
+    fb.i[l] = ch->feedback;
+    self->feedbackBits |= ch->feedback;
+    am.i[l] = ( ch->synthHandler == Channel__BlockTemplate_sm2AM ) ? -1 : 0;
+  }
+  for ( o = 0; o < 2; o++ ) {
+    OperatorLanes *op = &self->op[o];
+    op->waveIndex = reg[o][0].v;
+    op->waveCurrent = reg[o][1].v;
+    op->currentLevel = reg[o][2].v;
+    op->volume = reg[o][3].v;
+    op->rateIndex = reg[o][4].v;
+    op->state = reg[o][5].v;
+    op->attackAdd = reg[o][6].v;
+    op->decayAdd = reg[o][7].v;
+    op->releaseAdd = reg[o][8].v;
+    op->sustainLevel = reg[o][9].v;
+    op->sustainHold = reg[o][10].v;
+    op->waveOffset = reg[o][11].v;
+    op->waveMask = reg[o][12].v;
+    OperatorLanes__UpdateState( op );
+  }
+  self->old0 = old0.v;
+  self->old1 = old1.v;
+  for ( b = 0; b < 5; b++ ) {
+    __m128i bit = _mm_set1_epi32( 1 << b );
+    self->feedback[b] = _mm_cmpeq_epi32( _mm_and_si128( fb.v, bit ), bit );
+  }
+  self->amMask = am.v;
+}
+
+static void ChannelLanes__Store( const ChannelLanes *self, Channel **chan, int count ) {
+  Lanes reg[2][4], old0, old1;
+  int l, o;
+
+  for ( o = 0; o < 2; o++ ) {
+    reg[o][0].v = self->op[o].waveIndex;
+    reg[o][1].v = self->op[o].volume;
+    reg[o][2].v = self->op[o].rateIndex;
+    reg[o][3].v = self->op[o].state;
+  }
+  old0.v = self->old0;
+  old1.v = self->old1;
+  for ( l = 0; l < count; l++ ) {
+    Channel *ch = chan[l];
+    for ( o = 0; o < 2; o++ ) {
+      Operator *op = &ch->op[o];
+      op->waveIndex = reg[o][0].i[l];
+      op->volume = reg[o][1].i[l];
+      op->rateIndex = reg[o][2].i[l];
+      if ( op->state != reg[o][3].i[l] )
+        Operator__SetState( op, (Bit8u)reg[o][3].i[l] );
+    }
+    ch->old[0] = old0.i[l];
+    ch->old[1] = old1.i[l];
+  }
+}
+
+//Operator__TemplateVolume for every lane in whatever state it is in
+static inline __m128i OperatorLanes__Volume( OperatorLanes *self ) {
+  const __m128i envMax = _mm_set1_epi32( ENV_MAX );
+  __m128i vol = self->volume;
+  __m128i isMoving, add, rate, change, forwardVol, newVol;
+  __m128i toDecay, atSustain, toOff, toSustain, changed;
+
+  //Off and held sustain lanes don't change
+  if ( !self->moving )
+    return self->envelope;
+  isMoving = _mm_or_si128( self->isAttack, _mm_or_si128( self->isDecay, self->isRelease ) );
+  add = _mm_or_si128( _mm_and_si128( self->isAttack, self->attackAdd ),
+        _mm_or_si128( _mm_and_si128( self->isDecay, self->decayAdd ),
+                      _mm_and_si128( self->isRelease, self->releaseAdd ) ) );
+  rate = _mm_add_epi32( self->rateIndex, add );
+  change = _mm_srli_epi32( rate, RATE_SH );
+  rate = Lanes__Select( isMoving, _mm_and_si128( rate, _mm_set1_epi32( RATE_MASK ) ),
+                        self->rateIndex );
+
+  forwardVol = _mm_add_epi32( vol, change );
+  atSustain = _mm_andnot_si128( _mm_cmplt_epi32( forwardVol, self->sustainLevel ), self->isDecay );
+  toOff = _mm_andnot_si128( _mm_cmplt_epi32( forwardVol, envMax ),
+                            _mm_or_si128( atSustain, self->isRelease ) );
+  toSustain = _mm_andnot_si128( toOff, atSustain );
+  newVol = Lanes__Select( isMoving, Lanes__Select( toOff, envMax, forwardVol ), vol );
+  toDecay = _mm_setzero_si128();
+  if ( self->attacking ) {
+    __m128i attackVol = _mm_add_epi32( vol, _mm_srai_epi32(
+      Lanes__Mul( _mm_xor_si128( vol, _mm_set1_epi32( -1 ) ), change ), 3 ) );
+    toDecay = _mm_and_si128( self->isAttack, _mm_cmplt_epi32( attackVol, _mm_setzero_si128() ) );
+    newVol = Lanes__Select( self->isAttack, _mm_andnot_si128( toDecay, attackVol ), newVol );
+  }
+  self->volume = newVol;
+  changed = _mm_or_si128( toDecay, _mm_or_si128( toSustain, toOff ) );
+  if ( _mm_movemask_epi8( changed ) ) {
+    self->rateIndex = _mm_andnot_si128( _mm_or_si128( toDecay, toSustain ), rate );
+    self->state = Lanes__Select( toDecay, _mm_set1_epi32( DECAY ),
+                  Lanes__Select( toSustain, _mm_set1_epi32( SUSTAIN ),
+                  Lanes__Select( toOff, _mm_set1_epi32( OFF ), self->state ) ) );
+    OperatorLanes__UpdateState( self );
+  } else {
+    self->rateIndex = rate;
+    self->envelope = Lanes__Select( self->isOff, envMax, newVol );
+  }
+  return self->envelope;
+}
+
+//Operator__GetSample for every lane
+static inline __m128i OperatorLanes__GetSample( OperatorLanes *self, __m128i modulation ) {
+  __m128i vol = _mm_add_epi32( self->currentLevel, OperatorLanes__Volume( self ) );
+  __m128i live = _mm_cmplt_epi32( vol, _mm_set1_epi32( ENV_LIMIT ) );
+  __m128i index, wave, mul, out;
+
+  self->waveIndex = _mm_add_epi32( self->waveIndex, self->waveCurrent );
+  if ( !_mm_movemask_epi8( live ) )
+    return _mm_setzero_si128();
+  index = _mm_add_epi32( _mm_srli_epi32( self->waveIndex, WAVE_SH ), modulation );
+  index = _mm_add_epi32( _mm_and_si128( index, self->waveMask ), self->waveOffset );
+  //Both fit the low word of each lane, silent lanes get masked off below
+  vol = _mm_min_epi16( vol, _mm_set1_epi32( ENV_LIMIT - 1 ) );
+  wave = _mm_cvtsi32_si128( (Bit16u)WaveTable[ _mm_extract_epi16( index, 0 ) ] );
+  wave = _mm_insert_epi16( wave, WaveTable[ _mm_extract_epi16( index, 2 ) ], 2 );
+  wave = _mm_insert_epi16( wave, WaveTable[ _mm_extract_epi16( index, 4 ) ], 4 );
+  wave = _mm_insert_epi16( wave, WaveTable[ _mm_extract_epi16( index, 6 ) ], 6 );
+  mul = _mm_cvtsi32_si128( MulTable[ _mm_extract_epi16( vol, 0 ) >> ENV_EXTRA ] );
+  mul = _mm_insert_epi16( mul, MulTable[ _mm_extract_epi16( vol, 2 ) >> ENV_EXTRA ], 2 );
+  mul = _mm_insert_epi16( mul, MulTable[ _mm_extract_epi16( vol, 4 ) >> ENV_EXTRA ], 4 );
+  mul = _mm_insert_epi16( mul, MulTable[ _mm_extract_epi16( vol, 6 ) >> ENV_EXTRA ], 6 );
+  //(wave * mul) >> MUL_SH with an unsigned mul, the signed high word is
+  //short by wave when the top bit of mul is set
+  out = _mm_add_epi16( _mm_mulhi_epi16( wave, mul ),
+                       _mm_and_si128( _mm_srai_epi16( mul, 15 ), wave ) );
+  out = _mm_srai_epi32( _mm_slli_epi32( out, 16 ), 16 );
+  return _mm_and_si128( out, live );
+}
+
+static void ChannelLanes__Generate( Channel **chan, int count, Chip *chip,
+                                    Bit32u samples, Bit32s *output ) {
+  ChannelLanes lanes;
+  Bitu i;
+  int l;
+
+  //Init the operators with the the current vibrato and tremolo values
+  for ( l = 0; l < count; l++ ) {
+    Operator__Prepare( Channel__Op( chan[l], 0 ), chip );
+    Operator__Prepare( Channel__Op( chan[l], 1 ), chip );
+  }
+  ChannelLanes__Load( &lanes, chan, count );
+  for ( i = 0; i < samples; i++ ) {
+    __m128i mod, out0, sample;
+
+    //Unsigned shift of each lane by its own feedback, one bit at a time
+    mod = _mm_add_epi32( lanes.old0, lanes.old1 );
+    if ( lanes.feedbackBits & 1 )
+      mod = Lanes__Select( lanes.feedback[0], _mm_srli_epi32( mod, 1 ), mod );
+    if ( lanes.feedbackBits & 2 )
+      mod = Lanes__Select( lanes.feedback[1], _mm_srli_epi32( mod, 2 ), mod );
+    if ( lanes.feedbackBits & 4 )
+      mod = Lanes__Select( lanes.feedback[2], _mm_srli_epi32( mod, 4 ), mod );
+    if ( lanes.feedbackBits & 8 )
+      mod = Lanes__Select( lanes.feedback[3], _mm_srli_epi32( mod, 8 ), mod );
+    if ( lanes.feedbackBits & 16 )
+      mod = Lanes__Select( lanes.feedback[4], _mm_srli_epi32( mod, 16 ), mod );
+    lanes.old0 = lanes.old1;
+    lanes.old1 = OperatorLanes__GetSample( &lanes.op[0], mod );
+    out0 = lanes.old0;
+    sample = OperatorLanes__GetSample( &lanes.op[1], _mm_andnot_si128( lanes.amMask, out0 ) );
+    sample = _mm_add_epi32( sample, _mm_and_si128( lanes.amMask, out0 ) );
+    sample = _mm_add_epi32( sample, _mm_shuffle_epi32( sample, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    sample = _mm_add_epi32( sample, _mm_shuffle_epi32( sample, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    output[ i ] += _mm_cvtsi128_si32( sample );
+  }
+  ChannelLanes__Store( &lanes, chan, count );
+}
+
+static void Chip__GenerateBlock2SSE2(Chip *self, Bitu total, Bit32s* output ) {
+  while ( total > 0 ) {
+    Channel *ch, *batch[LANES];
+    int count = 0;
+
+    Bit32u samples = Chip__ForwardLFO( self, total );
+    memset(output, 0, sizeof(Bit32s) * samples);
+    for ( ch = self->chan; ch < self->chan + 9; ) {
+      if ( ch->synthHandler == Channel__BlockTemplate_sm2FM
+        || ch->synthHandler == Channel__BlockTemplate_sm2AM ) {
+        //Same early out as the block template
+        if ( Operator__Silent( Channel__Op( ch, 1 ) )
+          && ( ch->synthHandler == Channel__BlockTemplate_sm2FM
+            || Operator__Silent( Channel__Op( ch, 0 ) ) ) ) {
+          ch->old[0] = ch->old[1] = 0;
+        } else {
+          batch[count++] = ch;
+          if ( count == LANES ) {
+            ChannelLanes__Generate( batch, count, self, samples, output );
+            count = 0;
+          }
+        }
+        ch++;
+      } else {
+        //Percussion keeps the scalar path
+        ch = (ch->synthHandler)( ch, self, samples, output );
+      }
+    }
+    //A lone channel is cheaper on the scalar path
+    if ( count == 1 )
+      (batch[0]->synthHandler)( batch[0], self, samples, output );
+    else if ( count )
+      ChannelLanes__Generate( batch, count, self, samples, output );
+    total -= samples;
+    output += samples;
+  }
+}
+#endif
+
+int DBOPL_SetSIMD( int enable ) {
+#ifdef DBOPL_SSE2
+  dbopl_simd = enable && SDL_HasSSE2();
+  return dbopl_simd;
+#else
+  return 0;
+#endif
+}
+
 void Chip__GenerateBlock2(Chip *self, Bitu total, Bit32s* output ) {
+#ifdef DBOPL_SSE2
+  if ( dbopl_simd ) {
+    Chip__GenerateBlock2SSE2( self, total, output );
+    return;
+  }
+#endif
   while ( total > 0 ) {
                 Channel *ch;
     int count;
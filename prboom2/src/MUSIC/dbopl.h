@@ -207,12 +207,15 @@ extern "C" void DBOPL_InitTables( void );
 extern "C" void Chip__Chip(Chip *self);
 extern "C" void Chip__WriteReg(Chip *self, Bit32u reg, Bit8u val );
 extern "C" void Chip__GenerateBlock2(Chip *self, Bitu total, Bit32s* output );
+extern "C" int DBOPL_SetSIMD( int enable );
 #else
 void Chip__Setup(Chip *self, Bit32u rate );
 void DBOPL_InitTables( void );
 void Chip__Chip(Chip *self);
 void Chip__WriteReg(Chip *self, Bit32u reg, Bit8u val );
 void Chip__GenerateBlock2(Chip *self, Bitu total, Bit32s* output );
+//Use the SSE2 renderer when the cpu has it, returns whether it is in use
+int DBOPL_SetSIMD( int enable );
 
 #endif
 
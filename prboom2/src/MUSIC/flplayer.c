@@ -87,6 +87,8 @@ static int f_volume;
 static double spmc;
 static double f_delta;
 static int f_soundrate;
+static unsigned f_rendered; // frames since fl_play
+static int f_songend = -1;
 
 #define SYSEX_BUFF_SIZE 1024
 static unsigned char sysexbuff[SYSEX_BUFF_SIZE];
@@ -290,6 +292,8 @@ static void fl_play (const void *handle, int looping)
   f_playing = 1;
   //f_paused = 0;
   f_delta = 0.0;
+  f_rendered = 0;
+  f_songend = -1;
   fluid_synth_program_reset (f_syn);
   fluid_synth_system_reset (f_syn);
 }
@@ -375,9 +379,12 @@ static void fl_render (void *vdest, unsigned length)
   
   unsigned sampleswritten = 0;
   unsigned samples;
+  unsigned rendered = f_rendered;
 
   midi_event_t *currevent;
 
+  f_rendered += length;
+
   if (!f_playing || f_paused)
   { 
     // save CPU time and allow for seamless resume after pause
@@ -447,6 +454,7 @@ static void fl_render (void *vdest, unsigned length)
           spmc = MIDI_spmc (midifile, currevent, f_soundrate);
         else if (currevent->data.meta.type == MIDI_META_END_OF_TRACK)
         {
+          f_songend = rendered + sampleswritten;
           if (f_looping)
           {
             int i;
@@ -508,6 +516,11 @@ static void fl_render (void *vdest, unsigned length)
 
 }  
 
+static int fl_songend (void)
+{
+  return f_songend;
+}
+
 
 const music_player_t fl_player =
 {
@@ -521,7 +534,8 @@ const music_player_t fl_player =
   fl_unregistersong,
   fl_play,
   fl_stop,
-  fl_render
+  fl_render,
+  fl_songend
 };
 
 
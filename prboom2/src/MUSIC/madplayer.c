@@ -91,6 +91,17 @@ static int mp_playing = 0;
 static const void *mp_data;
 static int mp_len;
 
+// streamed songs are decoded from mp_input, topped up from mp_stream as
+// mad uses it.  mp_start is where the audio begins, past any ID3v2 tag.
+#define MP_INPUT_SIZE (32 * 1024)
+// kept in memory from mp_start, so a rewind plays on without a gap while
+// the reader catches up behind it
+#define MP_STREAM_PIN (128 * 1024)
+static music_stream_t *mp_stream;
+static size_t mp_start;
+static unsigned char mp_input[MP_INPUT_SIZE + MAD_BUFFER_GUARD];
+static int mp_input_end;
+
 
 static int mp_leftoversamps = 0; // number of extra samples
                                  // left over in mad decoder
@@ -122,7 +133,7 @@ static void mp_shutdown (void)
   mad_header_finish (&Header);
 }
 
-static const void *mp_registersong (const void *data, unsigned len)
+static int mp_probe (const void *data, unsigned len)
 {
   int i;
   int maxtry;
@@ -151,7 +162,7 @@ static const void *mp_registersong (const void *data, unsigned len)
       if (!MAD_RECOVERABLE (Stream.error))
       {
         lprintf (LO_WARN, "mad_registersong failed: %s\n", mad_stream_errorstr (&Stream));
-        return NULL;
+        return 0;
       }  
     }
     else
@@ -164,17 +175,55 @@ static const void *mp_registersong (const void *data, unsigned len)
   if (success < maxtry * 8 / 10)
   {
     lprintf (LO_WARN, "mad_registersong failed\n");
-    return NULL;
+    return 0;
   }
   
   lprintf (LO_INFO, "mad_registersong succeed. bitrate %lu samplerate %d\n", Header.bitrate, Header.samplerate);
- 
+  return 1;
+}
+
+static const void *mp_registersong (const void *data, unsigned len)
+{
+  if (!mp_probe (data, len))
+    return NULL;
+
   mp_data = data;
   mp_len = len;
+  mp_stream = NULL;
   // handle not used
   return data;
 }
 
+static const void *mp_registerstream (music_stream_t *stream)
+{
+  unsigned char id3[10];
+  size_t len;
+
+  // the first frames are all mp_probe needs, but they may come after
+  // an ID3v2 tag with pictures in it larger than that
+  mp_start = 0;
+  mstream_seek (stream, 0);
+  if (mstream_read (stream, id3, 10) == 10 && memcmp (id3, "ID3", 3) == 0)
+  {
+    mp_start = 10 + ((id3[6] & 0x7f) << 21 | (id3[7] & 0x7f) << 14 |
+                     (id3[8] & 0x7f) << 7 | (id3[9] & 0x7f));
+    if (id3[5] & 0x10) // footer
+      mp_start += 10;
+  }
+  if (mstream_seek (stream, mp_start) != 0)
+    return NULL;
+  len = mstream_read (stream, mp_input, MP_INPUT_SIZE);
+  if (!len || !mp_probe (mp_input, len))
+    return NULL;
+  if (mstream_pin (stream, mp_start, MP_STREAM_PIN) != 0)
+    lprintf (LO_WARN, "mp_registerstream: couldn't keep the song start in memory\n");
+
+  mp_data = NULL;
+  mp_len = 0;
+  mp_stream = stream;
+  return stream;
+}
+
 static void mp_setvolume (int v)
 {
   mp_volume = v;
@@ -193,12 +242,51 @@ static void mp_resume (void)
 static void mp_unregistersong (const void *handle)
 { // nothing to do
   mp_data = NULL;
+  mp_stream = NULL;
   mp_playing = 0;
 }
 
+// moves what mad has not decoded yet to the front of mp_input and tops it
+// up from the stream.  at the end of the stream MAD_BUFFER_GUARD zeros go
+// after the data so the last frame decodes; returns 0 after that.
+static int mp_refill (void)
+{
+  size_t rest = 0, got;
+
+  if (mp_input_end)
+    return 0;
+  if (Stream.next_frame)
+  {
+    rest = Stream.bufend - Stream.next_frame;
+    memmove (mp_input, Stream.next_frame, rest);
+  }
+  got = mstream_read (mp_stream, mp_input + rest, MP_INPUT_SIZE - rest);
+  if (!got)
+  {
+    memset (mp_input + rest, 0, MAD_BUFFER_GUARD);
+    got = MAD_BUFFER_GUARD;
+    mp_input_end = 1;
+  }
+  mad_stream_buffer (&Stream, mp_input, rest + got);
+  return 1;
+}
+
+static void mp_rewind (void)
+{
+  if (mp_stream)
+  {
+    mstream_seek (mp_stream, mp_start);
+    mp_input_end = 0;
+    // empty, so the first decode asks for mp_refill
+    mad_stream_buffer (&Stream, mp_input, 0);
+  }
+  else
+    mad_stream_buffer (&Stream, (const unsigned char *)mp_data, mp_len);
+}
+
 static void mp_play (const void *handle, int looping)
 {
-  mad_stream_buffer (&Stream, (const unsigned char *)mp_data, mp_len);
+  mp_rewind ();
 
   mp_playing = 1;
   mp_looping = looping;
@@ -277,13 +365,21 @@ static void mp_render_ex (void *dest, unsigned nsamp)
         }
       }  
       else if (Stream.error == MAD_ERROR_BUFLEN)
-      { // EOF
+      { // end of what mad was given
+        if (mp_stream && !mstream_ready (mp_stream, MP_INPUT_SIZE))
+        { // the reader is behind; don't stall the mixer on the disk
+          memset (sout, 0, nsamp * 4);
+          return;
+        }
+        if (mp_stream && mp_refill ())
+          continue;
+        // EOF
         // FIXME: in order to not drop the last frame, there must be at least MAD_BUFFER_GUARD
         // of extra bytes (with value 0) at the end of the file.  current implementation
-        // drops last frame
+        // drops last frame of songs held in memory
         if (mp_looping)
         { // rewind, then go again
-          mad_stream_buffer (&Stream, (const unsigned char *)mp_data, mp_len);
+          mp_rewind ();
           continue;
         }
         else
@@ -329,7 +425,9 @@ const music_player_t mp_player =
   mp_unregistersong,
   mp_play,
   mp_stop,
-  mp_render
+  mp_render,
+  NULL,
+  mp_registerstream
 };
 
 #endif // HAVE_LIBMAD
@@ -32,6 +32,8 @@
 #ifndef MUSICPLAYER_H
 #define MUSICPLAYER_H
 
+#include "musicstream.h"
+
 /*
 Anything that implements all of these functions can play music in prboomplus.
 
@@ -82,6 +84,17 @@ typedef struct
   // s16 stereo, with samplerate as specified in init.  player needs to be able to handle
   // just about anything for nsamp.  render can be called even during pause+stop.
   void (*render)(void *dest, unsigned nsamp);
+
+  // optional, may be left out: frames rendered since play up to where the song
+  // last reached its end, -1 if it has not yet.  only for players whose output
+  // depends on nothing but the song and their settings; i_sound.c may render
+  // their songs ahead and keep the result (mus_render_cache).
+  int (*songend)(void);
+
+  // optional, may be left out: like registersong, but the song is decoded
+  // from stream as it plays instead of from memory.  the stream belongs to
+  // i_sound.c and stays open until unregistersong is called.
+  const void *(*registerstream)(music_stream_t *stream);
 } music_player_t;
 
 
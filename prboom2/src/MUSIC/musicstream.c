@@ -0,0 +1,343 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Music files read ahead on a thread while they play
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_thread.h"
+#include "SDL_mutex.h"
+
+#include "doomtype.h"
+#include "lprintf.h"
+#include "musicstream.h"
+
+// the reader keeps up to MSTREAM_AHEAD bytes past the read position in
+// memory, and reads MSTREAM_CHUNK at a time once there is room for it
+#define MSTREAM_AHEAD (512 * 1024)
+#define MSTREAM_CHUNK (64 * 1024)
+
+struct music_stream_s
+{
+  FILE *file;
+  char *name;
+  size_t length;
+
+  // ring buffer of size bytes holding the file from pos up to end, or
+  // from the end of the pinned range up to end while pos is inside it
+  unsigned char *buffer;
+  size_t size;
+  size_t pos, end;
+
+  // pinlen bytes of the file from pinpos, read by mstream_pin
+  unsigned char *pin;
+  size_t pinpos, pinlen;
+
+  // bumped by seeks that drop the buffer, so the reader throws away what
+  // it was reading for the old position
+  unsigned int generation;
+  int error;
+  int quit;
+
+  SDL_mutex *mutex;
+  SDL_cond *cond;
+  SDL_Thread *thread;
+
+  unsigned int reads, waits, seeks, underruns;
+  Uint64 waited;
+};
+
+static int mstream_inpin (const music_stream_t *stream, size_t pos)
+{
+  return pos >= stream->pinpos && pos < stream->pinpos + stream->pinlen;
+}
+
+// where the data in the ring starts
+static size_t mstream_ringpos (const music_stream_t *stream)
+{
+  if (mstream_inpin (stream, stream->pos))
+    return stream->pinpos + stream->pinlen;
+  return stream->pos;
+}
+
+// empties the ring and has the reader start over at end
+static void mstream_drop (music_stream_t *stream, size_t end)
+{
+  stream->generation++;
+  stream->end = end;
+  stream->error = 0;
+}
+
+static int SDLCALL mstream_reader (void *data)
+{
+  music_stream_t *stream = (music_stream_t *) data;
+  size_t filepos = 0;
+
+  SDL_LockMutex (stream->mutex);
+  while (!stream->quit)
+  {
+    size_t from = stream->end;
+    size_t want = MIN(MSTREAM_CHUNK, stream->length - from);
+    size_t room = stream->size - (from - mstream_ringpos (stream));
+    unsigned int generation = stream->generation;
+    size_t size, got = 0;
+
+    if (stream->error || !want || room < want)
+    {
+      SDL_CondWait (stream->cond, stream->mutex);
+      continue;
+    }
+    // one read never wraps around the end of the ring
+    size = MIN(want, stream->size - from % stream->size);
+    SDL_UnlockMutex (stream->mutex);
+
+    if (filepos == from || !fseek (stream->file, (long) from, SEEK_SET))
+      got = fread (stream->buffer + from % stream->size, 1, size, stream->file);
+    filepos = from + got;
+
+    SDL_LockMutex (stream->mutex);
+    stream->reads++;
+    if (generation == stream->generation)
+    {
+      if (got)
+        stream->end += got;
+      else
+        stream->error = 1;
+      SDL_CondBroadcast (stream->cond);
+    }
+  }
+  SDL_UnlockMutex (stream->mutex);
+  return 0;
+}
+
+music_stream_t *mstream_open (const char *filename)
+{
+  music_stream_t *stream;
+  FILE *file;
+  long length;
+
+  if (!(file = fopen (filename, "rb")))
+    return NULL;
+  if (fseek (file, 0, SEEK_END) || (length = ftell (file)) <= 0 ||
+      fseek (file, 0, SEEK_SET))
+  {
+    fclose (file);
+    return NULL;
+  }
+
+  stream = (music_stream_t *) calloc (1, sizeof (*stream));
+  stream->file = file;
+  stream->name = strdup (filename);
+  stream->length = length;
+  stream->size = MIN(MSTREAM_AHEAD, stream->length);
+  stream->buffer = (unsigned char *) malloc (stream->size);
+  stream->mutex = SDL_CreateMutex ();
+  stream->cond = SDL_CreateCond ();
+  stream->thread = SDL_CreateThread (mstream_reader, "mstream_reader", stream);
+  if (!stream->thread)
+  {
+    lprintf (LO_WARN, "mstream_open: Couldn't start reader thread: %s\n", SDL_GetError ());
+    mstream_close (stream);
+    return NULL;
+  }
+  return stream;
+}
+
+void mstream_close (music_stream_t *stream)
+{
+  if (stream->thread)
+  {
+    SDL_LockMutex (stream->mutex);
+    stream->quit = 1;
+    SDL_CondBroadcast (stream->cond);
+    SDL_UnlockMutex (stream->mutex);
+    SDL_WaitThread (stream->thread, NULL);
+
+    lprintf (LO_INFO, "mstream_close: %s: %u reads, %u seeks, %u underruns, waited on the disk %u times for %.1f ms\n",
+             stream->name, stream->reads, stream->seeks, stream->underruns, stream->waits,
+             stream->waited * 1000.0 / SDL_GetPerformanceFrequency ());
+  }
+  SDL_DestroyCond (stream->cond);
+  SDL_DestroyMutex (stream->mutex);
+  fclose (stream->file);
+  free (stream->buffer);
+  free (stream->pin);
+  free (stream->name);
+  free (stream);
+}
+
+size_t mstream_read (music_stream_t *stream, void *dest, size_t len)
+{
+  unsigned char *out = (unsigned char *) dest;
+  size_t done = 0;
+  Uint64 start = 0;
+
+  SDL_LockMutex (stream->mutex);
+  while (done < len && stream->pos < stream->length)
+  {
+    size_t from, n;
+
+    if (mstream_inpin (stream, stream->pos))
+    {
+      size_t pinend = stream->pinpos + stream->pinlen;
+
+      // read on into the pin: the ring goes on from its end
+      if (stream->end < pinend)
+        mstream_drop (stream, pinend);
+      n = MIN(len - done, pinend - stream->pos);
+      memcpy (out + done, stream->pin + (stream->pos - stream->pinpos), n);
+      stream->pos += n;
+      done += n;
+      continue;
+    }
+
+    from = stream->pos % stream->size;
+    n = MIN(len - done, stream->end - stream->pos);
+
+    if (!n)
+    {
+      // a short read is fine for the decoders, none would end the song
+      if (stream->error || done)
+        break;
+      if (!start)
+      {
+        start = SDL_GetPerformanceCounter ();
+        stream->waits++;
+      }
+      SDL_CondWait (stream->cond, stream->mutex);
+      continue;
+    }
+    n = MIN(n, stream->size - from);
+    memcpy (out + done, stream->buffer + from, n);
+    stream->pos += n;
+    done += n;
+  }
+  if (start)
+    stream->waited += SDL_GetPerformanceCounter () - start;
+  // there is room for the reader now
+  SDL_CondBroadcast (stream->cond);
+  SDL_UnlockMutex (stream->mutex);
+  return done;
+}
+
+int mstream_ready (music_stream_t *stream, size_t len)
+{
+  size_t end;
+  int ready;
+
+  SDL_LockMutex (stream->mutex);
+  end = stream->end;
+  if (mstream_inpin (stream, stream->pos))
+    end = MAX(end, stream->pinpos + stream->pinlen);
+  ready = stream->error ||
+    end - stream->pos >= MIN(len, stream->length - stream->pos);
+  if (!ready)
+    stream->underruns++;
+  SDL_UnlockMutex (stream->mutex);
+  return ready;
+}
+
+int mstream_seek (music_stream_t *stream, size_t pos)
+{
+  size_t from;
+
+  if (pos > stream->length)
+    return -1;
+
+  SDL_LockMutex (stream->mutex);
+  // what the ring has to hold from for pos
+  from = mstream_inpin (stream, pos) ? stream->pinpos + stream->pinlen : pos;
+  if (from < mstream_ringpos (stream) || from > stream->end)
+  {
+    mstream_drop (stream, from);
+    stream->seeks++;
+  }
+  stream->pos = pos;
+  SDL_CondBroadcast (stream->cond);
+  SDL_UnlockMutex (stream->mutex);
+  return 0;
+}
+
+int mstream_pin (music_stream_t *stream, size_t pos, size_t len)
+{
+  unsigned char *pin;
+  FILE *file;
+
+  if (pos >= stream->length)
+    return -1;
+  len = MIN(len, stream->length - pos);
+
+  // the reader thread owns stream->file
+  if (!(file = fopen (stream->name, "rb")))
+    return -1;
+  pin = (unsigned char *) malloc (len);
+  if (fseek (file, (long) pos, SEEK_SET) || fread (pin, len, 1, file) != 1)
+  {
+    fclose (file);
+    free (pin);
+    return -1;
+  }
+  fclose (file);
+
+  SDL_LockMutex (stream->mutex);
+  free (stream->pin);
+  stream->pin = pin;
+  stream->pinpos = pos;
+  stream->pinlen = len;
+  if (mstream_inpin (stream, stream->pos) && stream->end < pos + len)
+    mstream_drop (stream, pos + len);
+  SDL_CondBroadcast (stream->cond);
+  SDL_UnlockMutex (stream->mutex);
+  return 0;
+}
+
+size_t mstream_tell (const music_stream_t *stream)
+{
+  return stream->pos;
+}
+
+size_t mstream_length (const music_stream_t *stream)
+{
+  return stream->length;
+}
+
+size_t mstream_memory (const music_stream_t *stream)
+{
+  return sizeof (*stream) + stream->size + stream->pinlen;
+}
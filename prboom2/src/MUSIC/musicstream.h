@@ -0,0 +1,74 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Music files read ahead on a thread while they play
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifndef MUSICSTREAM_H
+#define MUSICSTREAM_H
+
+#include <stddef.h>
+
+// A file the music players decode from as they go, instead of from a copy
+// of all of it in memory. A reader thread keeps the next part of the file
+// buffered so the player rarely waits on the disk.
+typedef struct music_stream_s music_stream_t;
+
+// NULL if the file can't be opened
+music_stream_t *mstream_open (const char *filename);
+void mstream_close (music_stream_t *stream);
+
+// reads up to len bytes from the current position.  waits for the
+// reader thread only if nothing is buffered, otherwise returns what is.
+// returns 0 at the end of the file.
+size_t mstream_read (music_stream_t *stream, void *dest, size_t len);
+
+// nonzero if the next len bytes (or the rest of the file) are buffered,
+// so reading them won't wait on the disk.  players rendering from the
+// audio callback check this first and play silence while it is zero.
+int mstream_ready (music_stream_t *stream, size_t len);
+
+// 0 on success, -1 if pos is past the end
+int mstream_seek (music_stream_t *stream, size_t pos);
+
+// keeps len bytes from pos in memory for as long as the stream is open,
+// read now on the calling thread, so seeking back to where a song loops
+// never waits on the disk.  a stream has one pinned range; pinning again
+// replaces it.  0 on success, -1 if it can't be read
+int mstream_pin (music_stream_t *stream, size_t pos, size_t len);
+
+size_t mstream_tell (const music_stream_t *stream);
+size_t mstream_length (const music_stream_t *stream);
+
+// bytes the stream holds in memory
+size_t mstream_memory (const music_stream_t *stream);
+
+#endif // MUSICSTREAM_H
@@ -114,7 +114,7 @@ int OPL_Init (unsigned int rate)
     DBOPL_InitTables();
     Chip__Chip(&opl_chip);
     Chip__Setup(&opl_chip, opl_sample_rate);
-
+    DBOPL_SetSIMD(1);
 
     OPL_InitRegisters();
 
@@ -319,6 +319,16 @@ void OPL_Render_Samples (void *dest, unsigned buffer_len)
     }
 }
 
+unsigned int OPL_CurrentTime(void)
+{
+    return current_time;
+}
+
+int OPL_SetSIMD(int enable)
+{
+    return DBOPL_SetSIMD(enable);
+}
+
 void OPL_WritePort(opl_port_t port, unsigned int value)
 {
     if (port == OPL_REGISTER_PORT)
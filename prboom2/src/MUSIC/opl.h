@@ -114,6 +114,15 @@ extern unsigned int opl_sample_rate;
 
 void OPL_Render_Samples (void *dest, unsigned nsamp);
 
+// Samples rendered since OPL_Init.
+
+unsigned int OPL_CurrentTime(void);
+
+// Use the SIMD chip emulation where the CPU has it; returns whether it
+// is in use. Both give the same samples.
+
+int OPL_SetSIMD(int enable);
+
 
 void OPL_SetCallback(unsigned int ms, opl_callback_t callback, void *data);
 
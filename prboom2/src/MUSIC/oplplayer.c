@@ -329,6 +329,11 @@ static unsigned int num_tracks = 0;
 static unsigned int running_tracks = 0;
 static dboolean song_looping;
 
+// OPL time the song started at, and samples from there to its last end
+
+static unsigned int song_start;
+static int song_end = -1;
+
 // Configuration file variable, containing the port number for the
 // adlib chip.
 
@@ -1141,6 +1146,11 @@ static void TrackTimerCallback(void *arg)
     {
         --running_tracks;
 
+        if (running_tracks <= 0)
+        {
+            song_end = OPL_CurrentTime() - song_start;
+        }
+
         // When all tracks have finished, restart the song.
 
         if (running_tracks <= 0 && song_looping)
@@ -1232,6 +1242,8 @@ static void I_OPL_PlaySong(const void *handle, int looping)
     num_tracks = MIDI_NumTracks(file);
     running_tracks = num_tracks;
     song_looping = looping;
+    song_start = OPL_CurrentTime();
+    song_end = -1;
 
     for (i=0; i<num_tracks; ++i)
     {
@@ -1428,6 +1440,14 @@ void I_OPL_RenderSamples (void *dest, unsigned nsamp)
     OPL_Render_Samples (dest, nsamp);
 }
 
+// The callbacks run once the samples before them are rendered, so the
+// OPL clock at the last end of track is where the song ended.
+
+static int I_OPL_SongEnd (void)
+{
+    return song_end;
+}
+
 const music_player_t opl_synth_player =
 {
   I_OPL_SynthName,
@@ -1440,7 +1460,8 @@ const music_player_t opl_synth_player =
   I_OPL_UnRegisterSong,
   I_OPL_PlaySong,
   I_OPL_StopSong,
-  I_OPL_RenderSamples
+  I_OPL_RenderSamples,
+  I_OPL_SongEnd
 };
 
 
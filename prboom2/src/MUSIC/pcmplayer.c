@@ -0,0 +1,167 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Plays music that has been rendered ahead to PCM
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "doomtype.h"
+#include "pcmplayer.h"
+
+static const pcm_song_t *pcm_song;
+static unsigned int pcm_pos;
+static int pcm_playing;
+static int pcm_paused;
+static int pcm_looping;
+static int pcm_volume;
+
+static const char *pcm_name (void)
+{
+  return "pre-rendered music player";
+}
+
+static int pcm_init (int samplerate)
+{
+  return 1;
+}
+
+static void pcm_shutdown (void)
+{
+}
+
+static void pcm_setvolume (int v)
+{
+  pcm_volume = v;
+}
+
+static void pcm_pause (void)
+{
+  pcm_paused = 1;
+}
+
+static void pcm_resume (void)
+{
+  pcm_paused = 0;
+}
+
+static const void *pcm_registersong (const void *data, unsigned len)
+{
+  const pcm_song_t *song = (const pcm_song_t *) data;
+
+  if (len != sizeof (pcm_song_t) || !song->songend ||
+      song->songend > song->length || song->loopstart >= song->length)
+    return NULL;
+  return song;
+}
+
+static void pcm_unregistersong (const void *handle)
+{
+  pcm_song = NULL;
+  pcm_playing = 0;
+}
+
+static void pcm_play (const void *handle, int looping)
+{
+  pcm_song = (const pcm_song_t *) handle;
+  pcm_pos = 0;
+  pcm_looping = looping;
+  pcm_playing = 1;
+}
+
+static void pcm_stop (void)
+{
+  pcm_playing = 0;
+}
+
+static void pcm_render (void *vdest, unsigned length)
+{
+  short *dest = (short *) vdest;
+
+  while (length)
+  {
+    unsigned int end, n, i;
+    const short *src;
+
+    if (!pcm_playing || pcm_paused || !pcm_song)
+    {
+      memset (dest, 0, length * 4);
+      return;
+    }
+
+    // the data past songend continues the song into its next pass
+    end = pcm_looping ? pcm_song->length : pcm_song->songend;
+    if (pcm_pos >= end)
+    {
+      if (pcm_looping)
+        pcm_pos = pcm_song->loopstart;
+      else
+        pcm_playing = 0;
+      continue;
+    }
+
+    n = MIN (length, end - pcm_pos);
+    src = pcm_song->data + pcm_pos * 2;
+
+    if (pcm_volume == pcm_song->volume)
+      memcpy (dest, src, n * 4);
+    else
+    {
+      for (i = 0; i < n * 2; i++)
+      {
+        int s = src[i] * pcm_volume / pcm_song->volume;
+        dest[i] = (short) BETWEEN (-32768, 32767, s);
+      }
+    }
+
+    pcm_pos += n;
+    dest += n * 2;
+    length -= n;
+  }
+}
+
+const music_player_t pcm_player =
+{
+  pcm_name,
+  pcm_init,
+  pcm_shutdown,
+  pcm_setvolume,
+  pcm_pause,
+  pcm_resume,
+  pcm_registersong,
+  pcm_unregistersong,
+  pcm_play,
+  pcm_stop,
+  pcm_render
+};
@@ -0,0 +1,53 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Plays music that has been rendered ahead to PCM
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifndef PCMPLAYER_H
+#define PCMPLAYER_H
+
+#include "musicplayer.h"
+
+// registersong takes one of these, with len = sizeof (pcm_song_t).
+// it stays with the caller, who frees it after unregistersong.
+typedef struct
+{
+  short *data;            // s16 stereo frames
+  unsigned int length;    // frames in data
+  unsigned int songend;   // where a song that does not loop stops
+  unsigned int loopstart; // where a looping song goes on from at length
+  int volume;             // music volume it was rendered at
+} pcm_song_t;
+
+extern const music_player_t pcm_player;
+
+#endif // PCMPLAYER_H
@@ -92,11 +92,23 @@ static int vorb_playing = 0;
 static unsigned vorb_loop_from;
 static unsigned vorb_loop_to;
 static unsigned vorb_total_pos;
+// streamed songs loop with a raw seek to vorb_loop_raw, which is pinned,
+// then decode vorb_loop_skip samples up to vorb_loop_to; a pcm seek would
+// bisect all over the file from the audio callback
+static size_t vorb_loop_raw;
+static unsigned vorb_loop_skip;
 #endif // ZDOOM_AUDIO_LOOP
 
 static const char *vorb_data;
 static size_t vorb_len;
 static size_t vorb_pos;
+// set instead of vorb_data for streamed songs
+static music_stream_t *vorb_stream;
+// buffered bytes that cover one ov_read_float
+#define VORB_STREAM_READY (16 * 1024)
+// kept in memory where the song loops to: the headers and pages the seek
+// reads, and seconds of play while the reader catches up behind it
+#define VORB_STREAM_PIN (128 * 1024)
 
 OggVorbis_File vf;
 
@@ -106,6 +118,9 @@ static size_t vread (void *dst, size_t s, size_t n, void *src)
 {
   size_t size = s * n;
 
+  if (vorb_stream)
+    return mstream_read (vorb_stream, dst, size);
+
   if (vorb_pos + size >= vorb_len)
     size = vorb_len - vorb_pos;
 
@@ -117,6 +132,8 @@ static size_t vread (void *dst, size_t s, size_t n, void *src)
 static int vseek (void *src, ogg_int64_t offset, int whence)
 {
   size_t desired_pos;
+  size_t pos = vorb_stream ? mstream_tell (vorb_stream) : vorb_pos;
+  size_t len = vorb_stream ? mstream_length (vorb_stream) : vorb_len;
 
   switch (whence)
   {
@@ -124,15 +141,17 @@ static int vseek (void *src, ogg_int64_t offset, int whence)
       desired_pos = (size_t) offset;
       break;
     case SEEK_CUR:
-      desired_pos = vorb_pos + (size_t) offset;
+      desired_pos = pos + (size_t) offset;
       break;
     case SEEK_END:
     default:
-      desired_pos = vorb_len + (size_t) offset;
+      desired_pos = len + (size_t) offset;
       break;
   }
-  if (desired_pos > vorb_len) // placing exactly at the end is allowed)
+  if (desired_pos > len) // placing exactly at the end is allowed)
     return -1;
+  if (vorb_stream)
+    return mstream_seek (vorb_stream, desired_pos);
   vorb_pos = desired_pos;
   return 0;
 }
@@ -140,6 +159,8 @@ static int vseek (void *src, ogg_int64_t offset, int whence)
 static long vtell (void *src)
 {
   // correct to vorbisfile spec, this is a long, not 64 bit 
+  if (vorb_stream)
+    return (long) mstream_tell (vorb_stream);
   return (long) vorb_pos;
 }
 
@@ -247,7 +268,8 @@ static void vorb_shutdown (void)
 
 }
 
-static const void *vorb_registersong (const void *data, unsigned len)
+// opens vf on vorb_data or vorb_stream; returns 1 on success
+static int vorb_open (void)
 {
   int i;
   vorbis_info *vinfo;
@@ -255,16 +277,14 @@ static const void *vorb_registersong (const void *data, unsigned len)
   vorbis_comment *vcom;
   #endif // ZDOOM_AUDIO_LOOP
 
-  vorb_data = (const char*)data;
-  vorb_len = len;
-  vorb_pos = 0;
-
-  i = ov_test_callbacks ((void *) data, &vf, NULL, 0, vcallback);
+  // the callbacks don't use it, but vorbisfile takes NULL as unseekable
+  i = ov_test_callbacks (vorb_stream ? (void *) vorb_stream : (void *) vorb_data,
+                         &vf, NULL, 0, vcallback);
 
   if (i != 0)
   {
     lprintf (LO_WARN, "vorb_registersong: failed\n");
-    return NULL;
+    return 0;
   }
   i = ov_test_open (&vf);
   
@@ -272,7 +292,7 @@ static const void *vorb_registersong (const void *data, unsigned len)
   {
     lprintf (LO_WARN, "vorb_registersong: failed\n");
     ov_clear (&vf);
-    return NULL;
+    return 0;
   }
   
   vinfo = ov_info (&vf, -1);
@@ -297,10 +317,72 @@ static const void *vorb_registersong (const void *data, unsigned len)
     vorb_loop_to = 0;
   #endif // ZDOOM_AUDIO_LOOP
 
+  return 1;
+}
+
+static const void *vorb_registersong (const void *data, unsigned len)
+{
+  vorb_data = (const char*)data;
+  vorb_len = len;
+  vorb_pos = 0;
+  vorb_stream = NULL;
+
+  if (!vorb_open ())
+    return NULL;
   // handle not used
   return data;
 }
 
+#ifdef ZDOOM_AUDIO_LOOP
+// finds a raw position whose page starts at or before vorb_loop_to, by
+// backing off from where a pcm seek to it left the file
+static size_t vorb_findloop (void)
+{
+  ogg_int64_t raw;
+
+  if (!vorb_loop_to)
+    return 0;
+  if (ov_pcm_seek (&vf, vorb_loop_to) != 0)
+  {
+    lprintf (LO_WARN, "vorb_registerstream: can't seek to LOOP_START, looping to the start\n");
+    vorb_loop_to = 0;
+    return 0;
+  }
+
+  raw = ov_raw_tell (&vf);
+  while (raw > 0)
+  {
+    raw = raw > 4096 ? raw - 4096 : 0;
+    if (ov_raw_seek (&vf, raw) == 0 && ov_pcm_tell (&vf) <= vorb_loop_to)
+      break;
+  }
+  return (size_t) raw;
+}
+#endif // ZDOOM_AUDIO_LOOP
+
+static const void *vorb_registerstream (music_stream_t *stream)
+{
+  size_t loop_raw = 0;
+
+  vorb_data = NULL;
+  vorb_stream = stream;
+  mstream_seek (stream, 0);
+
+  if (!vorb_open ())
+  {
+    vorb_stream = NULL;
+    return NULL;
+  }
+
+  #ifdef ZDOOM_AUDIO_LOOP
+  loop_raw = vorb_loop_raw = vorb_findloop ();
+  #endif // ZDOOM_AUDIO_LOOP
+  // so looping never waits on the disk
+  if (mstream_pin (stream, loop_raw, VORB_STREAM_PIN) != 0)
+    lprintf (LO_WARN, "vorb_registerstream: couldn't keep the loop start in memory\n");
+  return stream;
+}
+
 static void vorb_setvolume (int v)
 {
   vorb_volume = v;
@@ -320,6 +402,7 @@ static void vorb_unregistersong (const void *handle)
 { 
   vorb_data = NULL;
   ov_clear (&vf);
+  vorb_stream = NULL;
   vorb_playing = 0;
 }
 
@@ -332,6 +415,7 @@ static void vorb_play (const void *handle, int looping)
   vorb_looping = looping;
   #ifdef ZDOOM_AUDIO_LOOP
   vorb_total_pos = 0;
+  vorb_loop_skip = 0;
   #endif // ZDOOM_AUDIO_LOOP
 }
 
@@ -373,7 +457,20 @@ static void vorb_render_ex (void *dest, unsigned nsamp)
 
   while (nsamp > 0)
   {
+    if (vorb_stream && !mstream_ready (vorb_stream, VORB_STREAM_READY))
+    { // the reader is behind; don't stall the mixer on the disk
+      memset (sout, 0, nsamp * 4);
+      return;
+    }
+
     #ifdef ZDOOM_AUDIO_LOOP
+    if (vorb_loop_skip)
+    { // from the page the loop seek landed on up to the loop start
+      numread = ov_read_float (&vf, &pcmdata, vorb_loop_skip, &bitstreamnum);
+      vorb_loop_skip = numread > 0 ? vorb_loop_skip - numread : 0;
+      continue;
+    }
+
     // don't use custom loop end point when not in looping mode
     if (vorb_looping && vorb_total_pos + nsamp > vorb_loop_from)
       numread = ov_read_float (&vf, &pcmdata, vorb_loop_from - vorb_total_pos, &bitstreamnum);
@@ -397,7 +494,16 @@ static void vorb_render_ex (void *dest, unsigned nsamp)
       if (vorb_looping)
       {
         #ifdef ZDOOM_AUDIO_LOOP
-        ov_pcm_seek_lap (&vf, vorb_loop_to);
+        if (vorb_stream)
+        {
+          ogg_int64_t pcm;
+
+          ov_raw_seek_lap (&vf, vorb_loop_raw);
+          pcm = ov_pcm_tell (&vf);
+          vorb_loop_skip = pcm >= 0 && pcm < vorb_loop_to ? vorb_loop_to - (unsigned) pcm : 0;
+        }
+        else
+          ov_pcm_seek_lap (&vf, vorb_loop_to);
         vorb_total_pos = vorb_loop_to;
         #else // ZDOOM_AUDIO_LOOP
         ov_raw_seek_lap (&vf, 0);
@@ -462,7 +568,9 @@ const music_player_t vorb_player =
   vorb_unregistersong,
   vorb_play,
   vorb_stop,
-  vorb_render
+  vorb_render,
+  NULL,
+  vorb_registerstream
 };
 
 #endif // HAVE_LIBVORBISFILE
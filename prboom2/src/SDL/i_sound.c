@@ -75,6 +75,13 @@
 //e6y
 #include "i_pcsound.h"
 #include "e6y.h"
+#include "m_profile.h"
+#include "i_system.h"
+#include "md5.h"
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 int snd_pcspeaker;
 int lowpass_filter;
@@ -100,25 +107,56 @@ static int SAMPLECOUNT =   512;
 // MWM 2000-01-08: Sample rate in samples/second
 int snd_samplerate = 11025;
 
+// How far ahead of the audio callback music is rendered, in ms;
+// 0 renders it inside the callback
+int snd_music_latency = 50;
+
 // The actual output device.
 int audio_fd;
 
+// A sound effect converted to signed 16 bit samples at snd_samplerate
+// with the stepping and low-pass filter of the mixer applied, so the
+// mixer only has to scale and add. There is one per sound and step;
+// pitched sounds get their variants as they are first played.
+typedef struct sfxcache_s
+{
+  struct sfxcache_s *next; // other variants of the same sound
+  unsigned int step;
+  int lowpass;
+  size_t length;
+  short samples[1];
+} sfxcache_t;
+
+// Drop unused variants once the cache grows past this
+#define SFXCACHE_BUDGET (32 * 1024 * 1024)
+
+static sfxcache_t *sfxcache[NUMSFX];
+static size_t sfxcache_bytes;
+
+// The samples of a sound in its lump, which stays locked from the first
+// time the sound is played until the cache is freed
+typedef struct
+{
+  const unsigned char *data;
+  const unsigned char *start, *end;
+  unsigned int samplerate, bits;
+} sfxsource_t;
+
+static sfxsource_t sfxsource[NUMSFX];
+static int sfxcache_lookups;
+static int sfxcache_misses;
+
 typedef struct
 {
   // SFX id of the playing sound effect.
   // Used to catch duplicates (like chainsaw).
   int id;
-  // The channel step amount...
+  // The converted sound and the data pointers, current and end.
+  const sfxcache_t *cache;
+  const short *data;
+  const short *enddata;
+  // Step of the variant; unlike cache, only the game thread changes it
   unsigned int step;
-  // ... and a 0.16 bit remainder of last step.
-  unsigned int stepremainder;
-  unsigned int samplerate;
-  unsigned int bits;
-  float alpha;
-  int prevS;
-  // The channel data pointers, start and end.
-  const unsigned char *data;
-  const unsigned char *enddata;
   // Time/gametic that the channel started playing,
   //  used to determine oldest, which automatically
   //  has lowest priority.
@@ -132,7 +170,7 @@ typedef struct
 
 channel_info_t channelinfo[MAX_CHANNELS];
 
-// Pitch to stepping lookup, unused.
+// Pitch to stepping lookup
 int   steptable[256];
 
 // Volume lookups.
@@ -158,44 +196,85 @@ static void stopchan(int i)
   if (channelinfo[i].data) /* cph - prevent excess unlocks */
   {
     channelinfo[i].data = NULL;
+    channelinfo[i].cache = NULL;
   }
 }
 
 //
-// This function adds a sound to the
-//  list of currently active sounds,
-//  which is maintained as a given number
-//  (eight, usually) of internal channels.
-// Returns a handle.
+// Finds the samples of a DMX or WAV lump
 //
-static int addsfx(int sfxid, int channel, const unsigned char *data, size_t len)
+static void I_SfxFormat(const unsigned char *data, size_t len,
+                        unsigned int *samplerate, unsigned int *bits,
+                        const unsigned char **start, const unsigned char **end)
 {
-  channel_info_t *const ci = &channelinfo[channel];
-
-  stopchan(channel);
-
   if (strncmp(data, "RIFF", 4) == 0 && strncmp(data + 8, "WAVEfmt ", 8) == 0)
   {
     // FIXME: can't handle stereo wavs
-    // ci->channels = data[22] | (data[23] << 8);
-    ci->samplerate = data[24] | (data[25] << 8) | (data[26] << 16) 
-                   | (data[27] << 24);
-    ci->bits = data[34] | (data[35] << 8);
-    ci->data = data + 44;
-    ci->enddata = data + 44 + (data[40] | (data[41] << 8) | (data[42] << 16) 
-                            | (data[43] << 24));
-    if (ci->enddata > data + len - 2)
-      ci->enddata = data + len - 2;
+    // channels = data[22] | (data[23] << 8);
+    *samplerate = data[24] | (data[25] << 8) | (data[26] << 16)
+                | (data[27] << 24);
+    *bits = data[34] | (data[35] << 8);
+    *start = data + 44;
+    *end = data + 44 + (data[40] | (data[41] << 8) | (data[42] << 16)
+                     | (data[43] << 24));
+    if (*end > data + len - 2)
+      *end = data + len - 2;
   }
   else
   {
-    ci->samplerate = (data[3] << 8) + data[2];
-    ci->bits = 8;
-    ci->data = data + 8;
-    ci->enddata = data + len - 1;
+    *samplerate = (data[3] << 8) + data[2];
+    *bits = 8;
+    *start = data + 8;
+    *end = data + len - 1;
   }
 
-  ci->prevS = 0;
+  // anything but 16 bit has always been mixed as 8 bit
+  if (*bits != 16)
+    *bits = 8;
+}
+
+static unsigned int I_SfxStep(unsigned int samplerate, int pitch)
+{
+  // Set stepping
+  // MWM 2000-12-24: Calculates proportion of channel samplerate
+  // to global samplerate for mixing purposes.
+  // Patched to shift left *then* divide, to minimize roundoff errors
+  // as well as to use SAMPLERATE as defined above, not to assume 11025 Hz
+  if (pitched_sounds)
+    return (unsigned int)(((uint64_t)samplerate * steptable[pitch]) / snd_samplerate);
+  else
+    return ((samplerate << 16) / snd_samplerate);
+}
+
+//
+// Resamples a sound the way the mixer used to do it on the fly: linear
+// interpolation with a 0.16 step, then the low-pass filter borrowed
+// from Chocolate Doom. The mixer worked in 24 bit; rounding the result
+// to 16 bit keeps the mix within 1 LSB of it.
+//
+static sfxcache_t *I_ConvertSfx(const unsigned char *data, const unsigned char *enddata,
+                                unsigned int samplerate, unsigned int bits,
+                                unsigned int step)
+{
+  unsigned int rem;
+  uint64_t frames, length;
+  size_t i;
+  float alpha = 0;
+  int prevS = 0;
+  sfxcache_t *cache;
+
+  // The mixer played a sample, stepped, and stopped once it was at or
+  // past the end, so there is at least one sample
+  frames = enddata > data ? (enddata - data + bits / 8 - 1) / (bits / 8) : 0;
+  length = MAX(1, ((frames << 16) + step - 1) / step);
+  // a tiny step on a broken header would take forever
+  length = MIN(length, (uint64_t)snd_samplerate * 600);
+
+  cache = malloc(sizeof(*cache) + ((size_t)length - 1) * sizeof(cache->samples[0]));
+  cache->next = NULL;
+  cache->step = step;
+  cache->lowpass = lowpass_filter;
+  cache->length = (size_t)length;
 
   // Filter from chocolate doom i_sdlsound.c 682-695
   // Low-pass filter for cutoff frequency f:
@@ -211,11 +290,212 @@ static int addsfx(int sfxid, int channel, const unsigned char *data, size_t len)
   {
     float rc, dt;
     dt = 1.0f / snd_samplerate;
-    rc = 1.0f / (3.14f * ci->samplerate);
-    ci->alpha = dt / (rc + dt);
+    rc = 1.0f / (3.14f * samplerate);
+    alpha = dt / (rc + dt);
+  }
+
+  for (i = 0, rem = 0; i < cache->length; i++)
+  {
+    int s;
+
+    // linear filtering
+    // the old SRC did linear interpolation back into 8 bit, and then expanded to 16 bit.
+    // this does interpolation and 8->16 at same time, allowing slightly higher quality
+    if (bits == 16)
+    {
+      s = (short)(data[0] | (data[1] << 8)) * (255 - (rem >> 8))
+        + (short)(data[2] | (data[3] << 8)) * (rem >> 8);
+    }
+    else
+    {
+      s = (data[0] * (0x10000 - rem))
+        + (data[1] * (rem))
+        - 0x800000; // convert to signed
+    }
+
+    // lowpass
+    if (lowpass_filter)
+    {
+      s = prevS + alpha * (s - prevS);
+      prevS = s;
+    }
+
+    s = (s + 128) >> 8;
+    cache->samples[i] = (short)BETWEEN(SHRT_MIN, SHRT_MAX, s);
+
+    rem += step;
+    data += (rem >> 16) * (bits / 8);
+    rem &= 0xffff;
+  }
+
+  return cache;
+}
+
+static size_t I_SfxCacheSize(const sfxcache_t *cache)
+{
+  return sizeof(*cache) + (cache->length - 1) * sizeof(cache->samples[0]);
+}
+
+//
+// Frees the variants no channel is playing
+//
+static void I_TrimSfxCache(void)
+{
+  int i, chan;
+
+  SDL_LockMutex (sfxmutex);
+  for (i = 0; i < NUMSFX; i++)
+  {
+    sfxcache_t **link = &sfxcache[i];
+
+    while (*link)
+    {
+      sfxcache_t *cache = *link;
+
+      for (chan = 0; chan < MAX_CHANNELS; chan++)
+        if (channelinfo[chan].cache == cache)
+          break;
+
+      if (chan < MAX_CHANNELS)
+      {
+        link = &cache->next;
+        continue;
+      }
+
+      *link = cache->next;
+      sfxcache_bytes -= I_SfxCacheSize(cache);
+      free(cache);
+    }
   }
+  SDL_UnlockMutex (sfxmutex);
+}
+
+//
+// Returns the sound converted for the current output settings and
+// pitch, converting it on first use. Only the game thread walks and
+// changes the lists; the mixer just reads the samples of the variant
+// its channel points at.
+//
+static const sfxsource_t *I_SfxSource(int id)
+{
+  sfxsource_t *source;
+  int lump;
+  size_t len;
+
+  if (id < 0 || id >= NUMSFX)
+    return NULL;
+
+  source = &sfxsource[id];
+  if (source->data)
+    return source;
+
+  lump = S_sfx[id].lumpnum;
+  len = W_LumpLength(lump);
+
+  // e6y: Crash with zero-length sounds.
+  // Example wad: dakills (http://www.doomworld.com/idgames/index.php?id=2803)
+  // The entries DSBSPWLK, DSBSPACT, DSSWTCHN and DSSWTCHX are all zero-length sounds
+  if (len <= 8)
+    return NULL;
+
+  /* Find padded length */
+  len -= 8;
+  // use locking which makes sure the sound data is in a malloced area and
+  // not in a memory mapped one
+  source->data = (const unsigned char *)W_LockLumpNum(lump);
+
+  I_SfxFormat(source->data, len, &source->samplerate, &source->bits,
+              &source->start, &source->end);
+
+  return source;
+}
+
+static const sfxcache_t *I_CacheSfx(int id, int pitch)
+{
+  const sfxsource_t *source;
+  unsigned int step;
+  sfxcache_t *cache;
+
+  source = I_SfxSource(id);
+  if (!source)
+    return NULL;
+
+  step = I_SfxStep(source->samplerate, pitch);
+
+  // a sound that never advances would play forever
+  if (!step)
+    return NULL;
+
+  sfxcache_lookups++;
+  for (cache = sfxcache[id]; cache; cache = cache->next)
+    if (cache->step == step && cache->lowpass == lowpass_filter)
+      return cache;
+
+  sfxcache_misses++;
+  cache = I_ConvertSfx(source->start, source->end, source->samplerate, source->bits, step);
+
+  if (sfxcache_bytes + I_SfxCacheSize(cache) > SFXCACHE_BUDGET)
+    I_TrimSfxCache();
+
+  // the mixer does not look at the lists, so no locking here
+  cache->next = sfxcache[id];
+  sfxcache[id] = cache;
+  sfxcache_bytes += I_SfxCacheSize(cache);
+
+  return cache;
+}
+
+//
+// Frees the whole cache; the mixer must not be running
+//
+static void I_FreeSfxCache(void)
+{
+  int i;
+
+  if (sfxcache_lookups)
+    lprintf(LO_INFO, "I_ShutdownSound: sfx cache %lu KB, %d%% hits of %d\n",
+            (unsigned long)(sfxcache_bytes >> 10),
+            100 - 100 * sfxcache_misses / sfxcache_lookups, sfxcache_lookups);
+
+  for (i = 0; i < NUMSFX; i++)
+  {
+    while (sfxcache[i])
+    {
+      sfxcache_t *next = sfxcache[i]->next;
+      free(sfxcache[i]);
+      sfxcache[i] = next;
+    }
+
+    if (sfxsource[i].data)
+    {
+      W_UnlockLumpNum(S_sfx[i].lumpnum);
+      sfxsource[i].data = NULL;
+    }
+  }
+
+  sfxcache_bytes = 0;
+  sfxcache_lookups = 0;
+  sfxcache_misses = 0;
+}
+
+//
+// This function adds a sound to the
+//  list of currently active sounds,
+//  which is maintained as a given number
+//  (eight, usually) of internal channels.
+// Returns a handle.
+//
+static int addsfx(int sfxid, int channel, const sfxcache_t *cache)
+{
+  channel_info_t *const ci = &channelinfo[channel];
+
+  stopchan(channel);
+
+  ci->cache = cache;
+  ci->step = cache->step;
+  ci->data = cache->samples;
+  ci->enddata = cache->samples + cache->length;
 
-  ci->stepremainder = 0;
   // Should be gametic, I presume.
   ci->starttime = gametic;
 
@@ -226,7 +506,7 @@ static int addsfx(int sfxid, int channel, const unsigned char *data, size_t len)
   return channel;
 }
 
-static void updateSoundParams(int handle, int volume, int seperation, int pitch)
+static void updateSoundParams(int handle, int volume, int seperation, const sfxcache_t *cache)
 {
   int slot = handle;
   int   rightvol;
@@ -240,15 +520,19 @@ static void updateSoundParams(int handle, int volume, int seperation, int pitch)
   if (snd_pcspeaker)
     return;
 
-  // Set stepping
-  // MWM 2000-12-24: Calculates proportion of channel samplerate
-  // to global samplerate for mixing purposes.
-  // Patched to shift left *then* divide, to minimize roundoff errors
-  // as well as to use SAMPLERATE as defined above, not to assume 11025 Hz
-  if (pitched_sounds)
-    channelinfo[slot].step = (unsigned int)(((uint64_t)channelinfo[slot].samplerate * steptable[pitch]) / snd_samplerate);
-  else
-    channelinfo[slot].step = ((channelinfo[slot].samplerate << 16) / snd_samplerate);
+  // A new pitch picks another variant; carry on at the same
+  // relative position in it
+  if (cache && channelinfo[slot].data && cache != channelinfo[slot].cache)
+  {
+    const sfxcache_t *old = channelinfo[slot].cache;
+    size_t pos = (size_t)((uint64_t)(channelinfo[slot].data - old->samples)
+                          * cache->length / old->length);
+
+    channelinfo[slot].cache = cache;
+    channelinfo[slot].step = cache->step;
+    channelinfo[slot].data = cache->samples + pos;
+    channelinfo[slot].enddata = cache->samples + cache->length;
+  }
 
   // Separation, that is, orientation/stereo.
   //  range is: 1 - 256
@@ -276,8 +560,22 @@ static void updateSoundParams(int handle, int volume, int seperation, int pitch)
 
 void I_UpdateSoundParams(int handle, int volume, int seperation, int pitch)
 {
+  const sfxcache_t *cache = NULL;
+
+  // Only a new pitch needs another variant. This runs every tic for
+  // every sound, so stay off the cache lists otherwise; convert outside
+  // the lock, the mixer has to wait for it otherwise
+  if (!snd_pcspeaker && pitched_sounds &&
+      handle >= 0 && handle < MAX_CHANNELS && channelinfo[handle].data)
+  {
+    const sfxsource_t *source = I_SfxSource(channelinfo[handle].id);
+
+    if (source && I_SfxStep(source->samplerate, pitch) != channelinfo[handle].step)
+      cache = I_CacheSfx(channelinfo[handle].id, pitch);
+  }
+
   SDL_LockMutex (sfxmutex);
-  updateSoundParams(handle, volume, seperation, pitch);
+  updateSoundParams(handle, volume, seperation, cache);
   SDL_UnlockMutex (sfxmutex);
 }
 
@@ -357,9 +655,7 @@ int I_GetSfxLumpNum(sfxinfo_t *sfx)
 //
 int I_StartSound(int id, int channel, int vol, int sep, int pitch, int priority)
 {
-  const unsigned char *data;
-  int lump;
-  size_t len;
+  const sfxcache_t *cache;
 
   if ((channel < 0) || (channel >= MAX_CHANNELS))
 #ifdef RANGECHECK
@@ -371,29 +667,17 @@ int I_StartSound(int id, int channel, int vol, int sep, int pitch, int priority)
   if (snd_pcspeaker)
     return I_PCS_StartSound(id, channel, vol, sep, pitch, priority);
 
-  lump = S_sfx[id].lumpnum;
-
   // We will handle the new SFX.
-  // Set pointer to raw data.
-  len = W_LumpLength(lump);
-
-  // e6y: Crash with zero-length sounds.
-  // Example wad: dakills (http://www.doomworld.com/idgames/index.php?id=2803)
-  // The entries DSBSPWLK, DSBSPACT, DSSWTCHN and DSSWTCHX are all zero-length sounds
-  if (len <= 8) return -1;
-
-  /* Find padded length */
-  len -= 8;
-  // do the lump caching outside the SDL_LockAudio/SDL_UnlockAudio pair
-  // use locking which makes sure the sound data is in a malloced area and
-  // not in a memory mapped one
-  data = (const unsigned char *)W_LockLumpNum(lump);
+  // do the lump caching and conversion outside the mixer lock
+  cache = I_CacheSfx(id, pitch);
+  if (!cache)
+    return -1;
 
   SDL_LockMutex (sfxmutex);
 
   // Returns a handle (not used).
-  addsfx(id, channel, data, len);
-  updateSoundParams(channel, vol, sep, pitch);
+  addsfx(id, channel, cache);
+  updateSoundParams(channel, vol, sep, NULL);
 
   SDL_UnlockMutex (sfxmutex);
 
@@ -465,12 +749,13 @@ dboolean I_AnySoundStillPlaying(void)
 
 #ifndef HAVE_OWN_MUSIC
 static void Exp_UpdateMusic (void *buff, unsigned nsamp);
+static dboolean Exp_ReadMusic (void *buff, unsigned nsamp);
 #endif
 
 // from pcsound_sdl.c
 void PCSound_Mix_Callback(void *udata, Uint8 *stream, int len);
 
-static void I_UpdateSound(void *unused, Uint8 *stream, int len)
+static void I_MixSound(void *unused, Uint8 *stream, int len)
 {
   // Mix current sound data.
   // Data, from raw sound, for right and left.
@@ -498,7 +783,7 @@ static void I_UpdateSound(void *unused, Uint8 *stream, int len)
 
 #ifndef HAVE_OWN_MUSIC
   // do music update
-  if (use_experimental_music)
+  if (use_experimental_music && !Exp_ReadMusic (stream, len / 4))
   {
     SDL_LockMutex (musmutex);
     Exp_UpdateMusic (stream, len / 4);
@@ -545,32 +830,8 @@ static void I_UpdateSound(void *unused, Uint8 *stream, int len)
       // Check channel, if active.
       if (ci->data)
       {
-        int s;
-        // Get the raw data from the channel.
-        // no filtering
-        //s = ci->data[0] * 0x10000 - 0x800000;
-
-        // linear filtering
-        // the old SRC did linear interpolation back into 8 bit, and then expanded to 16 bit.
-        // this does interpolation and 8->16 at same time, allowing slightly higher quality
-        if (ci->bits == 16)
-        {
-          s = (short)(ci->data[0] | (ci->data[1] << 8)) * (255 - (ci->stepremainder >> 8))
-            + (short)(ci->data[2] | (ci->data[3] << 8)) * (ci->stepremainder >> 8);
-        }
-        else
-        {
-          s = (ci->data[0] * (0x10000 - ci->stepremainder))
-            + (ci->data[1] * (ci->stepremainder))
-            - 0x800000; // convert to signed
-        }
-
-        // lowpass
-        if (lowpass_filter)
-        {
-          s = ci->prevS + ci->alpha * (s - ci->prevS);
-          ci->prevS = s;
-        }
+        // Already resampled and filtered, see I_ConvertSfx
+        int s = *ci->data++;
 
         // Add left and right part
         //  for this channel (sound)
@@ -579,20 +840,8 @@ static void I_UpdateSound(void *unused, Uint8 *stream, int len)
 
         // full loudness (vol=127) is actually 127/191
 
-        dl += ci->leftvol * s / 49152;  // >> 15;
-        dr += ci->rightvol * s / 49152; // >> 15;
-
-        // Increment index ???
-        ci->stepremainder += ci->step;
-
-        // MSB is next sample???
-        if (ci->bits == 16)
-          ci->data += (ci->stepremainder >> 16) * 2;
-        else
-          ci->data += ci->stepremainder >> 16;
-
-        // Limit to LSB???
-        ci->stepremainder &= 0xffff;
+        dl += ci->leftvol * s / 192;
+        dr += ci->rightvol * s / 192;
 
         // Check whether we are done.
         if (ci->data >= ci->enddata)
@@ -628,6 +877,13 @@ static void I_UpdateSound(void *unused, Uint8 *stream, int len)
   SDL_UnlockMutex (sfxmutex);
 }
 
+static void I_UpdateSound(void *unused, Uint8 *stream, int len)
+{
+  M_ProfileBegin(PROF_AUDIO);
+  I_MixSound(unused, stream, len);
+  M_ProfileEnd(PROF_AUDIO);
+}
+
 void I_ShutdownSound(void)
 {
   if (sound_inited)
@@ -640,6 +896,8 @@ void I_ShutdownSound(void)
     lprintf(LO_INFO, "\n");
     sound_inited = false;
 
+    I_FreeSfxCache();
+
     if (sfxmutex)
     {
       SDL_DestroyMutex (sfxmutex);
@@ -1266,12 +1524,14 @@ const char *snd_mididev; // midi device to use (portmidiplayer)
 #include "MUSIC/musicplayer.h"
 
 #include "MUSIC/oplplayer.h"
+#include "MUSIC/opl.h"
 #include "MUSIC/madplayer.h"
 #include "MUSIC/dumbplayer.h"
 #include "MUSIC/flplayer.h"
 #include "MUSIC/vorbisplayer.h"
 #include "MUSIC/alsaplayer.h"
 #include "MUSIC/portmidiplayer.h"
+#include "MUSIC/pcmplayer.h"
 
 // list of possible music players
 static const music_player_t *music_players[] =
@@ -1318,23 +1578,205 @@ const char *snd_midiplayer;
 const char *midiplayers[midi_player_last + 1] = {
   "sdl", "fluidsynth", "opl2", "portmidi", "alsa", NULL};
 
-static int current_player = -1;
+static const music_player_t *current_player = NULL;
 static const void *music_handle = NULL;
 
 // songs played directly from wad (no mus->mid conversion)
 // won't have this
 static void *song_data = NULL;
 
+// songs played from a render (mus_render_cache) have this
+static pcm_song_t *song_render = NULL;
+
+// music files decoded as they are read have this
+static music_stream_t *song_stream = NULL;
+
 int mus_fluidsynth_chorus;
 int mus_fluidsynth_reverb;
 int mus_fluidsynth_gain; // NSM  fine tune fluidsynth output level
 int mus_opl_gain; // NSM  fine tune OPL output level
 
 
+//
+// Music render thread
+//
+// With snd_music_latency set, music is rendered ahead of the audio
+// callback by a thread of its own into a single producer / single
+// consumer ring of stereo frames. The callback only copies out of the
+// ring and never waits on musmutex, so a slow synth or decoder burst
+// eats into the latency instead of the callback deadline. Sound capture
+// renders in step with the video and does not use the ring.
+//
+
+#define MUSRING_CHUNK 512
+
+static short *musring;
+static unsigned int musring_size; // frames, power of two
+static SDL_atomic_t musring_write;
+static SDL_atomic_t musring_read;
+static SDL_atomic_t musring_flush; // frames before this one are stale
+static SDL_atomic_t musring_quit;
+static SDL_atomic_t musring_underruns;
+static SDL_atomic_t musring_underrun_frames;
+static SDL_sem *musring_sem;
+static SDL_Thread *musring_thread;
+
+static int SDLCALL Exp_MusicThread(void *unused)
+{
+  while (!SDL_AtomicGet(&musring_quit))
+  {
+    unsigned int w = SDL_AtomicGet(&musring_write);
+    unsigned int r = SDL_AtomicGet(&musring_read);
+    unsigned int pos = w & (musring_size - 1);
+    unsigned int n = MIN(MUSRING_CHUNK, musring_size - pos);
+
+    if (musring_size - (w - r) < n)
+    {
+      // full; the callback posts once it has taken something out
+      SDL_SemWaitTimeout(musring_sem, 10);
+      continue;
+    }
+
+    // the write position moves under the lock, so that a flush
+    // issued after this chunk was rendered also discards it
+    SDL_LockMutex(musmutex);
+    Exp_UpdateMusic(musring + pos * 2, n);
+    SDL_AtomicSet(&musring_write, w + n);
+    SDL_UnlockMutex(musmutex);
+  }
+
+  return 0;
+}
+
+// Drops everything rendered so far. Called with musmutex held after
+// any change the listener should hear at once.
+static void Exp_FlushMusic(void)
+{
+  if (musring_thread)
+    SDL_AtomicSet(&musring_flush, SDL_AtomicGet(&musring_write));
+}
+
+// Called from the audio callback; returns false if music has to be
+// rendered in place
+static dboolean Exp_ReadMusic(void *buff, unsigned nsamp)
+{
+  short *out = (short *)buff;
+  unsigned int r, w, flush;
+  dboolean flushed = false;
+
+  if (!musring_thread)
+    return false;
+
+  // flush never passes write, so read it first
+  r = SDL_AtomicGet(&musring_read);
+  flush = SDL_AtomicGet(&musring_flush);
+  w = SDL_AtomicGet(&musring_write);
+
+  if ((int)(flush - r) > 0)
+  {
+    r = flush;
+    flushed = true;
+  }
+
+  while (nsamp && r != w)
+  {
+    unsigned int pos = r & (musring_size - 1);
+    unsigned int n = MIN(nsamp, MIN(w - r, musring_size - pos));
+
+    memcpy(out, musring + pos * 2, n * 4);
+    out += n * 2;
+    nsamp -= n;
+    r += n;
+  }
+
+  SDL_AtomicSet(&musring_read, r);
+  if (SDL_SemValue(musring_sem) == 0)
+    SDL_SemPost(musring_sem);
+
+  if (nsamp)
+  {
+    memset(out, 0, nsamp * 4);
+    // a flush empties the ring on purpose
+    if (!flushed)
+    {
+      SDL_AtomicAdd(&musring_underruns, 1);
+      SDL_AtomicAdd(&musring_underrun_frames, nsamp);
+    }
+  }
+
+  return true;
+}
+
+static void Exp_StartMusicThread(void)
+{
+  unsigned int frames;
+
+  if (snd_music_latency <= 0 || dumping_sound)
+    return;
+
+  frames = snd_music_latency * snd_samplerate / 1000;
+  for (musring_size = MUSRING_CHUNK; musring_size < frames; musring_size <<= 1)
+    ;
+
+  musring = (short *)malloc(musring_size * 4);
+  musring_sem = SDL_CreateSemaphore(0);
+  SDL_AtomicSet(&musring_write, 0);
+  SDL_AtomicSet(&musring_read, 0);
+  SDL_AtomicSet(&musring_flush, 0);
+  SDL_AtomicSet(&musring_quit, 0);
+  SDL_AtomicSet(&musring_underruns, 0);
+  SDL_AtomicSet(&musring_underrun_frames, 0);
+
+  // the callback is not running yet, so this needs no locking
+  if (musring_sem)
+    musring_thread = SDL_CreateThread(Exp_MusicThread, "music", NULL);
+
+  if (!musring_thread)
+  {
+    lprintf(LO_WARN, "Exp_InitMusic: no music thread, rendering in the callback\n");
+    if (musring_sem)
+      SDL_DestroySemaphore(musring_sem);
+    musring_sem = NULL;
+    free(musring);
+    musring = NULL;
+    return;
+  }
+
+  lprintf(LO_INFO, "Exp_InitMusic: rendering music %u ms ahead\n",
+          musring_size * 1000 / snd_samplerate);
+}
+
+static void Exp_StopMusicThread(void)
+{
+  SDL_Thread *thread = musring_thread;
+
+  if (!thread)
+    return;
+
+  SDL_AtomicSet(&musring_quit, 1);
+  SDL_SemPost(musring_sem);
+  SDL_WaitThread(thread, NULL);
+
+  // the audio device may still be open; keep the callback off the ring
+  SDL_LockAudio();
+  musring_thread = NULL;
+  SDL_UnlockAudio();
+
+  if (SDL_AtomicGet(&musring_underruns))
+    lprintf(LO_INFO, "Exp_ShutdownMusic: %d music underruns, %d frames of silence\n",
+            SDL_AtomicGet(&musring_underruns), SDL_AtomicGet(&musring_underrun_frames));
+
+  SDL_DestroySemaphore(musring_sem);
+  musring_sem = NULL;
+  free(musring);
+  musring = NULL;
+}
+
 static void Exp_ShutdownMusic(void)
 {
   int i;
   S_StopMusic ();
+  Exp_StopMusicThread ();
 
   for (i = 0; music_players[i]; i++)
   {
@@ -1359,6 +1801,7 @@ static void Exp_InitMusic(void)
   // todo not so greedy
   for (i = 0; music_players[i]; i++)
     music_player_was_init[i] = music_players[i]->init (snd_samplerate);
+  Exp_StartMusicThread ();
   atexit(Exp_ShutdownMusic);
 }
 
@@ -1367,8 +1810,9 @@ static void Exp_PlaySong(int handle, int looping)
   if (music_handle)
   {
     SDL_LockMutex (musmutex);
-    music_players[current_player]->play (music_handle, looping);
-    music_players[current_player]->setvolume (snd_MusicVolume);
+    current_player->play (music_handle, looping);
+    current_player->setvolume (snd_MusicVolume);
+    Exp_FlushMusic ();
     SDL_UnlockMutex (musmutex);
   }
 
@@ -1385,10 +1829,12 @@ static void Exp_PauseSong (int handle)
   switch (mus_pause_opt)
   {
     case 0:
-      music_players[current_player]->stop ();
+      current_player->stop ();
+      Exp_FlushMusic ();
       break;
     case 1:
-      music_players[current_player]->pause ();
+      current_player->pause ();
+      Exp_FlushMusic ();
       break;
     default: // Default - let music continue
       break;
@@ -1406,10 +1852,12 @@ static void Exp_ResumeSong (int handle)
   {
     case 0: // i'm not sure why we can guarantee looping=true here,
             // but that's what the old code did
-      music_players[current_player]->play (music_handle, 1);
+      current_player->play (music_handle, 1);
+      Exp_FlushMusic ();
       break;
     case 1:
-      music_players[current_player]->resume ();
+      current_player->resume ();
+      Exp_FlushMusic ();
       break;
     default: // Default - music was never stopped
       break;
@@ -1422,7 +1870,8 @@ static void Exp_StopSong(int handle)
   if (music_handle)
   {
     SDL_LockMutex (musmutex);
-    music_players[current_player]->stop ();
+    current_player->stop ();
+    Exp_FlushMusic ();
     SDL_UnlockMutex (musmutex);
   }
 }
@@ -1432,13 +1881,25 @@ static void Exp_UnRegisterSong(int handle)
   if (music_handle)
   {
     SDL_LockMutex (musmutex);
-    music_players[current_player]->unregistersong (music_handle);
+    current_player->unregistersong (music_handle);
     music_handle = NULL;
+    Exp_FlushMusic ();
     if (song_data)
     {
       free (song_data);
       song_data = NULL;
     }
+    if (song_render)
+    {
+      free (song_render->data);
+      free (song_render);
+      song_render = NULL;
+    }
+    if (song_stream)
+    {
+      mstream_close (song_stream);
+      song_stream = NULL;
+    }
     SDL_UnlockMutex (musmutex);
   }
 }
@@ -1448,11 +1909,461 @@ static void Exp_SetMusicVolume (int volume)
   if (music_handle)
   {
     SDL_LockMutex (musmutex);
-    music_players[current_player]->setvolume (volume);
+    current_player->setvolume (volume);
     SDL_UnlockMutex (musmutex);
   }
 }
 
+//
+// Render cache
+//
+// With mus_render_cache, MUS lumps converted to MIDI are kept in
+// I_DoomExeDir as mus_<md5>.mid, and songs for the players that have a
+// songend hook (OPL, FluidSynth) are rendered once, ahead, and kept as
+// mus_<key>.pcm, the key covering the song, the player, the sample rate,
+// the music volume and the player settings. A render holds the first
+// pass of the song and the first seconds of the second one, which carry
+// the notes still sounding at the loop; past that, the second pass
+// sounds the same as the first, so playback loops back there.
+//
+
+int mus_render_cache;
+
+#define MUSCACHE_MAGIC 0x314d4350 // "PCM1"
+
+// seconds of the second pass to keep, and the longest song rendered
+#define RENDER_HEAD 5
+#define RENDER_MAX 1200
+#define RENDER_CHUNK 4096
+
+typedef unsigned char muskey_t[16];
+
+static void Exp_CacheName(char *name, size_t size, const muskey_t key, const char *ext)
+{
+  char hex[33];
+  int i;
+
+  for (i = 0; i < 16; i++)
+    sprintf(hex + i * 2, "%02x", key[i]);
+  doom_snprintf(name, size, "%s/mus_%s.%s", I_DoomExeDir(), hex, ext);
+}
+
+// written under another name first, so a half written file is never read
+static void Exp_WriteCacheFile(const char *name, const void *header, size_t headersize,
+                               const void *data, size_t size)
+{
+  char tmpname[PATH_MAX];
+  FILE *f;
+
+  doom_snprintf(tmpname, sizeof(tmpname), "%s.tmp", name);
+  if ((f = fopen(tmpname, "wb")))
+  {
+    int ok = (!headersize || fwrite(header, headersize, 1, f) == 1) &&
+             fwrite(data, size, 1, f) == 1;
+
+    if (fclose(f) == 0 && ok)
+    {
+      remove(name);
+      rename(tmpname, name);
+    }
+    else
+      remove(tmpname);
+  }
+}
+
+static void *Exp_ReadMidiCache(const void *data, size_t len, size_t *midilen)
+{
+  struct MD5Context md5;
+  muskey_t key;
+  char name[PATH_MAX];
+  byte *buffer;
+  int size;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const md5byte *)data, len);
+  MD5Final(key, &md5);
+  Exp_CacheName(name, sizeof(name), key, "mid");
+
+  if ((size = M_ReadFile(name, &buffer)) <= 0)
+    return NULL;
+
+  *midilen = size;
+  return buffer;
+}
+
+static void Exp_WriteMidiCache(const void *data, size_t len, const void *midi, size_t midilen)
+{
+  struct MD5Context md5;
+  muskey_t key;
+  char name[PATH_MAX];
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const md5byte *)data, len);
+  MD5Final(key, &md5);
+  Exp_CacheName(name, sizeof(name), key, "mid");
+
+  Exp_WriteCacheFile(name, NULL, 0, midi, midilen);
+}
+
+static void Exp_RenderKey(muskey_t key, const music_player_t *player, const void *data, size_t len)
+{
+  struct MD5Context md5;
+  const char *name = player->name();
+  int params[3];
+
+  params[0] = MUSCACHE_MAGIC;
+  params[1] = snd_samplerate;
+  params[2] = snd_MusicVolume;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const md5byte *)data, len);
+  MD5Update(&md5, (const md5byte *)params, sizeof(params));
+  MD5Update(&md5, (const md5byte *)name, strlen(name));
+
+  // whatever else the output of the player depends on
+  if (!strcmp(name, PLAYER_FLUIDSYNTH))
+  {
+    int settings[3];
+
+    settings[0] = mus_fluidsynth_chorus;
+    settings[1] = mus_fluidsynth_reverb;
+    settings[2] = mus_fluidsynth_gain;
+    MD5Update(&md5, (const md5byte *)settings, sizeof(settings));
+    MD5Update(&md5, (const md5byte *)snd_soundfont, strlen(snd_soundfont));
+  }
+  else if (!strcmp(name, PLAYER_OPL2))
+  {
+    int lump = W_GetNumForName("GENMIDI");
+
+    MD5Update(&md5, (const md5byte *)&mus_opl_gain, sizeof(mus_opl_gain));
+    MD5Update(&md5, (const md5byte *)W_CacheLumpNum(lump), W_LumpLength(lump));
+    W_UnlockLumpNum(lump);
+  }
+
+  MD5Final(key, &md5);
+}
+
+//
+// Exp_WriteRender
+//
+// Header is magic, length, songend, loopstart, volume and the zlib
+// packed size (0 when stored raw).
+//
+static void Exp_WriteRender(const muskey_t key, const pcm_song_t *render)
+{
+  char name[PATH_MAX];
+  int header[6];
+  size_t size = render->length * 4;
+  const void *out = render->data;
+  void *packed = NULL;
+
+  header[0] = MUSCACHE_MAGIC;
+  header[1] = render->length;
+  header[2] = render->songend;
+  header[3] = render->loopstart;
+  header[4] = render->volume;
+  header[5] = 0;
+
+#ifdef HAVE_LIBZ
+  {
+    uLongf packedsize = compressBound(size);
+
+    packed = malloc(packedsize);
+    if (compress2(packed, &packedsize, (const Bytef *)render->data, size, Z_BEST_SPEED) == Z_OK)
+    {
+      out = packed;
+      header[5] = size = packedsize;
+    }
+  }
+#endif
+
+  Exp_CacheName(name, sizeof(name), key, "pcm");
+  Exp_WriteCacheFile(name, header, sizeof(header), out, size);
+  free(packed);
+}
+
+static pcm_song_t *Exp_ReadRender(const muskey_t key)
+{
+  char name[PATH_MAX];
+  pcm_song_t *render = NULL;
+  int header[6];
+  FILE *f;
+
+  Exp_CacheName(name, sizeof(name), key, "pcm");
+  if (!(f = fopen(name, "rb")))
+    return NULL;
+
+  if (fread(header, sizeof(header), 1, f) == 1 && header[0] == MUSCACHE_MAGIC &&
+      header[1] > 0 && header[1] <= RENDER_MAX * snd_samplerate &&
+      header[2] > 0 && header[2] <= header[1] && header[3] >= 0 && header[3] < header[1])
+  {
+    size_t size = header[1] * 4;
+    dboolean ok;
+
+    render = malloc(sizeof(*render));
+    render->data = malloc(size);
+    render->length = header[1];
+    render->songend = header[2];
+    render->loopstart = header[3];
+    render->volume = header[4];
+
+    if (!header[5])
+      ok = fread(render->data, size, 1, f) == 1;
+    else
+    {
+#ifdef HAVE_LIBZ
+      void *packed = malloc(header[5]);
+      uLongf unpackedsize = size;
+
+      ok = fread(packed, header[5], 1, f) == 1 &&
+           uncompress((Bytef *)render->data, &unpackedsize, packed, header[5]) == Z_OK &&
+           unpackedsize == size;
+      free(packed);
+#else
+      ok = false;
+#endif
+    }
+
+    if (!ok)
+    {
+      free(render->data);
+      free(render);
+      render = NULL;
+    }
+  }
+  fclose(f);
+
+  return render;
+}
+
+//
+// Exp_RenderSong
+//
+// Plays the song on the player as fast as it goes, until its first end
+// plus RENDER_HEAD seconds, into a buffer of its own. This can take
+// seconds, so musmutex is not held: the caller has unregistered the
+// previous song, and with no music_handle the callback and the render
+// thread leave the players alone. The caller takes the lock to swap the
+// result in.
+//
+static pcm_song_t *Exp_RenderSong(const music_player_t *player, const void *handle)
+{
+  pcm_song_t *render;
+  short *data = NULL;
+  unsigned int size = 0, length = 0, head = 0;
+  int songend = -1;
+
+  player->play (handle, 1);
+  player->setvolume (snd_MusicVolume);
+
+  while (length < (unsigned int)(RENDER_MAX * snd_samplerate))
+  {
+    if (length + RENDER_CHUNK > size)
+    {
+      size = size ? size * 2 : 60 * snd_samplerate + RENDER_CHUNK;
+      data = realloc(data, size * 4);
+    }
+    player->render (data + length * 2, RENDER_CHUNK);
+    length += RENDER_CHUNK;
+
+    if (songend < 0 && (songend = player->songend ()) >= 0)
+      head = MIN(songend, RENDER_HEAD * snd_samplerate);
+
+    if (songend >= 0 && length >= (unsigned int)songend + head)
+      break;
+  }
+
+  player->stop ();
+
+  // a song ending within the first chunk may have ended twice in it
+  if (songend < RENDER_CHUNK || length < (unsigned int)songend + head)
+  {
+    free(data);
+    return NULL;
+  }
+
+  render = malloc(sizeof(*render));
+  render->length = songend + head;
+  render->songend = songend;
+  render->loopstart = head;
+  render->volume = snd_MusicVolume;
+  render->data = realloc(data, render->length * 4);
+  return render;
+}
+
+//
+// Exp_CachedRender
+//
+// Returns the render of the song for the player, from the cache or
+// made now, or NULL if the song is to be played live
+//
+static pcm_song_t *Exp_CachedRender(const music_player_t *player, const void *data, size_t len)
+{
+  const void *handle;
+  pcm_song_t *render;
+  muskey_t key;
+
+  // all silence; and a volume change could not bring it back
+  if (!snd_MusicVolume)
+    return NULL;
+
+  Exp_RenderKey(key, player, data, len);
+  if ((render = Exp_ReadRender(key)))
+    return render;
+
+  // rendering unlocked relies on no song playing, see Exp_RenderSong
+  if (music_handle)
+    return NULL;
+
+  if (!(handle = player->registersong (data, len)))
+    return NULL;
+
+  render = Exp_RenderSong(player, handle);
+  player->unregistersong (handle);
+
+  if (render)
+  {
+    lprintf (LO_INFO, "Exp_RegisterSongEx: Rendered %u seconds with player %s\n",
+             render->length / snd_samplerate, player->name ());
+    Exp_WriteRender(key, render);
+  }
+  return render;
+}
+
+//
+// I_OPLBenchmark
+//
+// -oplbench: renders every music lump of the game through the OPL synth,
+// once with the scalar and once with the SIMD chip emulation, checks the
+// two gave the same samples and reports how fast each went
+//
+void I_OPLBenchmark(void)
+{
+  static const char *const synth[2] = { "scalar", "simd" };
+  short *buffer = malloc(RENDER_CHUNK * 4);
+  double total_samples = 0, total_time[2] = { 0, 0 };
+  int i, passes = 1, songs = 0, mismatches = 0;
+
+  if (!opl_synth_player.init (snd_samplerate))
+  {
+    lprintf (LO_ERROR, "I_OPLBenchmark: OPL synth failed to init\n");
+    free(buffer);
+    return;
+  }
+  if (OPL_SetSIMD (1))
+    passes = 2;
+  else
+    lprintf (LO_WARN, "I_OPLBenchmark: No SIMD synth for this CPU, timing the scalar one only\n");
+  opl_synth_player.shutdown ();
+
+  for (i = 1; i < NUMMUSIC; i++)
+  {
+    unsigned char digest[2][16];
+    unsigned int length = 0;
+    double seconds[2];
+    void *midi = NULL;
+    const void *data;
+    size_t len;
+    char name[9];
+    int lump, pass;
+
+    doom_snprintf(name, sizeof(name), "d_%s", S_music[i].name);
+    if ((lump = W_CheckNumForName(name)) < 0)
+      continue;
+
+    data = W_CacheLumpNum(lump);
+    len = W_LumpLength(lump);
+    if (len > 4 && !memcmp(data, "MUS", 3))
+    {
+      MEMFILE *instream = mem_fopen_read (data, len);
+      MEMFILE *outstream = mem_fopen_write ();
+      void *outbuf;
+
+      if (mus2mid (instream, outstream) == 0)
+      {
+        mem_get_buf (outstream, &outbuf, &len);
+        midi = malloc (len);
+        memcpy (midi, outbuf, len);
+        data = midi;
+      }
+      mem_fclose (instream);
+      mem_fclose (outstream);
+    }
+
+    for (pass = 0; pass < passes; pass++)
+    {
+      const void *handle;
+      struct MD5Context md5;
+      Uint64 ticks = 0;
+
+      // a fresh chip for each pass, so both start from the same state
+      opl_synth_player.init (snd_samplerate);
+      OPL_SetSIMD (pass);
+      if (!(handle = opl_synth_player.registersong (data, len)))
+      {
+        opl_synth_player.shutdown ();
+        break;
+      }
+      opl_synth_player.setvolume (15);
+      opl_synth_player.play (handle, 0);
+
+      MD5Init(&md5);
+      for (length = 0; length < (unsigned int)(RENDER_MAX * snd_samplerate); length += RENDER_CHUNK)
+      {
+        Uint64 start = SDL_GetPerformanceCounter();
+
+        opl_synth_player.render (buffer, RENDER_CHUNK);
+        ticks += SDL_GetPerformanceCounter() - start;
+        MD5Update(&md5, (const md5byte *)buffer, RENDER_CHUNK * 4);
+        if (opl_synth_player.songend () >= 0)
+          break;
+      }
+      MD5Final(digest[pass], &md5);
+      seconds[pass] = (double)ticks / SDL_GetPerformanceFrequency();
+
+      opl_synth_player.stop ();
+      opl_synth_player.unregistersong (handle);
+      opl_synth_player.shutdown ();
+    }
+
+    free(midi);
+    W_UnlockLumpNum(lump);
+    if (pass < passes)
+    {
+      lprintf (LO_WARN, "I_OPLBenchmark: %s is not a song the OPL synth plays\n", name);
+      continue;
+    }
+
+    songs++;
+    total_samples += length;
+    for (pass = 0; pass < passes; pass++)
+      total_time[pass] += seconds[pass];
+    lprintf (LO_INFO, "I_OPLBenchmark: %-8s %6.1fs", name, (double)length / snd_samplerate);
+    for (pass = 0; pass < passes; pass++)
+      lprintf (LO_INFO, " %s %.0f samples/s", synth[pass], length / MAX(seconds[pass], 1e-9));
+    if (passes == 2 && memcmp(digest[0], digest[1], sizeof(digest[0])))
+    {
+      mismatches++;
+      lprintf (LO_INFO, " MISMATCH");
+    }
+    lprintf (LO_INFO, "\n");
+  }
+
+  if (songs)
+  {
+    lprintf (LO_INFO, "I_OPLBenchmark: %d songs, %.1f minutes at %d Hz\n",
+             songs, total_samples / snd_samplerate / 60, snd_samplerate);
+    for (i = 0; i < passes; i++)
+      lprintf (LO_INFO, "I_OPLBenchmark: %s %.0f samples/s (%.1fx real time)\n",
+               synth[i], total_samples / MAX(total_time[i], 1e-9),
+               total_samples / snd_samplerate / MAX(total_time[i], 1e-9));
+    if (passes == 2)
+      lprintf (mismatches ? LO_WARN : LO_INFO, "I_OPLBenchmark: simd output %s\n",
+               mismatches ? "differs from scalar" : "matches scalar");
+  }
+  free(buffer);
+}
+
 // returns 1 on success, 0 on failure
 static int Exp_RegisterSongEx (const void *data, size_t len, int try_mus2mid)
 {
@@ -1495,11 +2406,29 @@ static int Exp_RegisterSongEx (const void *data, size_t len, int try_mus2mid)
           found = 1;
           if (music_player_was_init[i])
           {
-            const void *temp_handle = music_players[i]->registersong (data, len);
+            const void *temp_handle;
+
+            if (mus_render_cache && music_players[i]->songend)
+            {
+              pcm_song_t *render = Exp_CachedRender (music_players[i], data, len);
+
+              if (render)
+              {
+                SDL_LockMutex (musmutex);
+                current_player = &pcm_player;
+                music_handle = pcm_player.registersong (render, sizeof (*render));
+                song_render = render;
+                SDL_UnlockMutex (musmutex);
+                lprintf (LO_INFO, "Exp_RegisterSongEx: Using player %s, rendered ahead\n", music_players[i]->name ());
+                return 1;
+              }
+            }
+
+            temp_handle = music_players[i]->registersong (data, len);
             if (temp_handle)
             {
               SDL_LockMutex (musmutex);
-              current_player = i;
+              current_player = music_players[i];
               music_handle = temp_handle;
               SDL_UnlockMutex (musmutex);
               lprintf (LO_INFO, "Exp_RegisterSongEx: Using player %s\n", music_players[i]->name ());
@@ -1522,6 +2451,8 @@ static int Exp_RegisterSongEx (const void *data, size_t len, int try_mus2mid)
   // load failed? try mus2mid
   if (len > 4 && try_mus2mid)
   {
+    if (mus_render_cache && (song_data = Exp_ReadMidiCache (data, len, &outbuf_len)))
+      return Exp_RegisterSongEx (song_data, outbuf_len, 0);
 
     instream = mem_fopen_read (data, len);
     outstream = mem_fopen_write ();
@@ -1568,6 +2499,8 @@ static int Exp_RegisterSongEx (const void *data, size_t len, int try_mus2mid)
 
       if (song_data)
       { 
+        if (mus_render_cache)
+          Exp_WriteMidiCache (data, len, song_data, outbuf_len);
         return Exp_RegisterSongEx (song_data, outbuf_len, 0);
       }
     }
@@ -1584,12 +2517,73 @@ static int Exp_RegisterSong (const void *data, size_t len)
   return 0;
 }
 
+//
+// Exp_RegisterStream
+//
+// Offers the file to the players that can decode it while it is read, in
+// the preferred order; returns 1 if one of them took it
+//
+static int Exp_RegisterStream (const char *filename)
+{
+  Uint64 start = SDL_GetPerformanceCounter ();
+  music_stream_t *stream;
+  int i, j;
+
+  if (!(stream = mstream_open (filename)))
+    return 0;
+
+  if (music_handle)
+    Exp_UnRegisterSong (0);
+
+  for (j = 0; j < NUM_MUS_PLAYERS; j++)
+  {
+    for (i = 0; music_players[i]; i++)
+    {
+      const void *temp_handle;
+
+      if (!music_players[i]->registerstream || !music_player_was_init[i] ||
+          strcmp (music_players[i]->name (), music_player_order[j]) != 0)
+        continue;
+
+      temp_handle = music_players[i]->registerstream (stream);
+      if (temp_handle)
+      {
+        SDL_LockMutex (musmutex);
+        current_player = music_players[i];
+        music_handle = temp_handle;
+        song_stream = stream;
+        SDL_UnlockMutex (musmutex);
+        lprintf (LO_INFO, "Exp_RegisterMusic: Streaming with player %s, ready in %.1f ms, %lu of %lu KB in memory\n",
+                 music_players[i]->name (),
+                 (SDL_GetPerformanceCounter () - start) * 1000.0 / SDL_GetPerformanceFrequency (),
+                 (unsigned long) mstream_memory (stream) / 1024,
+                 (unsigned long) mstream_length (stream) / 1024);
+        return 1;
+      }
+    }
+  }
+
+  mstream_close (stream);
+  return 0;
+}
+
 // try register external music file (not in WAD)
 
 static int Exp_RegisterMusic (const char *filename, musicinfo_t *song)
 {
+  Uint64 start;
   int len;
 
+  // mp3 and ogg files play while they are read
+  if (Exp_RegisterStream (filename))
+  {
+    song->data = 0;
+    song->handle = 0;
+    song->lumpnum = 0;
+    return 0;
+  }
+
+  start = SDL_GetPerformanceCounter ();
   len = M_ReadFile (filename, (byte **) &song_data);
 
   if (len == -1)
@@ -1605,6 +2599,9 @@ static int Exp_RegisterMusic (const char *filename, musicinfo_t *song)
     lprintf(LO_WARN, "Couldn't load music from %s\nAttempting to load default MIDI music.\n", filename);
     return 1; // failure
   }
+  lprintf (LO_INFO, "Exp_RegisterMusic: Read into memory, ready in %.1f ms, %d KB in memory\n",
+           (SDL_GetPerformanceCounter () - start) * 1000.0 / SDL_GetPerformanceFrequency (),
+           len / 1024);
 
   song->data = 0;
   song->handle = 0;
@@ -1622,7 +2619,7 @@ static void Exp_UpdateMusic (void *buff, unsigned nsamp)
   }
 
 
-  music_players[current_player]->render (buff, nsamp);
+  current_player->render (buff, nsamp);
 }
 
 void M_ChangeMIDIPlayer(void)
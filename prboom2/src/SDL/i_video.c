@@ -116,11 +116,21 @@ int render_vsync;
 int screen_multiply;
 int render_screen_multiply;
 int integer_scaling;
+int render_streaming_present;
 SDL_Surface *screen;
 static SDL_Surface *buffer;
 SDL_Window *sdl_window;
 SDL_Renderer *sdl_renderer;
 static SDL_Texture *sdl_texture;
+static dboolean streaming_texture; // sdl_texture is streaming RGB888
+static Uint32 present_palette[256]; // current palette as RGB888 pixels
+static byte *present_shadow;        // 8-bit rows as last uploaded
+static dboolean present_full;       // texture contents must all be redone
+
+// -presentstats: where I_FinishUpdate spends its time
+static dboolean present_stats;
+static Uint64 present_upload_time, present_render_time;
+static unsigned int present_frames;
 static SDL_GLContext sdl_glcontext;
 unsigned int windowid = 0;
 SDL_Rect src_rect = { 0, 0, 0, 0 };
@@ -478,6 +488,15 @@ static void I_UploadNewPalette(int pal, int force)
 #endif
 
   SDL_SetPaletteColors(screen->format->palette, colours+256*pal, 0, 256);
+
+  {
+    const SDL_Color *c = colours+256*pal;
+    int i;
+
+    for (i = 0; i < 256; i++, c++)
+      present_palette[i] = (c->r << 16) | (c->g << 8) | c->b;
+    present_full = true;
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -496,6 +515,76 @@ void I_UpdateNoBlit (void)
 {
 }
 
+//
+// I_UpdateStreamingTexture
+//
+// Converts and uploads the rows of screens[0] that changed since the
+// last frame. In 8-bit mode rows that were redrawn identically are
+// found by comparing against a copy of what the texture holds, so a
+// paused game or a static menu costs next to nothing.
+//
+static void I_UpdateStreamingTexture(void)
+{
+  int top = MAX(dirtyrows_top, 0);
+  int bottom = MIN(dirtyrows_bottom, SCREENHEIGHT - 1);
+  SDL_Rect rect;
+
+  if (present_full)
+  {
+    top = 0;
+    bottom = SCREENHEIGHT - 1;
+  }
+  else if (V_GetMode() == VID_MODE8)
+  {
+    const byte *src = screens[0].data;
+    const int pitch = screens[0].byte_pitch;
+
+    while (top <= bottom &&
+           !memcmp(src + top * pitch, present_shadow + top * SCREENWIDTH, SCREENWIDTH))
+      top++;
+    while (bottom >= top &&
+           !memcmp(src + bottom * pitch, present_shadow + bottom * SCREENWIDTH, SCREENWIDTH))
+      bottom--;
+  }
+
+  if (top > bottom)
+    return;
+
+  rect.x = 0;
+  rect.y = top;
+  rect.w = SCREENWIDTH;
+  rect.h = bottom - top + 1;
+
+  if (V_GetMode() == VID_MODE8)
+  {
+    void *pixels;
+    int pitch, y;
+
+    // The locked rows are write-only, so all of them are converted
+    if (SDL_LockTexture(sdl_texture, &rect, &pixels, &pitch) < 0)
+      return;
+
+    for (y = top; y <= bottom; y++)
+    {
+      const byte *src = screens[0].data + y * screens[0].byte_pitch;
+
+      V_ExpandPaletted((unsigned int *)((byte *)pixels + (y - top) * pitch),
+                       src, SCREENWIDTH, present_palette);
+      memcpy(present_shadow + y * SCREENWIDTH, src, SCREENWIDTH);
+    }
+
+    SDL_UnlockTexture(sdl_texture);
+  }
+  else
+  {
+    // The screen is already in the texture format
+    SDL_UpdateTexture(sdl_texture, &rect,
+                      (byte *)screen->pixels + top * screen->pitch, screen->pitch);
+  }
+
+  present_full = false;
+}
+
 //
 // I_FinishUpdate
 //
@@ -504,6 +593,8 @@ static int newpal = 0;
 
 void I_FinishUpdate (void)
 {
+  Uint64 start_time = 0, upload_time = 0;
+
   //e6y: new mouse code
   UpdateGrab();
 
@@ -525,7 +616,11 @@ void I_FinishUpdate (void)
   }
 #endif
 
-  if (SDL_MUSTLOCK(screen)) {
+  if (present_stats)
+    start_time = SDL_GetPerformanceCounter();
+
+  // The streaming path reads the 8-bit screen straight from screens[0]
+  if (SDL_MUSTLOCK(screen) && !(streaming_texture && V_GetMode() == VID_MODE8)) {
       int h;
       byte *src;
       byte *dest;
@@ -555,12 +650,22 @@ void I_FinishUpdate (void)
     newpal = NO_PALETTE_CHANGE;
   }
 
-  // Blit from the paletted 8-bit screen buffer to the intermediate
-  // 32-bit RGBA buffer that we can load into the texture.
-  SDL_LowerBlit(screen, &src_rect, buffer, &src_rect);
+  if (streaming_texture && (V_GetMode() == VID_MODE8 || V_GetMode() == VID_MODE32))
+  {
+    I_UpdateStreamingTexture();
+  }
+  else
+  {
+    // Blit from the paletted 8-bit screen buffer to the intermediate
+    // 32-bit RGBA buffer that we can load into the texture.
+    SDL_LowerBlit(screen, &src_rect, buffer, &src_rect);
+
+    // Update the intermediate texture with the contents of the RGBA buffer.
+    SDL_UpdateTexture(sdl_texture, &src_rect, buffer->pixels, buffer->pitch);
+  }
 
-  // Update the intermediate texture with the contents of the RGBA buffer.
-  SDL_UpdateTexture(sdl_texture, &src_rect, buffer->pixels, buffer->pitch);
+  if (present_stats)
+    upload_time = SDL_GetPerformanceCounter();
 
   // Make sure the pillarboxes are kept clear each frame.
   SDL_RenderClear(sdl_renderer);
@@ -569,6 +674,15 @@ void I_FinishUpdate (void)
 
   // Draw!
   SDL_RenderPresent(sdl_renderer);
+
+  if (present_stats)
+  {
+    present_upload_time += upload_time - start_time;
+    present_render_time += SDL_GetPerformanceCounter() - upload_time;
+    present_frames++;
+  }
+
+  V_ClearDirtyRows();
 }
 
 //
@@ -587,9 +701,19 @@ void I_SetPalette (int pal)
 
 static void I_ShutdownSDL(void)
 {
+  if (present_stats && present_frames)
+  {
+    double ms = 1000.0 / SDL_GetPerformanceFrequency() / present_frames;
+
+    lprintf(LO_INFO, "I_FinishUpdate: %u frames, %s, %.3f ms convert/upload, %.3f ms present\n",
+            present_frames, streaming_texture ? "streaming texture" : "surface blit",
+            present_upload_time * ms, present_render_time * ms);
+  }
+
   if (sdl_glcontext) SDL_GL_DeleteContext(sdl_glcontext);
   if (screen) SDL_FreeSurface(screen);
   if (buffer) SDL_FreeSurface(buffer);
+  if (present_shadow) free(present_shadow);
   if (sdl_texture) SDL_DestroyTexture(sdl_texture);
   if (sdl_renderer) SDL_DestroyRenderer(sdl_renderer);
   if (sdl_window) SDL_DestroyWindow(sdl_window);
@@ -1087,6 +1211,8 @@ void I_InitGraphics(void)
     atexit(I_ShutdownGraphics);
     lprintf(LO_INFO, "I_InitGraphics: %dx%d\n", SCREENWIDTH, SCREENHEIGHT);
 
+    present_stats = M_CheckParm("-presentstats");
+
     /* Set the video mode */
     I_UpdateVideoMode();
 
@@ -1158,6 +1284,7 @@ void I_UpdateVideoMode(void)
     if (sdl_glcontext) SDL_GL_DeleteContext(sdl_glcontext);
     if (screen) SDL_FreeSurface(screen);
     if (buffer) SDL_FreeSurface(buffer);
+    if (present_shadow) free(present_shadow);
     if (sdl_texture) SDL_DestroyTexture(sdl_texture);
     if (sdl_renderer) SDL_DestroyRenderer(sdl_renderer);
     SDL_DestroyWindow(sdl_window);
@@ -1167,6 +1294,7 @@ void I_UpdateVideoMode(void)
     sdl_glcontext = NULL;
     screen = NULL;
     buffer = NULL;
+    present_shadow = NULL;
     sdl_texture = NULL;
   }
 
@@ -1269,10 +1397,28 @@ void I_UpdateVideoMode(void)
     SDL_RenderSetIntegerScale(sdl_renderer, integer_scaling);
 
     screen = SDL_CreateRGBSurface(0, SCREENWIDTH, SCREENHEIGHT, V_GetNumPixelBits(), 0, 0, 0, 0);
-    buffer = SDL_CreateRGBSurface(0, SCREENWIDTH, SCREENHEIGHT, 32, 0, 0, 0, 0);
-    SDL_FillRect(buffer, NULL, 0);
 
-    sdl_texture = SDL_CreateTextureFromSurface(sdl_renderer, buffer);
+    // 8 and 32 bit frames go straight into a streaming texture; the
+    // intermediate surface is only needed for the 15/16 bit conversion.
+    streaming_texture = false;
+    if (render_streaming_present)
+    {
+      sdl_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_RGB888,
+                                      SDL_TEXTUREACCESS_STREAMING,
+                                      SCREENWIDTH, SCREENHEIGHT);
+      streaming_texture = (sdl_texture != NULL);
+      present_shadow = malloc(SCREENWIDTH * SCREENHEIGHT);
+      present_full = true;
+    }
+
+    if (!streaming_texture || V_GetMode() == VID_MODE15 || V_GetMode() == VID_MODE16)
+    {
+      buffer = SDL_CreateRGBSurface(0, SCREENWIDTH, SCREENHEIGHT, 32, 0, 0, 0, 0);
+      SDL_FillRect(buffer, NULL, 0);
+
+      if (!sdl_texture)
+        sdl_texture = SDL_CreateTextureFromSurface(sdl_renderer, buffer);
+    }
 
     if(screen == NULL) {
       I_Error("Couldn't set %dx%d video mode [%s]", SCREENWIDTH, SCREENHEIGHT, SDL_GetError());
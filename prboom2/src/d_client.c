@@ -70,6 +70,7 @@
 #include "r_fps.h"
 #include "lprintf.h"
 #include "e6y.h"
+#include "m_profile.h"
 
 static dboolean   server;
 static int       remotetic; // Tic expected from the remote
@@ -515,7 +516,9 @@ void TryRunTics (void)
       D_DoAdvanceDemo ();
     M_Ticker ();
     I_GetTime_SaveMS();
+    M_ProfileBegin(PROF_TICKER);
     G_Ticker ();
+    M_ProfileEnd(PROF_TICKER);
     P_Checksum(gametic);
     gametic++;
 #ifdef HAVE_NET
@@ -86,6 +86,7 @@
 #include "am_map.h"
 #include "umapinfo.h"
 #include "statdump.h"
+#include "m_profile.h"
 
 //e6y
 #include "r_demo.h"
@@ -378,6 +379,7 @@ void D_Display (fixed_t frac)
 
     R_RestoreInterpolations();
 
+    M_ProfileBegin(PROF_HUD);
     ST_Drawer(
         ((viewheight != SCREENHEIGHT)
          || ((automapmode & am_active) && !(automapmode & am_overlay))),
@@ -388,6 +390,7 @@ void D_Display (fixed_t frac)
     if (V_GetMode() != VID_MODEGL)
       R_DrawViewBorder();
     HU_Drawer();
+    M_ProfileEnd(PROF_HUD);
   }
 
   isborderstate      = isborder;
@@ -412,7 +415,12 @@ void D_Display (fixed_t frac)
 
   // normal update
   if (!wipe)
+  {
+    M_ProfileDrawer();
+    M_ProfileBegin(PROF_PRESENT);
     I_FinishUpdate ();              // page flip or blit buffer
+    M_ProfileEnd(PROF_PRESENT);
+  }
   else {
     // wipe update
     wipe_EndScreen();
@@ -425,6 +433,8 @@ void D_Display (fixed_t frac)
     I_uSleep(5000);
   }
 
+  M_ProfileEndFrame();
+
   I_EndDisplay();
 }
 
@@ -465,7 +475,9 @@ static void D_DoomLoop(void)
           if (advancedemo)
             D_DoAdvanceDemo ();
           M_Ticker ();
+          M_ProfileBegin(PROF_TICKER);
           G_Ticker ();
+          M_ProfileEnd(PROF_TICKER);
           P_Checksum(gametic);
           gametic++;
           maketic++;
@@ -1886,9 +1898,17 @@ static void D_DoomMainSetup(void)
   lprintf(LO_INFO,"\nP_Init: Init Playloop state.\n");
   P_Init();
 
+  // renders the music through the OPL synth and reports its speed
+  if (M_CheckParm("-oplbench"))
+  {
+    I_OPLBenchmark();
+    I_SafeExit(0);
+  }
+
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"I_Init: Setting up machine state.\n");
   I_Init();
+  M_InitProfiler();
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_INFO,"S_Init: Setting up sound.\n");
@@ -252,6 +252,7 @@ int wipe_ScreenWipe(int ticks)
 {
   static dboolean go;                               // when zero, stop the wipe
   if(!render_wipescreen) return 0;//e6y
+  V_MarkScreen();                                  // the melt covers it all
   if (!go)                                         // initial stuff
     {
       go = 1;
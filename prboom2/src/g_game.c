@@ -86,6 +86,8 @@
 #include "r_fps.h"
 #include "e6y.h"//e6y
 #include "statdump.h"
+#include "r_precache.h"
+#include "m_profile.h"
 
 // ano - used for version 255+ demos, like EE or MBF
 static char     prdemosig[] = "PR+UM";
@@ -1264,12 +1266,15 @@ void G_Ticker (void)
   switch (gamestate)
     {
     case GS_LEVEL:
+      M_ProfileBegin(PROF_PLAYSIM);
       P_Ticker ();
+      M_ProfileEnd(PROF_PLAYSIM);
       P_WalkTicker();
       mlooky = 0;
       AM_Ticker();
       ST_Ticker ();
       HU_Ticker ();
+      R_PrecacheTicker ();
       break;
 
     case GS_INTERMISSION:
@@ -1794,6 +1799,7 @@ frommapinfo:
   }
 
   e6y_G_DoCompleted();//e6y
+  P_WriteThinkerStats();
 
   if (gamemode == commercial || gamemap != 8)
   {
@@ -4251,6 +4257,7 @@ dboolean G_CheckDemoStatus (void)
       unsigned realtics = endtime-starttime;
 
       M_SaveDefaults();
+      M_WriteBenchmark(gametic, realtics);
 
       I_Error ("Timed %u gametics in %u realtics = %-.1f frames per second",
                (unsigned) gametic,realtics,
@@ -0,0 +1,407 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Texture atlases for sprites and HUD patches
+ *
+ *  Patches that qualify are packed into a few large textures when they
+ *  are registered, so consecutive sprites and 2D graphics mostly share
+ *  a texture and skip the bind. The layout of a page is fixed; each
+ *  colormap translation in use gets its own GL texture with that layout,
+ *  and a patch is uploaded into it the first time it is drawn that way.
+ *  Only the first ATLAS_VARIANTS translations of a page get one; patches
+ *  drawn with any other fall back to their own textures and UVs.
+ *  gl_main.c gathers the quads of consecutive sprites and HUD patches on
+ *  the same page and draws them with one call.
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gl_opengl.h"
+
+#include "z_zone.h"
+#include "doomstat.h"
+#include "r_main.h"
+#include "r_patch.h"
+#include "e6y.h"
+#include "gl_intern.h"
+#include "gl_struct.h"
+
+#define ATLAS_SIZE      1024
+#define ATLAS_MAXPATCH  256 // larger patches keep their own texture
+#define ATLAS_PADDING   1   // edge pixels repeated around every patch
+#define ATLAS_VARIANTS  4   // colormaps per page, others use own textures
+
+int gl_patch_atlas;
+
+typedef struct
+{
+  int cm, player_cm, boom_cm;
+  GLuint texid;
+  byte *uploaded;       // per slot
+} atlas_variant_t;
+
+typedef struct
+{
+  dboolean sprites;     // MIP_SPRITE filtering rather than MIP_PATCH
+  dboolean is_static;   // holds patches of gld_GLStaticPatchTextures
+
+  int shelf_x, shelf_y, shelf_height;
+  int used_pixels;
+
+  GLTexture **slots;
+  int numslots, maxslots;
+
+  atlas_variant_t **variants;
+  int numvariants;
+} atlas_page_t;
+
+static atlas_page_t *atlas_pages;
+static int atlas_numpages;
+
+static void gld_UpdateAtlasStats(void)
+{
+  int i, used = 0, pages = 0;
+
+  for (i = 0; i < atlas_numpages; i++)
+  {
+    if (atlas_pages[i].numslots)
+    {
+      used += atlas_pages[i].used_pixels;
+      pages++;
+    }
+  }
+
+  rendered_atlaspages = pages;
+  rendered_atlasfill = (pages ?
+    (int)((100.0 * used) / ((double)pages * ATLAS_SIZE * ATLAS_SIZE)) : 0);
+}
+
+// Shelf packing: patches go left to right along the current shelf, and a
+// new shelf is opened under it when the patch does not fit anymore.
+static dboolean gld_AllocAtlasRect(atlas_page_t *page, int w, int h, int *x, int *y)
+{
+  if (page->shelf_x + w > ATLAS_SIZE)
+  {
+    page->shelf_y += page->shelf_height;
+    page->shelf_x = 0;
+    page->shelf_height = 0;
+  }
+
+  if (page->shelf_y + h > ATLAS_SIZE)
+    return false;
+
+  *x = page->shelf_x;
+  *y = page->shelf_y;
+  page->shelf_x += w;
+  page->shelf_height = MAX(page->shelf_height, h);
+  page->used_pixels += w * h;
+
+  return true;
+}
+
+void gld_AddPatchToAtlas(GLTexture *gltexture, dboolean is_static)
+{
+  dboolean sprites = !!(gltexture->flags & GLTEXTURE_SPRITE);
+  int w = gltexture->realtexwidth + 2 * ATLAS_PADDING;
+  int h = gltexture->realtexheight + 2 * ATLAS_PADDING;
+  atlas_page_t *page = NULL;
+  int i, x, y;
+
+  // what changes the texture data or how it is sampled keeps it out
+  if (!gl_patch_atlas ||
+      gl_paletted_texture ||
+      gl_texture_external_hires ||
+      gl_texture_internal_hires ||
+      gl_texture_hqresize ||
+      (gltexture->flags & (GLTEXTURE_MIPMAP | GLTEXTURE_HIRES)) ||
+      gltexture->realtexwidth > ATLAS_MAXPATCH ||
+      gltexture->realtexheight > ATLAS_MAXPATCH ||
+      ATLAS_SIZE > gl_max_texture_size)
+  {
+    return;
+  }
+
+  for (i = 0; i < atlas_numpages; i++)
+  {
+    if (atlas_pages[i].sprites == sprites &&
+        atlas_pages[i].is_static == is_static &&
+        gld_AllocAtlasRect(&atlas_pages[i], w, h, &x, &y))
+    {
+      page = &atlas_pages[i];
+      break;
+    }
+  }
+
+  if (!page)
+  {
+    // reuse a page emptied by gld_FlushAtlas before growing the list
+    for (i = 0; i < atlas_numpages; i++)
+    {
+      if (!atlas_pages[i].numslots)
+        break;
+    }
+    if (i == atlas_numpages)
+    {
+      atlas_pages = realloc(atlas_pages, ++atlas_numpages * sizeof(atlas_pages[0]));
+      memset(&atlas_pages[i], 0, sizeof(atlas_pages[0]));
+    }
+
+    page = &atlas_pages[i];
+    page->sprites = sprites;
+    page->is_static = is_static;
+    page->shelf_x = page->shelf_y = page->shelf_height = 0;
+    page->used_pixels = 0;
+    gld_AllocAtlasRect(page, w, h, &x, &y);
+  }
+
+  if (page->numslots >= page->maxslots)
+  {
+    int oldmax = page->maxslots;
+
+    page->maxslots = (page->maxslots ? page->maxslots * 2 : 256);
+    page->slots = realloc(page->slots, page->maxslots * sizeof(page->slots[0]));
+
+    for (i = 0; i < page->numvariants; i++)
+    {
+      atlas_variant_t *variant = page->variants[i];
+
+      variant->uploaded = realloc(variant->uploaded, page->maxslots);
+      memset(variant->uploaded + oldmax, 0, page->maxslots - oldmax);
+    }
+  }
+
+  gltexture->atlas_page = (int)(page - atlas_pages) + 1;
+  gltexture->atlas_slot = page->numslots;
+  gltexture->atlas_x = x + ATLAS_PADDING;
+  gltexture->atlas_y = y + ATLAS_PADDING;
+  page->slots[page->numslots++] = gltexture;
+
+  // UVs of the patch inside the page
+  gltexture->atlas_u1 = (float)gltexture->atlas_x / ATLAS_SIZE;
+  gltexture->atlas_v1 = (float)gltexture->atlas_y / ATLAS_SIZE;
+  gltexture->atlas_u2 = (float)(gltexture->atlas_x + gltexture->realtexwidth) / ATLAS_SIZE;
+  gltexture->atlas_v2 = (float)(gltexture->atlas_y + gltexture->realtexheight) / ATLAS_SIZE;
+
+  gld_UpdateAtlasStats();
+}
+
+static atlas_variant_t *gld_GetAtlasVariant(atlas_page_t *page, GLTexture *gltexture)
+{
+  atlas_variant_t *variant;
+  int bcm = (gl_boom_colormaps ? boom_cm : 0);
+  int i;
+
+  for (i = 0; i < page->numvariants; i++)
+  {
+    variant = page->variants[i];
+    if (variant->cm == gltexture->cm &&
+        variant->player_cm == gltexture->player_cm &&
+        variant->boom_cm == bcm)
+    {
+      return variant;
+    }
+  }
+
+  // every variant costs a whole page of video memory, so translations
+  // beyond the first few drawn from this page go to their own textures
+  if (page->numvariants >= ATLAS_VARIANTS)
+    return NULL;
+
+  variant = calloc(1, sizeof(*variant));
+  variant->cm = gltexture->cm;
+  variant->player_cm = gltexture->player_cm;
+  variant->boom_cm = bcm;
+  variant->uploaded = calloc(page->maxslots, sizeof(variant->uploaded[0]));
+
+  page->variants = realloc(page->variants, (page->numvariants + 1) * sizeof(page->variants[0]));
+  page->variants[page->numvariants++] = variant;
+
+  // left undefined; the gaps between patches are never sampled
+  glGenTextures(1, &variant->texid);
+  glBindTexture(GL_TEXTURE_2D, variant->texid);
+  glTexImage2D(GL_TEXTURE_2D, 0, gl_tex_format, ATLAS_SIZE, ATLAS_SIZE,
+    0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GLEXT_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GLEXT_CLAMP_TO_EDGE);
+  gld_SetTexFilters(gltexture);
+  rendered_texbinds++;
+
+  // the caller compares against this before binding
+  last_glTexID = &variant->texid;
+
+  return variant;
+}
+
+static void gld_UploadAtlasPatch(atlas_variant_t *variant, GLTexture *gltexture)
+{
+  const rpatch_t *patch;
+  unsigned char *buffer, *padded;
+  int w = gltexture->realtexwidth;
+  int h = gltexture->realtexheight;
+  int pw = w + 2 * ATLAS_PADDING;
+  int ph = h + 2 * ATLAS_PADDING;
+  int x, y;
+
+  // the same texels gld_BindPatch would upload on its own
+  patch = R_CachePatchNum(gltexture->index);
+  buffer = Z_Malloc(gltexture->buffer_size, PU_STATIC, 0);
+  memset(buffer, 0, gltexture->buffer_size);
+  gld_AddPatchToTexture(gltexture, buffer, patch, 0, 0, gltexture->cm, false);
+  R_UnlockPatchNum(gltexture->index);
+
+  if (gltexture->flags & GLTEXTURE_HASHOLES)
+  {
+    SmoothEdges(buffer, gltexture->buffer_width, gltexture->buffer_height);
+  }
+
+  // copy it with its edges repeated, which is what clamping did
+  padded = Z_Malloc(pw * ph * 4, PU_STATIC, 0);
+  for (y = 0; y < ph; y++)
+  {
+    int sy = BETWEEN(0, h - 1, y - ATLAS_PADDING);
+    const unsigned char *src = buffer + sy * gltexture->buffer_width * 4;
+    unsigned char *dst = padded + y * pw * 4;
+
+    for (x = 0; x < pw; x++)
+    {
+      int sx = BETWEEN(0, w - 1, x - ATLAS_PADDING);
+      memcpy(dst + x * 4, src + sx * 4, 4);
+    }
+  }
+
+  glTexSubImage2D(GL_TEXTURE_2D, 0,
+    gltexture->atlas_x - ATLAS_PADDING, gltexture->atlas_y - ATLAS_PADDING,
+    pw, ph, GL_RGBA, GL_UNSIGNED_BYTE, padded);
+
+  Z_Free(padded);
+  Z_Free(buffer);
+
+  variant->uploaded[gltexture->atlas_slot] = true;
+}
+
+//
+// gld_GetAtlasPatch
+//
+// Returns the texture of the atlas page the patch is drawn from with this
+// translation, with the patch uploaded into it, or NULL if it is drawn
+// from its own texture. The page may be left bound; the caller binds it
+// before drawing with atlas_u1..atlas_v2.
+//
+GLuint *gld_GetAtlasPatch(GLTexture *gltexture, int cm)
+{
+  atlas_page_t *page;
+  atlas_variant_t *variant;
+
+  if (!gltexture || gltexture->textype != GLDT_PATCH || !gltexture->atlas_page)
+    return NULL;
+
+  page = &atlas_pages[gltexture->atlas_page - 1];
+
+  gld_GetTextureTexID(gltexture, cm);
+  variant = gld_GetAtlasVariant(page, gltexture);
+  if (!variant)
+    return NULL;
+
+  if (!variant->uploaded[gltexture->atlas_slot])
+  {
+    if (last_glTexID != &variant->texid)
+    {
+      glBindTexture(GL_TEXTURE_2D, variant->texid);
+      last_glTexID = &variant->texid;
+      rendered_texbinds++;
+    }
+    gld_UploadAtlasPatch(variant, gltexture);
+  }
+
+  return &variant->texid;
+}
+
+//
+// gld_BindAtlasPatch
+//
+// Binds the atlas page of the patch and returns true, so the caller draws
+// with atlas_u1..atlas_v2. Otherwise the patch is bound by gld_BindPatch
+// and the usual 0..scalexfac/scaleyfac UVs apply.
+//
+dboolean gld_BindAtlasPatch(GLTexture *gltexture, int cm)
+{
+  GLuint *texid = gld_GetAtlasPatch(gltexture, cm);
+
+  if (!texid)
+  {
+    gld_BindPatch(gltexture, cm);
+    return false;
+  }
+
+  if (last_glTexID != texid)
+  {
+    glBindTexture(GL_TEXTURE_2D, *texid);
+    last_glTexID = texid;
+    rendered_texbinds++;
+  }
+
+  return true;
+}
+
+//
+// gld_FlushAtlas
+//
+// Frees the pages holding patches of one texture table. Called when that
+// table is cleaned, so no GLTexture refers to them anymore.
+//
+void gld_FlushAtlas(dboolean is_static)
+{
+  int i, j;
+
+  for (i = 0; i < atlas_numpages; i++)
+  {
+    atlas_page_t *page = &atlas_pages[i];
+
+    if (page->is_static != is_static)
+      continue;
+
+    for (j = 0; j < page->numvariants; j++)
+    {
+      glDeleteTextures(1, &page->variants[j]->texid);
+      free(page->variants[j]->uploaded);
+      free(page->variants[j]);
+    }
+    free(page->variants);
+    free(page->slots);
+    memset(page, 0, sizeof(*page));
+  }
+
+  gld_ResetLastTexture();
+  gld_UpdateAtlasStats();
+}
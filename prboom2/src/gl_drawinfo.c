@@ -67,6 +67,10 @@ void gld_FreeDrawInfo(void)
     }
   }
 
+  free(gld_drawinfo.sort_items);
+  free(gld_drawinfo.sort_keys[0]);
+  free(gld_drawinfo.sort_keys[1]);
+
   memset(&gld_drawinfo, 0, sizeof(GLDrawInfo));
 }
 
@@ -167,3 +171,86 @@ void gld_AddDrawItem(GLDrawItemType itemtype, void *itemdata)
 }
 #undef SIZEOF8
 #undef NEWSIZE
+
+//
+// gld_GetDrawItemKeys
+//
+// Scratch array of one key per item of this type, to be filled by the
+// caller and passed on to gld_SortDrawItems
+//
+unsigned int *gld_GetDrawItemKeys(GLDrawItemType itemtype)
+{
+  int count = gld_drawinfo.num_items[itemtype];
+
+  if (count > gld_drawinfo.max_sort)
+  {
+    gld_drawinfo.max_sort = count + 256;
+    gld_drawinfo.sort_items = realloc(gld_drawinfo.sort_items,
+      gld_drawinfo.max_sort * sizeof(gld_drawinfo.sort_items[0]));
+    gld_drawinfo.sort_keys[0] = realloc(gld_drawinfo.sort_keys[0],
+      gld_drawinfo.max_sort * sizeof(gld_drawinfo.sort_keys[0][0]));
+    gld_drawinfo.sort_keys[1] = realloc(gld_drawinfo.sort_keys[1],
+      gld_drawinfo.max_sort * sizeof(gld_drawinfo.sort_keys[1][0]));
+  }
+
+  return gld_drawinfo.sort_keys[0];
+}
+
+//
+// gld_SortDrawItems
+//
+// Stable LSD radix sort of the items of one type into ascending order of
+// the keys left in gld_GetDrawItemKeys. Bytes in which all keys agree
+// cost one counting pass and no moves, so keys made of small texture
+// numbers usually need only two passes. Being stable, sorting by a minor
+// key first and a major key second gives a two-level order.
+//
+void gld_SortDrawItems(GLDrawItemType itemtype)
+{
+  int count = gld_drawinfo.num_items[itemtype];
+  GLDrawItem *items = gld_drawinfo.items[itemtype];
+  GLDrawItem *dst_items = gld_drawinfo.sort_items;
+  unsigned int *keys = gld_drawinfo.sort_keys[0];
+  unsigned int *dst_keys = gld_drawinfo.sort_keys[1];
+  int shift, i;
+
+  if (count < 2)
+    return;
+
+  for (shift = 0; shift < 32; shift += 8)
+  {
+    int offsets[256];
+    GLDrawItem *tmp_items;
+    unsigned int *tmp_keys;
+    int sum = 0;
+
+    memset(offsets, 0, sizeof(offsets));
+    for (i = 0; i < count; i++)
+      offsets[(keys[i] >> shift) & 0xff]++;
+
+    if (offsets[(keys[0] >> shift) & 0xff] == count)
+      continue;
+
+    for (i = 0; i < 256; i++)
+    {
+      int n = offsets[i];
+      offsets[i] = sum;
+      sum += n;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+      int pos = offsets[(keys[i] >> shift) & 0xff]++;
+      dst_items[pos] = items[i];
+      dst_keys[pos] = keys[i];
+    }
+
+    tmp_items = items; items = dst_items; dst_items = tmp_items;
+    tmp_keys = keys; keys = dst_keys; dst_keys = tmp_keys;
+  }
+
+  if (items != gld_drawinfo.items[itemtype])
+  {
+    memcpy(gld_drawinfo.items[itemtype], items, count * sizeof(items[0]));
+  }
+}
@@ -44,7 +44,13 @@
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <SDL.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 #ifdef HAVE_LIBSDL2_IMAGE
 #include <SDL_image.h>
 #endif
@@ -61,6 +67,7 @@
 #include "r_sky.h"
 #include "m_argv.h"
 #include "m_misc.h"
+#include "md5.h"
 #include "e6y.h"
 
 unsigned int gl_has_hires = 0;
@@ -1124,95 +1131,597 @@ static int gld_HiRes_LoadDDSTexture(GLTexture* gltexture, GLuint* texid, const c
   return result;
 }
 
-static int gld_HiRes_LoadFromCache(GLTexture* gltexture, GLuint* texid, const char* img_path)
+//
+// Hires texture cache
+//
+// Hires images that had to be resized for GL are kept, as read back from
+// GL, in one pack file, hirescache.dat next to the executable. A record
+// is keyed by the MD5 of the image path and the GL limits that decide
+// the resize, holds the size, modification time and MD5 of the image
+// file, an MD5 of its stored pixels, and is followed by the pixels, zlib
+// packed when zlib is available. A record whose image has the same size
+// and time is taken as is; when only the time differs the image is
+// hashed and the record is used, and its time brought up to date, if
+// the contents are unchanged. Records are appended; a newer record for the
+// same key supersedes the older one, and the pack is rewritten without
+// the superseded records when they make up most of it. The pack is
+// memory mapped at start and records added since are read back with
+// stdio.
+//
+
+#define HIRESCACHE_MAGIC    "PRBHIRES"
+#define HIRESCACHE_VERSION  3
+#define HIRESCACHE_HASHSIZE 4096
+#define HIRESCACHE_MAXSIZE  0x7fff0000 // offsets are longs
+#define HIRESCACHE_MINDEAD  (16*1024*1024) // not worth compacting below
+
+typedef struct
 {
-  int result = false;
-  int tex_width = 0;
-  int tex_height = 0;
-  int tex_buffer_size;
-  struct stat cache_stat;
-  struct stat tex_stat;
-  char* cache_filename;
-  FILE *cachefp;
-  unsigned char *tex_buffer;
-
-  memset(&tex_stat, 0, sizeof(tex_stat));
-  stat(img_path, &tex_stat);
-  
-  cache_filename = malloc(strlen(img_path) + 16);
-  sprintf(cache_filename, "%s.cache", img_path);
+  char magic[8];
+  int version;
+  int reserved;
+} hirescache_header_t;
 
-  cachefp = fopen(cache_filename, "rb");
-  if (cachefp)
+typedef struct
+{
+  unsigned char key[16];    // image path and GL limits
+  uint_64_t filesize;       // of the image when it was stored
+  uint_64_t filetime;
+  unsigned char content[16]; // MD5 of the image file
+} hirescache_key_t;
+
+typedef struct
+{
+  hirescache_key_t key;
+  unsigned char sum[16];    // stored pixels
+  int width, height;
+  int packedsize;           // width*height*4 when stored raw
+  unsigned int flags;       // GLTEXTURE_HASHOLES of the image
+} hirescache_record_t;
+
+typedef struct
+{
+  hirescache_record_t record;
+  long offset;              // of the pixels in the pack
+  dboolean mapped;          // pixels are in the mapping
+  int next;                 // hash chain
+} hirescache_entry_t;
+
+static hirescache_entry_t *hirescache;
+static int hirescache_num, hirescache_max;
+static int hirescache_hash[HIRESCACHE_HASHSIZE];
+
+static FILE *hirescache_fp;
+static long hirescache_end;   // where the next record goes
+static long hirescache_dead;  // bytes of superseded records
+static const byte *hirescache_map;
+static long hirescache_mapsize;
+
+static int hirescache_hits, hirescache_misses, hirescache_added;
+static double hirescache_bytesread;
+
+static int gld_HiResCacheHash(const unsigned char *key)
+{
+  return (key[0] | (key[1] << 8)) & (HIRESCACHE_HASHSIZE - 1);
+}
+
+static hirescache_entry_t *gld_HiResCacheFind(const unsigned char *key)
+{
+  int i;
+
+  for (i = hirescache_hash[gld_HiResCacheHash(key)]; i >= 0; i = hirescache[i].next)
+    if (!memcmp(hirescache[i].record.key.key, key, 16))
+      return &hirescache[i];
+
+  return NULL;
+}
+
+static void gld_HiResCacheAdd(const hirescache_record_t *record, long offset, dboolean mapped)
+{
+  hirescache_entry_t *e;
+  int hash = gld_HiResCacheHash(record->key.key);
+
+  // the image changed since the old record was written
+  if ((e = gld_HiResCacheFind(record->key.key)))
   {
-    if (fread(&tex_width, sizeof(tex_width), 1, cachefp) == 1 &&
-      fread(&tex_height, sizeof(tex_height), 1, cachefp) == 1 &&
-      fread(&cache_stat.st_mtime, sizeof(cache_stat.st_mtime), 1, cachefp) == 1)
+    hirescache_dead += sizeof(e->record) + e->record.packedsize;
+    e->record = *record;
+    e->offset = offset;
+    e->mapped = mapped;
+    return;
+  }
+
+  if (hirescache_num >= hirescache_max)
+  {
+    hirescache_max = hirescache_max ? hirescache_max * 2 : 1024;
+    hirescache = realloc(hirescache, hirescache_max * sizeof(*hirescache));
+  }
+
+  e = &hirescache[hirescache_num];
+  e->record = *record;
+  e->offset = offset;
+  e->mapped = mapped;
+  e->next = hirescache_hash[hash];
+  hirescache_hash[hash] = hirescache_num++;
+}
+
+static dboolean gld_HiResCacheValidRecord(const hirescache_record_t *r, long offset, long size)
+{
+  return r->width > 0 && r->height > 0 && r->width <= 16384 && r->height <= 16384 &&
+    r->packedsize > 0 && r->packedsize <= r->width * r->height * 4 &&
+    r->packedsize <= size - offset;
+}
+
+static void gld_HiResCacheClose(void)
+{
+#ifdef HAVE_MMAP
+  if (hirescache_map)
+    munmap((void *)hirescache_map, hirescache_mapsize);
+#endif
+  hirescache_map = NULL;
+
+  if (hirescache_fp)
+    fclose(hirescache_fp);
+  hirescache_fp = NULL;
+}
+
+// Reads the pixels of a record; *readbuf is set when they had to be read
+static const byte *gld_HiResCacheData(const hirescache_entry_t *e, byte **readbuf)
+{
+  *readbuf = NULL;
+
+  if (e->mapped)
+    return hirescache_map + e->offset;
+
+  *readbuf = malloc(e->record.packedsize);
+  fseek(hirescache_fp, e->offset, SEEK_SET);
+  if (fread(*readbuf, e->record.packedsize, 1, hirescache_fp) != 1)
+    return NULL;
+
+  return *readbuf;
+}
+
+//
+// gld_HiResCacheIndex
+//
+// Indexes the pack, starting it afresh if it is missing or outdated. A
+// damaged tail, say from a crash while appending, is written over.
+//
+static dboolean gld_HiResCacheIndex(const char *fname)
+{
+  hirescache_header_t header;
+  long size, offset;
+  int i;
+
+  for (i = 0; i < HIRESCACHE_HASHSIZE; i++)
+    hirescache_hash[i] = -1;
+  hirescache_num = 0;
+  hirescache_dead = 0;
+
+  hirescache_fp = fopen(fname, "r+b");
+  if (hirescache_fp)
+  {
+    fseek(hirescache_fp, 0, SEEK_END);
+    size = ftell(hirescache_fp);
+    fseek(hirescache_fp, 0, SEEK_SET);
+
+    if (size < (long)sizeof(header) ||
+        fread(&header, sizeof(header), 1, hirescache_fp) != 1 ||
+        memcmp(header.magic, HIRESCACHE_MAGIC, sizeof(header.magic)) ||
+        header.version != HIRESCACHE_VERSION)
     {
-      if (cache_stat.st_mtime == tex_stat.st_mtime)
-      {
-        tex_buffer_size = tex_width * tex_height * 4;
+      lprintf(LO_WARN, "gld_HiResCacheOpen: starting over outdated or damaged %s\n", fname);
+      fclose(hirescache_fp);
+      hirescache_fp = NULL;
+    }
+  }
 
-        tex_buffer = malloc(tex_buffer_size);
-        if (tex_buffer)
-        {
-          if (fread(tex_buffer, tex_buffer_size, 1, cachefp) == 1)
-          {
-            gld_HiRes_Bind(gltexture, texid);
-            gld_BuildTexture(gltexture, tex_buffer, false, tex_width, tex_height);
+  if (!hirescache_fp)
+  {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HIRESCACHE_MAGIC, sizeof(header.magic));
+    header.version = HIRESCACHE_VERSION;
 
-            result = true;
-          }
-        }
+    hirescache_fp = fopen(fname, "w+b");
+    if (!hirescache_fp || fwrite(&header, sizeof(header), 1, hirescache_fp) != 1)
+    {
+      lprintf(LO_WARN, "gld_HiResCacheOpen: can't create %s\n", fname);
+      if (hirescache_fp)
+        fclose(hirescache_fp);
+      hirescache_fp = NULL;
+      return false;
+    }
+    size = sizeof(header);
+  }
+
+#ifdef HAVE_MMAP
+  {
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(hirescache_fp), 0);
+    if (map != MAP_FAILED)
+    {
+      hirescache_map = map;
+      hirescache_mapsize = size;
+    }
+  }
+#endif
+
+  // index the records, the pixels are only read when needed
+  for (offset = sizeof(header); offset + (long)sizeof(hirescache_record_t) <= size; )
+  {
+    hirescache_record_t record;
+
+    if (hirescache_map)
+    {
+      memcpy(&record, hirescache_map + offset, sizeof(record));
+    }
+    else
+    {
+      fseek(hirescache_fp, offset, SEEK_SET);
+      if (fread(&record, sizeof(record), 1, hirescache_fp) != 1)
+        break;
+    }
+
+    offset += sizeof(record);
+    if (!gld_HiResCacheValidRecord(&record, offset, size))
+    {
+      offset -= sizeof(record);
+      break;
+    }
+
+    gld_HiResCacheAdd(&record, offset, hirescache_map != NULL);
+    offset += record.packedsize;
+  }
+  hirescache_end = offset;
+
+  return true;
+}
+
+//
+// gld_HiResCacheCompact
+//
+// Writes the live records to a new pack that replaces the open one.
+//
+static dboolean gld_HiResCacheCompact(const char *fname)
+{
+  hirescache_header_t header;
+  char *tmpname;
+  FILE *fp;
+  dboolean ok;
+  int i;
+
+  tmpname = malloc(strlen(fname) + 8);
+  sprintf(tmpname, "%s.tmp", fname);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, HIRESCACHE_MAGIC, sizeof(header.magic));
+  header.version = HIRESCACHE_VERSION;
+
+  fp = fopen(tmpname, "wb");
+  ok = fp && fwrite(&header, sizeof(header), 1, fp) == 1;
+
+  for (i = 0; ok && i < hirescache_num; i++)
+  {
+    const hirescache_entry_t *e = &hirescache[i];
+    byte *readbuf;
+    const byte *data = gld_HiResCacheData(e, &readbuf);
+
+    ok = data &&
+      fwrite(&e->record, sizeof(e->record), 1, fp) == 1 &&
+      fwrite(data, e->record.packedsize, 1, fp) == 1;
+    free(readbuf);
+  }
+
+  if (fp && fclose(fp))
+    ok = false;
+
+  if (ok)
+  {
+    // nothing may hold the old pack open while it is replaced
+    gld_HiResCacheClose();
+    remove(fname);
+    ok = !rename(tmpname, fname);
+  }
+
+  if (!ok)
+  {
+    lprintf(LO_WARN, "gld_HiResCacheCompact: can't rewrite %s\n", fname);
+    remove(tmpname);
+  }
+
+  free(tmpname);
+  return ok;
+}
+
+//
+// gld_HiResCacheOpen
+//
+static dboolean gld_HiResCacheOpen(void)
+{
+  static dboolean initialized;
+  char *fname;
+  dboolean result;
+
+  if (initialized)
+    return hirescache_fp != NULL;
+  initialized = true;
+
+  fname = malloc(strlen(I_DoomExeDir()) + 32);
+  sprintf(fname, "%s/hirescache.dat", I_DoomExeDir());
+
+  result = gld_HiResCacheIndex(fname);
+
+  if (result && hirescache_dead > HIRESCACHE_MINDEAD && hirescache_dead * 2 > hirescache_end)
+  {
+    long dead = hirescache_dead;
+
+    if (gld_HiResCacheCompact(fname))
+      lprintf(LO_INFO, "gld_HiResCacheOpen: dropped %ld KB of superseded textures\n", dead >> 10);
+
+    // the old pack is closed once it has been replaced
+    if (!hirescache_fp)
+      result = gld_HiResCacheIndex(fname);
+  }
+
+  free(fname);
+
+  if (!result)
+    return false;
+
+  atexit(gld_HiResCacheClose);
+
+  lprintf(LO_INFO, "gld_HiResCacheOpen: %d cached hires textures\n", hirescache_num);
+  return true;
+}
+
+// MD5 of the image path and what decides the size it ends up at in GL;
+// the size and time of the file tell whether a record is still current
+// without reading it
+static dboolean gld_HiResCacheKey(const char *img_path, hirescache_key_t *key)
+{
+  struct MD5Context md5;
+  struct stat st;
+  int limits[2];
+
+  if (stat(img_path, &st))
+    return false;
+
+  limits[0] = gl_max_texture_size;
+  limits[1] = gl_arb_texture_non_power_of_two;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const md5byte *)img_path, strlen(img_path));
+  MD5Update(&md5, (const md5byte *)limits, sizeof(limits));
+  MD5Final(key->key, &md5);
+
+  key->filesize = (uint_64_t)st.st_size;
+  key->filetime = (uint_64_t)st.st_mtime;
+  return true;
+}
+
+// MD5 of the bytes of the image file
+static dboolean gld_HiResCacheFileMD5(const char *img_path, unsigned char *content)
+{
+  struct MD5Context md5;
+  unsigned char buf[16384];
+  size_t len;
+  FILE *fp;
+  int error;
+
+  fp = fopen(img_path, "rb");
+  if (!fp)
+    return false;
+
+  MD5Init(&md5);
+  while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    MD5Update(&md5, buf, len);
+  MD5Final(content, &md5);
+
+  error = ferror(fp);
+  fclose(fp);
+  return !error;
+}
+
+// Same size and time is taken on trust. A different size means the image
+// changed; a different time alone, as after a copy or a checkout, has the
+// image hashed and compared with the MD5 in the record, and if they match
+// the record gets the new time so the next check is cheap again.
+static dboolean gld_HiResCacheCurrent(hirescache_entry_t *e, const hirescache_key_t *key, const char *img_path)
+{
+  unsigned char content[16];
+
+  if (e->record.key.filesize != key->filesize)
+    return false;
+
+  if (e->record.key.filetime == key->filetime)
+    return true;
+
+  if (!gld_HiResCacheFileMD5(img_path, content) ||
+      memcmp(content, e->record.key.content, sizeof(content)))
+    return false;
+
+  e->record.key.filetime = key->filetime;
+  if (hirescache_fp)
+  {
+    fseek(hirescache_fp, e->offset - sizeof(e->record), SEEK_SET);
+    if (fwrite(&e->record, sizeof(e->record), 1, hirescache_fp) != 1 ||
+        fflush(hirescache_fp) != 0)
+      lprintf(LO_WARN, "gld_HiResCacheCurrent: error updating '%s' in the cache.\n", img_path);
+  }
+
+  return true;
+}
+
+static int gld_HiRes_LoadFromCache(GLTexture* gltexture, GLuint* texid, const char* img_path, hirescache_key_t *key)
+{
+  struct MD5Context md5;
+  unsigned char sum[16];
+  hirescache_entry_t *e;
+  const hirescache_record_t *r;
+  const byte *packed;
+  byte *readbuf;
+  unsigned char *tex_buffer = NULL;
+  int tex_buffer_size;
+
+  memset(key, 0, sizeof(*key));
+  if (!gld_HiResCacheOpen() || !gld_HiResCacheKey(img_path, key))
+    return false;
+
+  e = gld_HiResCacheFind(key->key);
+  if (!e || !gld_HiResCacheCurrent(e, key, img_path))
+  {
+    hirescache_misses++;
+    return false;
+  }
+  r = &e->record;
+  tex_buffer_size = r->width * r->height * 4;
+
+  packed = gld_HiResCacheData(e, &readbuf);
+  hirescache_bytesread += r->packedsize;
+
+  if (packed)
+  {
+    MD5Init(&md5);
+    MD5Update(&md5, packed, r->packedsize);
+    MD5Final(sum, &md5);
+  }
+
+  if (packed && !memcmp(sum, r->sum, sizeof(sum)))
+  {
+    if (r->packedsize == tex_buffer_size)
+    {
+      tex_buffer = malloc(tex_buffer_size);
+      memcpy(tex_buffer, packed, tex_buffer_size);
+    }
+#ifdef HAVE_LIBZ
+    else
+    {
+      uLongf unpacked = tex_buffer_size;
+
+      tex_buffer = malloc(tex_buffer_size);
+      if (uncompress(tex_buffer, &unpacked, packed, r->packedsize) != Z_OK ||
+          unpacked != (uLongf)tex_buffer_size)
+      {
+        free(tex_buffer);
+        tex_buffer = NULL;
       }
     }
-    fclose(cachefp);
+#endif
   }
 
-  free(cache_filename);
+  free(readbuf);
 
-  return result;
+  if (!tex_buffer)
+  {
+    lprintf(LO_WARN, "gld_HiRes_LoadFromCache: damaged cache record for '%s'\n", img_path);
+    hirescache_misses++;
+    return false;
+  }
+
+  gltexture->flags = (gltexture->flags & ~GLTEXTURE_HASHOLES) | (r->flags & GLTEXTURE_HASHOLES);
+  gld_HiRes_Bind(gltexture, texid);
+  gld_BuildTexture(gltexture, tex_buffer, false, r->width, r->height);
+  hirescache_hits++;
+
+  return true;
 }
 
-static int gld_HiRes_WriteCache(GLTexture* gltexture, GLuint* texid, const char* img_path)
+static int gld_HiRes_WriteCache(GLTexture* gltexture, GLuint* texid, const char* img_path, const hirescache_key_t *key)
 {
+  hirescache_entry_t *e;
+  struct MD5Context md5;
+  hirescache_record_t record;
+  const unsigned char *out;
+  unsigned char *packed = NULL;
+  unsigned char *buf;
   int result = false;
   int w, h;
-  unsigned char *buf;
-  unsigned char cache_filename[PATH_MAX];
-  struct stat tex_stat;
-  FILE *cachefp;
 
-  doom_snprintf(cache_filename, sizeof(cache_filename), "%s.cache", img_path);
-  if (access(cache_filename, F_OK))
+  if (!hirescache_fp)
+    return false;
+
+  if ((e = gld_HiResCacheFind(key->key)) && gld_HiResCacheCurrent(e, key, img_path))
+    return false;
+
+  // hashed here rather than with the key: only images that get written
+  // need it, and reading the file costs little next to decoding it
+  memset(&record, 0, sizeof(record));
+  record.key = *key;
+  if (!gld_HiResCacheFileMD5(img_path, record.key.content))
+    return false;
+
+  buf = gld_GetTextureBuffer(*texid, 0, &w, &h);
+  if (!buf)
+    return false;
+
+  record.width = w;
+  record.height = h;
+  record.flags = gltexture->flags & GLTEXTURE_HASHOLES;
+  record.packedsize = w * h * 4;
+  out = buf;
+
+#ifdef HAVE_LIBZ
   {
-    buf = gld_GetTextureBuffer(*texid, 0, &w, &h);
-    if (buf)
-    {
-      memset(&tex_stat, 0, sizeof(tex_stat));
-      stat(img_path, &tex_stat);
-      cachefp = fopen(cache_filename, "wb");
-      if (cachefp)
-      {
-        result =
-          (fwrite(&w, sizeof(w), 1, cachefp) == 1) &&
-          (fwrite(&h, sizeof(h), 1, cachefp) == 1) &&
-          (fwrite(&tex_stat.st_mtime, sizeof(tex_stat.st_mtime), 1, cachefp) == 1) &&
-          (fwrite(buf, w * h * 4, 1, cachefp) == 1);
+    // fastest level: reading it back is what matters
+    uLongf packedsize = compressBound(record.packedsize);
 
-         fclose(cachefp);
-      }
+    packed = malloc(packedsize);
+    if (compress2(packed, &packedsize, buf, record.packedsize, Z_BEST_SPEED) == Z_OK &&
+        packedsize < (uLongf)record.packedsize)
+    {
+      record.packedsize = (int)packedsize;
+      out = packed;
     }
   }
+#endif
 
-  if (!result)
+  MD5Init(&md5);
+  MD5Update(&md5, out, record.packedsize);
+  MD5Final(record.sum, &md5);
+
+  if (hirescache_end + (long)sizeof(record) + record.packedsize <= HIRESCACHE_MAXSIZE)
   {
-    lprintf(LO_WARN, "gld_HiRes_WriteCache: error writing '%s'.\n", cache_filename);
+    fseek(hirescache_fp, hirescache_end, SEEK_SET);
+    result =
+      fwrite(&record, sizeof(record), 1, hirescache_fp) == 1 &&
+      fwrite(out, record.packedsize, 1, hirescache_fp) == 1 &&
+      fflush(hirescache_fp) == 0;
+
+    if (result)
+    {
+      gld_HiResCacheAdd(&record, hirescache_end + sizeof(record), false);
+      hirescache_end += sizeof(record) + record.packedsize;
+      hirescache_added++;
+    }
+    else
+    {
+      lprintf(LO_WARN, "gld_HiRes_WriteCache: error writing '%s' to the cache.\n", img_path);
+    }
   }
 
+  free(packed);
   return result;
 }
 
+//
+// gld_HiResCacheStats
+//
+// Printed and reset by gld_Precache at level start.
+//
+void gld_HiResCacheStats(void)
+{
+  int lookups = hirescache_hits + hirescache_misses;
+
+  if (!lookups && !hirescache_added)
+    return;
+
+  lprintf(LO_INFO, "gld_HiResCacheStats: %d of %d hits (%d%%), %d added, %.1f MB read\n",
+          hirescache_hits, lookups, lookups ? hirescache_hits * 100 / lookups : 0,
+          hirescache_added, hirescache_bytesread / (1024 * 1024));
+
+  hirescache_hits = hirescache_misses = hirescache_added = 0;
+  hirescache_bytesread = 0;
+}
+
 static int gld_HiRes_LoadFromFile(GLTexture* gltexture, GLuint* texid, const char* img_path)
 {
   int result = false;
@@ -1324,14 +1833,16 @@ int gld_LoadHiresTex(GLTexture *gltexture, int cm)
         {
           if (!gld_HiRes_LoadDDSTexture(gltexture, texid, dds_path))
           {
-            if (!gld_HiRes_LoadFromCache(gltexture, texid, img_path))
+            hirescache_key_t key;
+
+            if (!gld_HiRes_LoadFromCache(gltexture, texid, img_path, &key))
             {
               if (gld_HiRes_LoadFromFile(gltexture, texid, img_path))
               {
                 if ((gltexture->realtexwidth != gltexture->tex_width) ||
                   (gltexture->realtexheight != gltexture->tex_height))
                 {
-                  gld_HiRes_WriteCache(gltexture, texid, img_path);
+                  gld_HiRes_WriteCache(gltexture, texid, img_path, &key);
                 }
               }
             }
@@ -1458,7 +1969,7 @@ int gld_PrecacheGUIPatches(void)
       gltexture = gld_RegisterPatch(lump, CR_DEFAULT, false);
       if (gltexture)
       {
-        gld_BindPatch(gltexture, CR_DEFAULT);
+        gld_BindAtlasPatch(gltexture, CR_DEFAULT);
         if (gltexture && (gltexture->flags & GLTEXTURE_HIRES))
         {
           gld_ProgressUpdate("Loading GUI Patches...", ++count, total);
@@ -72,10 +72,17 @@
 #endif
 
 #include <SDL.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #include "doomstat.h"
 #include "v_video.h"
+#include "gl_opengl.h"
 #include "gl_intern.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "md5.h"
 
 int gl_texture_hqresize;
 const char *gl_hqresizemodes[hq_scale_max] = {
@@ -180,12 +187,18 @@ static void scale3x ( unsigned int* inputBuffer, unsigned int* outputBuffer, int
 
 static void scale4x ( unsigned int* inputBuffer, unsigned int* outputBuffer, int inWidth, int inHeight, int seamlessWidth, int seamlessHeight )
 {
-  unsigned int * buffer2x = malloc((2 * inWidth) * (2 * inHeight) * sizeof(unsigned int));
+  // also runs on the upscale thread, so bypass the zone
+  unsigned int * buffer2x = (malloc)((2 * inWidth) * (2 * inHeight) * sizeof(unsigned int));
   scale2x (inputBuffer, buffer2x, inWidth, inHeight, seamlessWidth, seamlessHeight);
   scale2x (buffer2x, outputBuffer, 2 * inWidth, 2 * inHeight, seamlessWidth, seamlessHeight);
-  free(buffer2x);
+  (free)(buffer2x);
 }
 
+static void (*const scale_functions[hq_scale_max])(unsigned int*, unsigned int*, int, int, int, int) =
+{
+  NULL, scale2x, scale3x, scale4x
+};
+
 
 static unsigned char *HQScaleHelper( void (*scaleNxFunction) ( unsigned int* , unsigned int* , int , int, int, int),
                                     const int N,
@@ -209,6 +222,370 @@ static unsigned char *HQScaleHelper( void (*scaleNxFunction) ( unsigned int* , u
   return newBuffer;
 }
 
+//===========================================================================
+//
+// Upscale cache
+//
+// With gl_texture_hqresize_cache, upscaled buffers are kept in
+// I_DoomExeDir as hq_<key>.dat, the key being the MD5 of the input RGBA,
+// its size, the scale mode and the seamless flags, so a different
+// texture, colormap or palette gets a file of its own. Nothing is ever
+// deleted, which is why the cache is off by default; the files can be
+// removed at any time. With gl_texture_hqresize_async a missing buffer is
+// upscaled on a worker thread; the texture is bound unscaled meanwhile
+// and rebuilt by gld_HQResizeUpdate once the worker is done.
+//
+//===========================================================================
+
+#define HQCACHE_MAGIC 0x31525148 // "HQR1"
+
+typedef unsigned char hqkey_t[16];
+
+typedef struct hqjob_s
+{
+  struct hqjob_s *next;
+  hqkey_t key;
+  unsigned int *input;    // (malloc)'ed copy of the input, freed by the worker
+  unsigned char *result;  // (malloc)'ed by the worker
+  int width, height;      // of the input
+  int scale_mode, sw, sh;
+  GLuint *texid_p;        // texture to rebuild, and its name when queued
+  GLuint texid;
+  int generation;
+} hqjob_t;
+
+static char *hqcache_dir;
+
+static SDL_Thread *hq_thread;
+static SDL_mutex *hq_mutex;
+static SDL_sem *hq_sem;
+static SDL_atomic_t hq_quit;
+static hqjob_t *hq_pending, **hq_pending_tail = &hq_pending; // by hq_mutex
+static hqjob_t *hq_done;                                     // by hq_mutex
+static hqjob_t *hq_ready; // taken from hq_done, waiting to be bound
+static int hq_generation; // bumped whenever GLTextures are freed
+
+static void gld_HQMakeKey(hqkey_t key, const unsigned char *buffer,
+                          int width, int height, int scale_mode, int sw, int sh)
+{
+  struct MD5Context md5;
+  int params[5];
+
+  params[0] = width;
+  params[1] = height;
+  params[2] = scale_mode;
+  params[3] = sw;
+  params[4] = sh;
+
+  MD5Init(&md5);
+  MD5Update(&md5, buffer, width * height * 4);
+  MD5Update(&md5, (const md5byte *)params, sizeof(params));
+  MD5Final(key, &md5);
+}
+
+static void gld_HQCacheName(char *name, size_t size, const hqkey_t key)
+{
+  char hex[33];
+  int i;
+
+  for (i = 0; i < 16; i++)
+    sprintf(hex + i * 2, "%02x", key[i]);
+  doom_snprintf(name, size, "%s/hq_%s.dat", hqcache_dir, hex);
+}
+
+//
+// gld_HQWriteCache
+//
+// Called from the worker as well, so it stays off the zone. Header is
+// magic, width, height and the zlib packed size (0 when stored raw).
+//
+static void gld_HQWriteCache(const hqkey_t key, const unsigned char *data, int width, int height)
+{
+  char name[PATH_MAX], tmpname[PATH_MAX];
+  int header[4];
+  int size = width * height * 4;
+  const unsigned char *out = data;
+  unsigned char *packed = NULL;
+  FILE *f;
+
+  header[0] = HQCACHE_MAGIC;
+  header[1] = width;
+  header[2] = height;
+  header[3] = 0;
+
+#ifdef HAVE_LIBZ
+  {
+    uLongf packedsize = compressBound(size);
+
+    packed = (malloc)(packedsize);
+    if (packed && compress2(packed, &packedsize, data, size, Z_BEST_SPEED) == Z_OK)
+    {
+      out = packed;
+      header[3] = size = (int)packedsize;
+    }
+  }
+#endif
+
+  // written under another name first, so a half written file is never read
+  gld_HQCacheName(name, sizeof(name), key);
+  doom_snprintf(tmpname, sizeof(tmpname), "%s.tmp", name);
+  if ((f = fopen(tmpname, "wb")))
+  {
+    int ok = fwrite(header, sizeof(header), 1, f) == 1 && fwrite(out, size, 1, f) == 1;
+
+    if (fclose(f) == 0 && ok)
+    {
+      remove(name);
+      rename(tmpname, name);
+    }
+    else
+      remove(tmpname);
+  }
+
+  (free)(packed);
+}
+
+static unsigned char *gld_HQReadCache(const hqkey_t key, int *width, int *height)
+{
+  char name[PATH_MAX];
+  unsigned char *result = NULL;
+  int header[4];
+  FILE *f;
+
+  gld_HQCacheName(name, sizeof(name), key);
+  if (!(f = fopen(name, "rb")))
+    return NULL;
+
+  if (fread(header, sizeof(header), 1, f) == 1 && header[0] == HQCACHE_MAGIC &&
+      header[1] > 0 && header[2] > 0 && header[1] <= 4096 && header[2] <= 4096)
+  {
+    int size = header[1] * header[2] * 4;
+
+    result = malloc(size);
+    if (!header[3])
+    {
+      if (fread(result, size, 1, f) != 1)
+        Z_Free(result), result = NULL;
+    }
+    else
+    {
+#ifdef HAVE_LIBZ
+      unsigned char *packed = malloc(header[3]);
+      uLongf unpackedsize = size;
+
+      if (fread(packed, header[3], 1, f) != 1 ||
+          uncompress(result, &unpackedsize, packed, header[3]) != Z_OK ||
+          unpackedsize != (uLongf)size)
+        Z_Free(result), result = NULL;
+      Z_Free(packed);
+#else
+      Z_Free(result), result = NULL;
+#endif
+    }
+  }
+  fclose(f);
+
+  if (result)
+  {
+    *width = header[1];
+    *height = header[2];
+  }
+  return result;
+}
+
+static void gld_FreeHQJob(hqjob_t *job)
+{
+  (free)(job->input);
+  (free)(job->result);
+  (free)(job);
+}
+
+static int gld_HQWorker(void *unused)
+{
+  while (1)
+  {
+    hqjob_t *job;
+    int n;
+
+    SDL_SemWait(hq_sem);
+    if (SDL_AtomicGet(&hq_quit))
+      return 0;
+
+    SDL_LockMutex(hq_mutex);
+    if ((job = hq_pending) && !(hq_pending = job->next))
+      hq_pending_tail = &hq_pending;
+    SDL_UnlockMutex(hq_mutex);
+
+    if (!job)
+      continue;
+
+    n = job->scale_mode + 1;
+    job->result = (malloc)(job->width * n * job->height * n * 4);
+    if (job->result)
+    {
+      scale_functions[job->scale_mode](job->input, (unsigned int *)job->result,
+                                       job->width, job->height, job->sw, job->sh);
+      if (gl_texture_hqresize_cache)
+        gld_HQWriteCache(job->key, job->result, job->width * n, job->height * n);
+    }
+    (free)(job->input);
+    job->input = NULL;
+
+    SDL_LockMutex(hq_mutex);
+    job->next = hq_done;
+    hq_done = job;
+    SDL_UnlockMutex(hq_mutex);
+  }
+}
+
+static void gld_HQStopWorker(void)
+{
+  if (hq_thread)
+  {
+    SDL_AtomicSet(&hq_quit, 1);
+    SDL_SemPost(hq_sem);
+    SDL_WaitThread(hq_thread, NULL);
+    hq_thread = NULL;
+  }
+}
+
+static dboolean gld_HQStartWorker(void)
+{
+  static dboolean failed;
+
+  if (hq_thread || failed)
+    return !failed;
+
+  hq_mutex = SDL_CreateMutex();
+  hq_sem = SDL_CreateSemaphore(0);
+  if (hq_mutex && hq_sem)
+    hq_thread = SDL_CreateThread(gld_HQWorker, "hqresize_thread", NULL);
+
+  if (!hq_thread)
+  {
+    lprintf(LO_WARN, "gld_HQStartWorker: upscaling on the main thread\n");
+    failed = true;
+    return false;
+  }
+
+  atexit(gld_HQStopWorker);
+  return true;
+}
+
+//
+// gld_HQResizeUpdate
+//
+// Once a frame: drops the GL textures whose upscale has finished, so the
+// next bind picks the result up.
+//
+void gld_HQResizeUpdate(void)
+{
+  hqjob_t *job, *next;
+
+  if (!hq_thread)
+    return;
+
+  SDL_LockMutex(hq_mutex);
+  job = hq_done;
+  hq_done = NULL;
+  SDL_UnlockMutex(hq_mutex);
+
+  for (; job; job = next)
+  {
+    next = job->next;
+    if (job->result && job->generation == hq_generation &&
+        *job->texid_p == job->texid)
+    {
+      glDeleteTextures(1, job->texid_p);
+      *job->texid_p = 0;
+      job->next = hq_ready;
+      hq_ready = job;
+      gld_ResetLastTexture();
+    }
+    else
+    {
+      gld_FreeHQJob(job);
+    }
+  }
+}
+
+//
+// gld_HQResizeFlush
+//
+// GLTextures are about to be freed; upscales still in flight keep their
+// place in the disk cache but won't touch their texture.
+//
+void gld_HQResizeFlush(void)
+{
+  hq_generation++;
+
+  while (hq_ready)
+  {
+    hqjob_t *next = hq_ready->next;
+    gld_FreeHQJob(hq_ready);
+    hq_ready = next;
+  }
+}
+
+// Takes a finished upscale of the buffer with this key, if there is one
+static unsigned char *gld_HQTakeReady(const hqkey_t key, int *width, int *height)
+{
+  hqjob_t **link, *job;
+  unsigned char *result;
+  int n, size;
+
+  for (link = &hq_ready; (job = *link); link = &job->next)
+    if (!memcmp(job->key, key, sizeof(hqkey_t)))
+      break;
+
+  if (!job)
+    return NULL;
+
+  n = job->scale_mode + 1;
+  *width = job->width * n;
+  *height = job->height * n;
+  size = *width * *height * 4;
+  result = malloc(size);
+  memcpy(result, job->result, size);
+
+  *link = job->next;
+  gld_FreeHQJob(job);
+  return result;
+}
+
+static void gld_HQQueue(GLTexture *gltexture, const hqkey_t key, const unsigned char *inputBuffer,
+                        int inWidth, int inHeight, int scale_mode, int sw, int sh)
+{
+  hqjob_t *job = (malloc)(sizeof(*job));
+
+  if (!job)
+    return;
+  if (!(job->input = (malloc)(inWidth * inHeight * 4)))
+  {
+    (free)(job);
+    return;
+  }
+
+  memcpy(job->key, key, sizeof(hqkey_t));
+  memcpy(job->input, inputBuffer, inWidth * inHeight * 4);
+  job->result = NULL;
+  job->width = inWidth;
+  job->height = inHeight;
+  job->scale_mode = scale_mode;
+  job->sw = sw;
+  job->sh = sh;
+  job->texid_p = gltexture->texid_p;
+  job->texid = *gltexture->texid_p;
+  job->generation = hq_generation;
+  job->next = NULL;
+
+  SDL_LockMutex(hq_mutex);
+  *hq_pending_tail = job;
+  hq_pending_tail = &job->next;
+  SDL_UnlockMutex(hq_mutex);
+  SDL_SemPost(hq_sem);
+}
+
 //===========================================================================
 // 
 // [BB] Upsamples the texture in inputBuffer, frees inputBuffer and returns
@@ -262,17 +639,47 @@ unsigned char* gld_HQResize(GLTexture *gltexture, unsigned char *inputBuffer, in
     break;
   }
 
-  switch (scale_mode)
+  if (scale_mode <= hq_scale_none || scale_mode >= hq_scale_max)
+    return result;
+
+  if (gl_texture_hqresize_cache || gl_texture_hqresize_async)
   {
-  case hq_scale_2x:
-    result = HQScaleHelper(&scale2x, 2, inputBuffer, inWidth, inHeight, &w, &h, sw, sh);
-    break;
-  case hq_scale_3x:
-    result = HQScaleHelper(&scale3x, 3, inputBuffer, inWidth, inHeight, &w, &h, sw, sh);
-    break;
-  case hq_scale_4x:
-    result = HQScaleHelper(&scale4x, 4, inputBuffer, inWidth, inHeight, &w, &h, sw, sh);
-    break;
+    hqkey_t key;
+    unsigned char *cached;
+
+    if (!hqcache_dir)
+      hqcache_dir = strdup(I_DoomExeDir());
+
+    gld_HQMakeKey(key, inputBuffer, inWidth, inHeight, scale_mode, sw, sh);
+
+    cached = gld_HQTakeReady(key, &w, &h);
+    if (!cached && gl_texture_hqresize_cache)
+      cached = gld_HQReadCache(key, &w, &h);
+
+    if (cached)
+    {
+      free(inputBuffer);
+      result = cached;
+    }
+    else if (gl_texture_hqresize_async && gltexture->texid_p &&
+             *gltexture->texid_p && gld_HQStartWorker())
+    {
+      // bound unscaled for now, gld_HQResizeUpdate has it rebuilt
+      gld_HQQueue(gltexture, key, inputBuffer, inWidth, inHeight, scale_mode, sw, sh);
+      return result;
+    }
+    else
+    {
+      result = HQScaleHelper(scale_functions[scale_mode], scale_mode + 1,
+                             inputBuffer, inWidth, inHeight, &w, &h, sw, sh);
+      if (gl_texture_hqresize_cache)
+        gld_HQWriteCache(key, result, w, h);
+    }
+  }
+  else
+  {
+    result = HQScaleHelper(scale_functions[scale_mode], scale_mode + 1,
+                           inputBuffer, inWidth, inHeight, &w, &h, sw, sh);
   }
 
   if (result != inputBuffer)
@@ -119,6 +119,13 @@ typedef struct
   unsigned int flags;
   float scalexfac, scaleyfac; //e6y: right/bottom UV coordinates for patch drawing
 
+  // atlas placement, see gl_atlas.c
+  int atlas_page;             // page number + 1, 0 if the patch is not in an atlas
+  int atlas_slot;
+  int atlas_x, atlas_y;
+  float atlas_u1, atlas_v1;   // UV coordinates inside the page
+  float atlas_u2, atlas_v2;
+
   //detail
   detail_t *detail;
   float detail_width, detail_height;
@@ -314,6 +321,11 @@ typedef struct
   GLDrawItem *items[GLDIT_TYPES];
   int num_items[GLDIT_TYPES];
   int max_items[GLDIT_TYPES];
+
+  // scratch space of gld_SortDrawItems, kept between frames
+  GLDrawItem *sort_items;
+  unsigned int *sort_keys[2];
+  int max_sort;
 } GLDrawInfo;
 
 void gld_AddDrawItem(GLDrawItemType itemtype, void *itemdata);
@@ -335,6 +347,8 @@ extern int gl_preprocessed; //e6y
 extern GLDrawInfo gld_drawinfo;
 void gld_FreeDrawInfo(void);
 void gld_ResetDrawInfo(void);
+unsigned int *gld_GetDrawItemKeys(GLDrawItemType itemtype);
+void gld_SortDrawItems(GLDrawItemType itemtype);
 
 extern GLSector *sectorloops;
 extern GLMapSubsector *subsectorloops;
@@ -387,6 +401,13 @@ void gld_InitPalettedTextures(void);
 int gld_GetTexDimension(int value);
 void gld_SetTexturePalette(GLenum target);
 void gld_Precache(void);
+void gld_AddPatchToTexture(GLTexture *gltexture, unsigned char *buffer, const rpatch_t *patch, int originx, int originy, int cm, int paletted);
+
+//atlas
+void gld_AddPatchToAtlas(GLTexture *gltexture, dboolean is_static);
+GLuint *gld_GetAtlasPatch(GLTexture *gltexture, int cm);
+dboolean gld_BindAtlasPatch(GLTexture *gltexture, int cm);
+void gld_FlushAtlas(dboolean is_static);
 
 void SetFrameTextureMode(void);
 
@@ -397,6 +418,7 @@ void gld_ResetGammaRamp(void);
 void gld_SplitLeftEdge(const GLWall *wall, dboolean detail);
 void gld_SplitRightEdge(const GLWall *wall, dboolean detail);
 void gld_RecalcVertexHeights(const vertex_t *v);
+int gld_GetVertexSplitHeights(const vertex_t *v, const float **heightlist);
 
 //e6y
 void gld_InitGLVersion(void);
@@ -410,6 +432,7 @@ int gld_BuildTexture(GLTexture *gltexture, void *data, dboolean readonly, int wi
 extern unsigned int gl_has_hires;
 int gld_HiRes_BuildTables(void);
 void gld_InitHiRes(void);
+void gld_HiResCacheStats(void);
 int gld_LoadHiresTex(GLTexture *gltexture, int cm);
 void gld_GetTextureTexID(GLTexture *gltexture, int cm);
 GLuint CaptureScreenAsTexID(void);
@@ -450,6 +473,7 @@ void gld_SetupFloodedPlaneLight(GLWall *wall);
 //light
 extern int gl_rellight;
 void gld_StaticLightAlpha(float light, float alpha);
+void gld_StaticLightColor(float light, float alpha, GLfloat *rgba);
 #define gld_StaticLight(light) gld_StaticLightAlpha(light, 1.0f)
 void gld_InitLightTable(void);
 typedef float (*gld_CalcLightLevel_f)(int lightlevel);
@@ -467,6 +491,8 @@ extern gld_CalcFogDensity_f gld_CalcFogDensity;
 
 //HQ resize
 unsigned char* gld_HQResize(GLTexture *gltexture, unsigned char *inputBuffer, int inWidth, int inHeight, int *outWidth, int *outHeight);
+void gld_HQResizeUpdate(void);
+void gld_HQResizeFlush(void);
 
 // SkyBox
 #define SKY_NONE    0
@@ -536,6 +562,14 @@ typedef struct vbo_xy_uv_rgba_s
   unsigned char r, g, b, a;
 } PACKEDATTR vbo_xy_uv_rgba_t;
 
+typedef struct vbo_xyz_uv_rgba_s
+{
+  float x, y, z;
+  float u, v;
+  unsigned char r, g, b, a;
+} PACKEDATTR vbo_xyz_uv_rgba_t;
+#define NULL_VBO_XYZ_UV_RGBA ((vbo_xyz_uv_rgba_t*)NULL)
+
 //BoxSkybox
 typedef struct box_skybox_s
 {
@@ -263,36 +263,52 @@ static float gld_CalcLightLevel_shaders(int lightlevel)
   return (float)light/255.0f;
 }
 
-void gld_StaticLightAlpha(float light, float alpha)
+// The colour gld_StaticLightAlpha would set, for callers that put it
+// into vertex arrays instead
+void gld_StaticLightColor(float light, float alpha, GLfloat *rgba)
 {
   player_t *player = &players[displayplayer];
   int shaders = (gl_lightmode == gl_lightmode_shaders);
 
+  rgba[3] = alpha;
+
   if (!player->fixedcolormap)
   {
     float ll = (shaders ? 1.0f : light);
-    glColor4f(ll, ll, ll, alpha);
+    rgba[0] = rgba[1] = rgba[2] = ll;
   }
   else
   {
     if (!(invul_method & INVUL_BW))
     {
-      glColor4f(1.0f, 1.0f, 1.0f, alpha);
+      rgba[0] = rgba[1] = rgba[2] = 1.0f;
     }
     else
     {
 #ifdef USE_FBO_TECHNIQUE
       if (SceneInTexture)
       {
-        glColor4f(0.5f, 0.5f, 0.5f, alpha);
+        rgba[0] = rgba[1] = rgba[2] = 0.5f;
       }
       else
 #endif
       {
-        glColor4f(bw_red, bw_green, bw_blue, alpha);
+        rgba[0] = bw_red;
+        rgba[1] = bw_green;
+        rgba[2] = bw_blue;
       }
     }
   }
+}
+
+void gld_StaticLightAlpha(float light, float alpha)
+{
+  player_t *player = &players[displayplayer];
+  int shaders = (gl_lightmode == gl_lightmode_shaders);
+  GLfloat rgba[4];
+
+  gld_StaticLightColor(light, alpha, rgba);
+  glColor4fv(rgba);
 
   if (shaders)
   {
@@ -85,6 +85,8 @@ int scene_has_overlapped_sprites;
 int gl_blend_animations;
 
 int gl_use_display_lists;
+int gl_batch_walls;
+int gl_sort_radix;
 int flats_display_list;
 int flats_display_list_size = 0;
 int flats_detail_display_list;
@@ -624,6 +626,197 @@ void gld_DrawTriangleStrip(GLWall *wall, gl_strip_coords_t *c)
   glEnd();
 }
 
+/*****************
+ *               *
+ * Patch batches *
+ *               *
+ *****************/
+
+// Sprites and HUD patches that live in a texture atlas share a few page
+// textures. Between gld_BeginPatchBatch and gld_EndPatchBatch their quads
+// are gathered as triangles and drawn with one glDrawArrays per run on
+// the same page, fog and shader light level, with the light in the vertex
+// colour. A patch or sprite that can't be batched flushes the batch before
+// it is drawn; nothing else may be drawn in between.
+
+static void gld_SetQuadVertex(vbo_xyz_uv_rgba_t *v,
+  float x, float y, float z, float u, float tv, const unsigned char *rgba)
+{
+  v->x = x;
+  v->y = y;
+  v->z = z;
+  v->u = u;
+  v->v = tv;
+  v->r = rgba[0];
+  v->g = rgba[1];
+  v->b = rgba[2];
+  v->a = rgba[3];
+}
+
+#if defined(USE_VERTEX_ARRAYS) || defined(USE_VBO)
+static struct
+{
+  int depth;            // of nested gld_BeginPatchBatch
+  dboolean scene;       // drawing sprites: fog and light level apply
+  dboolean arrays;      // gld_DrawScene has the flats arrays set up
+
+  GLuint *texid;
+  float fogdensity;
+  float lightlevel;
+
+  vbo_xyz_uv_rgba_t *data;
+  int count, capacity;
+
+  GLuint vbo_id;
+} patchbatch;
+
+#define gld_PatchBatching() (patchbatch.depth > 0)
+
+static void gld_FlushPatchBatch(void)
+{
+  vbo_xyz_uv_rgba_t *base;
+
+  if (!patchbatch.count)
+    return;
+
+  if (patchbatch.scene)
+  {
+    gld_SetFog(patchbatch.fogdensity);
+    if (gl_lightmode == gl_lightmode_shaders)
+    {
+      glsl_SetLightLevel(patchbatch.lightlevel);
+    }
+  }
+
+  if (last_glTexID != patchbatch.texid)
+  {
+    glBindTexture(GL_TEXTURE_2D, *patchbatch.texid);
+    last_glTexID = patchbatch.texid;
+    rendered_texbinds++;
+  }
+
+  if (!patchbatch.arrays)
+  {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  }
+
+  if (gl_ext_arb_vertex_buffer_object)
+  {
+    if (!patchbatch.vbo_id)
+      GLEXT_glGenBuffersARB(1, &patchbatch.vbo_id);
+    GLEXT_glBindBufferARB(GL_ARRAY_BUFFER, patchbatch.vbo_id);
+    GLEXT_glBufferDataARB(GL_ARRAY_BUFFER,
+      patchbatch.count * sizeof(patchbatch.data[0]),
+      patchbatch.data, GL_STREAM_DRAW_ARB);
+    base = NULL_VBO_XYZ_UV_RGBA;
+  }
+  else
+  {
+    base = patchbatch.data;
+  }
+
+  glVertexPointer(3, GL_FLOAT, sizeof(patchbatch.data[0]), &base->x);
+  glTexCoordPointer(2, GL_FLOAT, sizeof(patchbatch.data[0]), &base->u);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(patchbatch.data[0]), &base->r);
+  glEnableClientState(GL_COLOR_ARRAY);
+
+  glDrawArrays(GL_TRIANGLES, 0, patchbatch.count);
+  rendered_drawcalls++;
+
+  glDisableClientState(GL_COLOR_ARRAY);
+  if (patchbatch.arrays)
+  {
+    // back to the flats arrays gld_DrawScene set up
+    if (gl_ext_arb_vertex_buffer_object)
+    {
+      GLEXT_glBindBufferARB(GL_ARRAY_BUFFER, flats_vbo_id);
+    }
+    glVertexPointer(3, GL_FLOAT, sizeof(flats_vbo[0]), flats_vbo_x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(flats_vbo[0]), flats_vbo_u);
+  }
+  else
+  {
+    if (gl_ext_arb_vertex_buffer_object)
+    {
+      GLEXT_glBindBufferARB(GL_ARRAY_BUFFER, 0);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  }
+
+  patchbatch.count = 0;
+}
+
+static void gld_StartPatchBatch(dboolean scene)
+{
+  if (!patchbatch.depth++)
+  {
+    patchbatch.scene = scene;
+    patchbatch.arrays = scene && !gl_use_display_lists;
+    patchbatch.count = 0;
+  }
+}
+
+void gld_BeginPatchBatch(void)
+{
+  gld_StartPatchBatch(false);
+}
+
+void gld_EndPatchBatch(void)
+{
+  if (patchbatch.depth && !--patchbatch.depth)
+  {
+    gld_FlushPatchBatch();
+  }
+}
+
+// v[0..3] is the quad as a triangle strip, drawn from the atlas page texid
+static void gld_BatchPatchQuad(GLuint *texid, float fogdensity, float lightlevel,
+  const vbo_xyz_uv_rgba_t *v)
+{
+  vbo_xyz_uv_rgba_t *out;
+
+  if (patchbatch.count &&
+      (texid != patchbatch.texid ||
+       (patchbatch.scene &&
+        (fogdensity != patchbatch.fogdensity ||
+         (gl_lightmode == gl_lightmode_shaders &&
+          lightlevel != patchbatch.lightlevel)))))
+  {
+    gld_FlushPatchBatch();
+  }
+
+  patchbatch.texid = texid;
+  patchbatch.fogdensity = fogdensity;
+  patchbatch.lightlevel = lightlevel;
+
+  if (patchbatch.count + 6 > patchbatch.capacity)
+  {
+    patchbatch.capacity = MAX(patchbatch.capacity * 2, 256);
+    patchbatch.data = realloc(patchbatch.data,
+      patchbatch.capacity * sizeof(patchbatch.data[0]));
+  }
+
+  out = &patchbatch.data[patchbatch.count];
+  out[0] = v[0];
+  out[1] = v[1];
+  out[2] = v[2];
+  out[3] = v[2];
+  out[4] = v[1];
+  out[5] = v[3];
+  patchbatch.count += 6;
+}
+
+#else
+#define gld_PatchBatching() false
+#define gld_FlushPatchBatch()
+#define gld_StartPatchBatch(scene)
+#define gld_BatchPatchQuad(texid, fogdensity, lightlevel, v)
+void gld_BeginPatchBatch(void) {}
+void gld_EndPatchBatch(void) {}
+#endif
+
 void gld_DrawNumPatch_f(float x, float y, int lump, int cm, enum patch_translation_e flags)
 {
   GLTexture *gltexture;
@@ -635,24 +828,28 @@ void gld_DrawNumPatch_f(float x, float y, int lump, int cm, enum patch_translati
 
   //e6y
   dboolean bFakeColormap;
+  dboolean bAtlas;
+  GLuint *batch_texid = NULL;
 
   cmap = ((flags & VPT_TRANS) ? cm : CR_DEFAULT);
   gltexture=gld_RegisterPatch(lump, cmap, false);
-  gld_BindPatch(gltexture, cmap);
+  if (gld_PatchBatching())
+    batch_texid = gld_GetAtlasPatch(gltexture, cmap);
+  if (!batch_texid)
+    gld_FlushPatchBatch();
+  bAtlas = (batch_texid || gld_BindAtlasPatch(gltexture, cmap));
 
   if (!gltexture)
     return;
-  fV1=0.0f;
-  fV2=gltexture->scaleyfac;
+  fU1=(bAtlas ? gltexture->atlas_u1 : 0.0f);
+  fU2=(bAtlas ? gltexture->atlas_u2 : gltexture->scalexfac);
+  fV1=(bAtlas ? gltexture->atlas_v1 : 0.0f);
+  fV2=(bAtlas ? gltexture->atlas_v2 : gltexture->scaleyfac);
   if (flags & VPT_FLIP)
   {
-    fU1=gltexture->scalexfac;
-    fU2=0.0f;
-  }
-  else
-  {
-    fU1=0.0f;
-    fU2=gltexture->scalexfac;
+    float u = fU1;
+    fU1 = fU2;
+    fU2 = u;
   }
 
   if (flags & VPT_NOOFFSET)
@@ -683,6 +880,19 @@ void gld_DrawNumPatch_f(float x, float y, int lump, int cm, enum patch_translati
     height = (float)(gltexture->realtexheight);
   }
 
+  if (batch_texid)
+  {
+    static const unsigned char white[4] = { 255, 255, 255, 255 };
+    vbo_xyz_uv_rgba_t v[4];
+
+    gld_SetQuadVertex(&v[0], xpos, ypos, 0.0f, fU1, fV1, white);
+    gld_SetQuadVertex(&v[1], xpos, ypos+height, 0.0f, fU1, fV2, white);
+    gld_SetQuadVertex(&v[2], xpos+width, ypos, 0.0f, fU2, fV1, white);
+    gld_SetQuadVertex(&v[3], xpos+width, ypos+height, 0.0f, fU2, fV2, white);
+    gld_BatchPatchQuad(batch_texid, 0.0f, 0.0f, v);
+    return;
+  }
+
   bFakeColormap =
     (gltexture->flags & GLTEXTURE_HIRES) && 
     (lumpinfo[lump].flags & LUMP_CM2RGB);
@@ -864,11 +1074,20 @@ void gld_DrawWeapon(int weaponlump, vissprite_t *vis, int lightlevel)
   gltexture=gld_RegisterPatch(firstspritelump+weaponlump, CR_DEFAULT, false);
   if (!gltexture)
     return;
-  gld_BindPatch(gltexture, CR_DEFAULT);
-  fU1=0;
-  fV1=0;
-  fU2=gltexture->scalexfac;
-  fV2=gltexture->scaleyfac;
+  if (gld_BindAtlasPatch(gltexture, CR_DEFAULT))
+  {
+    fU1=gltexture->atlas_u1;
+    fV1=gltexture->atlas_v1;
+    fU2=gltexture->atlas_u2;
+    fV2=gltexture->atlas_v2;
+  }
+  else
+  {
+    fU1=0;
+    fV1=0;
+    fU2=gltexture->scalexfac;
+    fV2=gltexture->scaleyfac;
+  }
   // e6y
   // More precise weapon drawing:
   // Shotgun from DSV3_War looks correctly now. Especially during movement.
@@ -1154,6 +1373,9 @@ void gld_StartDrawScene(void)
 
   gld_MultisamplingSet();
 
+  // rebuild the textures whose upscale finished since the last frame
+  gld_HQResizeUpdate();
+
   if (gl_shared_texture_palette)
     glEnable(GL_SHARED_TEXTURE_PALETTE_EXT);
   gld_SetPalette(-1);
@@ -1452,6 +1674,229 @@ static void gld_AddDrawWallItem(GLDrawItemType itemtype, void *itemdata)
   gld_AddDrawItem(itemtype, itemdata);
 }
 
+/*****************
+ *               *
+ * Wall batches  *
+ *               *
+ *****************/
+
+// Opaque walls arrive sorted by texture. Instead of a glBegin/glEnd fan
+// for each, plain walls are turned into triangles in a per-frame stream
+// and drawn with one glDrawArrays per run of equal texture, clamping and
+// fog. The light of each wall travels in the vertex colour; with shader
+// lighting it is a uniform, so it is part of the batch key instead.
+
+#if defined(USE_VERTEX_ARRAYS) || defined(USE_VBO)
+static struct
+{
+  dboolean active;
+
+  GLTexture *gltexture;
+  unsigned int flags;
+  float fogdensity;
+  float lightlevel;
+
+  vbo_xyz_uv_rgba_t *data;
+  int count, capacity;
+  vbo_xyz_uv_rgba_t *fan;
+  int fan_capacity;
+
+  GLuint vbo_id;
+} wallbatch;
+
+static void gld_FlushWallBatch(void)
+{
+  vbo_xyz_uv_rgba_t *base;
+
+  if (!wallbatch.count)
+    return;
+
+  gld_SetFog(wallbatch.fogdensity);
+  gld_BindTexture(wallbatch.gltexture, wallbatch.flags);
+  gld_BindDetailARB(wallbatch.gltexture, false);
+  if (gl_lightmode == gl_lightmode_shaders)
+  {
+    glsl_SetLightLevel(wallbatch.lightlevel);
+  }
+
+  if (gl_ext_arb_vertex_buffer_object)
+  {
+    if (!wallbatch.vbo_id)
+      GLEXT_glGenBuffersARB(1, &wallbatch.vbo_id);
+    GLEXT_glBindBufferARB(GL_ARRAY_BUFFER, wallbatch.vbo_id);
+    // a fresh store every flush lets the driver orphan the previous one
+    GLEXT_glBufferDataARB(GL_ARRAY_BUFFER,
+      wallbatch.count * sizeof(wallbatch.data[0]),
+      wallbatch.data, GL_STREAM_DRAW_ARB);
+    base = NULL_VBO_XYZ_UV_RGBA;
+  }
+  else
+  {
+    base = wallbatch.data;
+  }
+
+  glVertexPointer(3, GL_FLOAT, sizeof(wallbatch.data[0]), &base->x);
+  glTexCoordPointer(2, GL_FLOAT, sizeof(wallbatch.data[0]), &base->u);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(wallbatch.data[0]), &base->r);
+  glEnableClientState(GL_COLOR_ARRAY);
+
+  glDrawArrays(GL_TRIANGLES, 0, wallbatch.count);
+  rendered_drawcalls++;
+
+  // back to the flats arrays gld_DrawScene set up
+  glDisableClientState(GL_COLOR_ARRAY);
+  if (gl_ext_arb_vertex_buffer_object)
+  {
+    GLEXT_glBindBufferARB(GL_ARRAY_BUFFER, flats_vbo_id);
+  }
+  glVertexPointer(3, GL_FLOAT, sizeof(flats_vbo[0]), flats_vbo_x);
+  glTexCoordPointer(2, GL_FLOAT, sizeof(flats_vbo[0]), flats_vbo_u);
+
+  wallbatch.count = 0;
+}
+
+static void gld_BeginWallBatch(void)
+{
+  wallbatch.active = gl_batch_walls && !gl_use_display_lists;
+  wallbatch.count = 0;
+}
+
+static void gld_EndWallBatch(void)
+{
+  gld_FlushWallBatch();
+  wallbatch.active = false;
+}
+
+static vbo_xyz_uv_rgba_t *gld_WallBatchFanVertex(int *count,
+  float x, float y, float z, float u, float v)
+{
+  vbo_xyz_uv_rgba_t *vert = &wallbatch.fan[(*count)++];
+
+  vert->x = x;
+  vert->y = y;
+  vert->z = z;
+  vert->u = u;
+  vert->v = v;
+
+  return vert;
+}
+
+// Same fan as the immediate path in gld_DrawWall, split edges included
+static void gld_BatchWall(GLWall *wall, unsigned int flags)
+{
+  const float *left = NULL, *right = NULL;
+  int numleft = 0, numright = 0;
+  int i, count, needed;
+  float lightlevel, fact;
+  GLfloat rgba[4];
+  unsigned char r, g, b, a;
+  vbo_xyz_uv_rgba_t *out;
+
+  lightlevel = (players[displayplayer].fixedcolormap ? 1.0f : wall->light);
+
+  if (wallbatch.count &&
+      (wall->gltexture != wallbatch.gltexture ||
+       flags != wallbatch.flags ||
+       wall->fogdensity != wallbatch.fogdensity ||
+       (gl_lightmode == gl_lightmode_shaders &&
+        lightlevel != wallbatch.lightlevel)))
+  {
+    gld_FlushWallBatch();
+  }
+
+  wallbatch.gltexture = wall->gltexture;
+  wallbatch.flags = flags;
+  wallbatch.fogdensity = wall->fogdensity;
+  wallbatch.lightlevel = lightlevel;
+
+  if (!wall->glseg->fracleft)
+    numleft = gld_GetVertexSplitHeights(wall->seg->linedef->v1, &left);
+  if (!wall->glseg->fracright)
+    numright = gld_GetVertexSplitHeights(wall->seg->linedef->v2, &right);
+
+  if (wallbatch.fan_capacity < 4 + numleft + numright)
+  {
+    wallbatch.fan_capacity = 4 + numleft + numright;
+    wallbatch.fan = realloc(wallbatch.fan,
+      wallbatch.fan_capacity * sizeof(wallbatch.fan[0]));
+  }
+
+  fact = (wall->ytop - wall->ybottom ?
+    (wall->vt - wall->vb) / (wall->ytop - wall->ybottom) : 0);
+  count = 0;
+
+  // lower left corner
+  gld_WallBatchFanVertex(&count, wall->glseg->x1, wall->ybottom,
+    wall->glseg->z1, wall->ul, wall->vb);
+
+  // split left edge of wall
+  i = 0;
+  while (i < numleft && left[i] <= wall->ybottom)
+    i++;
+  while (i < numleft && left[i] < wall->ytop)
+  {
+    gld_WallBatchFanVertex(&count, wall->glseg->x1, left[i],
+      wall->glseg->z1, wall->ul, fact * (left[i] - wall->ytop) + wall->vt);
+    i++;
+  }
+
+  // upper left and upper right corners
+  gld_WallBatchFanVertex(&count, wall->glseg->x1, wall->ytop,
+    wall->glseg->z1, wall->ul, wall->vt);
+  gld_WallBatchFanVertex(&count, wall->glseg->x2, wall->ytop,
+    wall->glseg->z2, wall->ur, wall->vt);
+
+  // split right edge of wall
+  i = numright - 1;
+  while (i > 0 && right[i] >= wall->ytop)
+    i--;
+  while (i > 0 && right[i] > wall->ybottom)
+  {
+    gld_WallBatchFanVertex(&count, wall->glseg->x2, right[i],
+      wall->glseg->z2, wall->ur, fact * (right[i] - wall->ytop) + wall->vt);
+    i--;
+  }
+
+  // lower right corner
+  gld_WallBatchFanVertex(&count, wall->glseg->x2, wall->ybottom,
+    wall->glseg->z2, wall->ur, wall->vb);
+
+  needed = (count - 2) * 3;
+  if (wallbatch.count + needed > wallbatch.capacity)
+  {
+    wallbatch.capacity = MAX(wallbatch.capacity * 2, wallbatch.count + needed);
+    wallbatch.data = realloc(wallbatch.data,
+      wallbatch.capacity * sizeof(wallbatch.data[0]));
+  }
+
+  gld_StaticLightColor(wall->light, wall->alpha, rgba);
+  r = (unsigned char)(BETWEEN(0.0f, 1.0f, rgba[0]) * 255.0f + 0.5f);
+  g = (unsigned char)(BETWEEN(0.0f, 1.0f, rgba[1]) * 255.0f + 0.5f);
+  b = (unsigned char)(BETWEEN(0.0f, 1.0f, rgba[2]) * 255.0f + 0.5f);
+  a = (unsigned char)(BETWEEN(0.0f, 1.0f, rgba[3]) * 255.0f + 0.5f);
+  for (i = 0; i < count; i++)
+  {
+    wallbatch.fan[i].r = r;
+    wallbatch.fan[i].g = g;
+    wallbatch.fan[i].b = b;
+    wallbatch.fan[i].a = a;
+  }
+
+  // the fan as a list of triangles sharing its first vertex
+  out = &wallbatch.data[wallbatch.count];
+  for (i = 1; i < count - 1; i++)
+  {
+    *out++ = wallbatch.fan[0];
+    *out++ = wallbatch.fan[i];
+    *out++ = wallbatch.fan[i + 1];
+  }
+  wallbatch.count += needed;
+}
+#else
+#define gld_BeginWallBatch()
+#define gld_EndWallBatch()
+#endif
+
 /*****************
  *               *
  * Walls         *
@@ -1481,6 +1926,24 @@ static void gld_DrawWall(GLWall *wall)
   else
     flags = 0;
 
+#if defined(USE_VERTEX_ARRAYS) || defined(USE_VBO)
+  if (wallbatch.active)
+  {
+    if (!has_detail && wall->gltexture &&
+        wall->flag != GLDWF_TOPFLUD && wall->flag != GLDWF_BOTFLUD)
+    {
+      gld_BatchWall(wall, flags);
+      return;
+    }
+
+    // anything pending goes first; it may have left its own fog behind
+    gld_FlushWallBatch();
+    gld_SetFog(wall->fogdensity);
+  }
+#endif
+
+  rendered_drawcalls++;
+
   gld_BindTexture(wall->gltexture, flags);
   gld_BindDetailARB(wall->gltexture, has_detail);
 
@@ -2053,6 +2516,7 @@ static void gld_DrawFlat(GLFlat *flat)
     {
       int display_list = (has_detail ? flats_detail_display_list : flats_display_list);
       glCallList(display_list + flat->sectornum);
+      rendered_drawcalls++;
     }
     else
     {
@@ -2061,6 +2525,7 @@ static void gld_DrawFlat(GLFlat *flat)
         // set the current loop
         currentloop=&sectorloops[flat->sectornum].loops[loopnum];
         glDrawArrays(currentloop->mode,currentloop->vertexindex,currentloop->vertexcount);
+        rendered_drawcalls++;
       }
     }
 #else
@@ -2092,6 +2557,7 @@ static void gld_DrawFlat(GLFlat *flat)
       }
       // end of loop
       glEnd();
+      rendered_drawcalls++;
     }
 #endif
   }
@@ -2238,30 +2704,35 @@ static void gld_DrawSprite(GLSprite *sprite)
 {
   GLint blend_src, blend_dst;
   int restore = 0;
+  float ul = sprite->ul, ur = sprite->ur, vt = sprite->vt, vb = sprite->vb;
+  static const unsigned char white[4] = { 255, 255, 255, 255 };
+  vbo_xyz_uv_rgba_t v[4];
+  GLuint *batch_texid = NULL;
+  int i;
 
   rendered_vissprites++;
 
-  gld_BindPatch(sprite->gltexture,sprite->cm);
+  // shadows change the blending, and sprites drawn without the depth test
+  // keep the colour the caller set
+  if (gld_PatchBatching() && !(sprite->flags & (MF_NO_DEPTH_TEST | MF_SHADOW)))
+    batch_texid = gld_GetAtlasPatch(sprite->gltexture, sprite->cm);
 
-  if (!(sprite->flags & MF_NO_DEPTH_TEST))
+  if (!batch_texid && gld_PatchBatching())
   {
-    if(sprite->flags & MF_SHADOW)
-    {
-      glGetIntegerv(GL_BLEND_SRC, &blend_src);
-      glGetIntegerv(GL_BLEND_DST, &blend_dst);
-      glBlendFunc(GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA);
-      //glColor4f(0.2f,0.2f,0.2f,(float)tran_filter_pct/100.0f);
-      glAlphaFunc(GL_GEQUAL,0.1f);
-      glColor4f(0.2f,0.2f,0.2f,0.33f);
-      restore = 1;
-    }
-    else
-    {
-      if(sprite->flags & MF_TRANSLUCENT)
-        gld_StaticLightAlpha(sprite->light,(float)tran_filter_pct/100.0f);
-      else
-        gld_StaticLight(sprite->light);
-    }
+    // anything pending goes first; it may have left its own fog behind
+    gld_FlushPatchBatch();
+    gld_SetFog(sprite->fogdensity);
+  }
+
+  if (batch_texid || gld_BindAtlasPatch(sprite->gltexture,sprite->cm))
+  {
+    // gld_AddSprite set up the UVs for the patch's own texture
+    GLTexture *gltexture = sprite->gltexture;
+
+    ul = (sprite->ul ? gltexture->atlas_u2 : gltexture->atlas_u1);
+    ur = (sprite->ur ? gltexture->atlas_u2 : gltexture->atlas_u1);
+    vt = gltexture->atlas_v1;
+    vb = gltexture->atlas_v2;
   }
 
   if (!render_paperitems && !(sprite->flags & (MF_SOLID | MF_SPAWNCEILING)))
@@ -2291,12 +2762,10 @@ static void gld_DrawSprite(GLSprite *sprite)
     z3 = -(sprite->x1 * sin_inv_yaw + y2z2_y * cos_inv_yaw) + sprite->z;
     z4 = -(sprite->x2 * sin_inv_yaw + y2z2_y * cos_inv_yaw) + sprite->z;
 
-    glBegin(GL_TRIANGLE_STRIP);
-    glTexCoord2f(sprite->ul, sprite->vt); glVertex3f(x1, y1, z1);
-    glTexCoord2f(sprite->ur, sprite->vt); glVertex3f(x2, y1, z2);
-    glTexCoord2f(sprite->ul, sprite->vb); glVertex3f(x3, y2, z3);
-    glTexCoord2f(sprite->ur, sprite->vb); glVertex3f(x4, y2, z4);
-    glEnd();
+    gld_SetQuadVertex(&v[0], x1, y1, z1, ul, vt, white);
+    gld_SetQuadVertex(&v[1], x2, y1, z2, ur, vt, white);
+    gld_SetQuadVertex(&v[2], x3, y2, z3, ul, vb, white);
+    gld_SetQuadVertex(&v[3], x4, y2, z4, ur, vb, white);
   }
   else
   {
@@ -2311,14 +2780,63 @@ static void gld_DrawSprite(GLSprite *sprite)
     z2 = -(sprite->x1 * sin_inv_yaw) + sprite->z;
     z1 = -(sprite->x2 * sin_inv_yaw) + sprite->z;
 
-    glBegin(GL_TRIANGLE_STRIP);
-    glTexCoord2f(sprite->ul, sprite->vt); glVertex3f(x1, y1, z2);
-    glTexCoord2f(sprite->ur, sprite->vt); glVertex3f(x2, y1, z1);
-    glTexCoord2f(sprite->ul, sprite->vb); glVertex3f(x1, y2, z2);
-    glTexCoord2f(sprite->ur, sprite->vb); glVertex3f(x2, y2, z1);
-    glEnd();
+    gld_SetQuadVertex(&v[0], x1, y1, z2, ul, vt, white);
+    gld_SetQuadVertex(&v[1], x2, y1, z1, ur, vt, white);
+    gld_SetQuadVertex(&v[2], x1, y2, z2, ul, vb, white);
+    gld_SetQuadVertex(&v[3], x2, y2, z1, ur, vb, white);
   }
 
+  if (batch_texid)
+  {
+    // what gld_StaticLightAlpha would set, in the vertex colour
+    GLfloat rgba[4];
+
+    gld_StaticLightColor(sprite->light,
+      ((sprite->flags & MF_TRANSLUCENT) ? (float)tran_filter_pct/100.0f : 1.0f), rgba);
+    for (i = 0; i < 4; i++)
+    {
+      v[i].r = (unsigned char)(BETWEEN(0.0f, 1.0f, rgba[0]) * 255.0f + 0.5f);
+      v[i].g = (unsigned char)(BETWEEN(0.0f, 1.0f, rgba[1]) * 255.0f + 0.5f);
+      v[i].b = (unsigned char)(BETWEEN(0.0f, 1.0f, rgba[2]) * 255.0f + 0.5f);
+      v[i].a = (unsigned char)(BETWEEN(0.0f, 1.0f, rgba[3]) * 255.0f + 0.5f);
+    }
+
+    gld_BatchPatchQuad(batch_texid, sprite->fogdensity,
+      (players[displayplayer].fixedcolormap ? 1.0f : sprite->light), v);
+    return;
+  }
+
+  rendered_drawcalls++;
+
+  if (!(sprite->flags & MF_NO_DEPTH_TEST))
+  {
+    if(sprite->flags & MF_SHADOW)
+    {
+      glGetIntegerv(GL_BLEND_SRC, &blend_src);
+      glGetIntegerv(GL_BLEND_DST, &blend_dst);
+      glBlendFunc(GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA);
+      //glColor4f(0.2f,0.2f,0.2f,(float)tran_filter_pct/100.0f);
+      glAlphaFunc(GL_GEQUAL,0.1f);
+      glColor4f(0.2f,0.2f,0.2f,0.33f);
+      restore = 1;
+    }
+    else
+    {
+      if(sprite->flags & MF_TRANSLUCENT)
+        gld_StaticLightAlpha(sprite->light,(float)tran_filter_pct/100.0f);
+      else
+        gld_StaticLight(sprite->light);
+    }
+  }
+
+  glBegin(GL_TRIANGLE_STRIP);
+  for (i = 0; i < 4; i++)
+  {
+    glTexCoord2f(v[i].u, v[i].v);
+    glVertex3f(v[i].x, v[i].y, v[i].z);
+  }
+  glEnd();
+
   if (restore)
   {
     glBlendFunc(blend_src, blend_dst);
@@ -2718,6 +3236,51 @@ static int C_DECL dicmp_sprite_scale(const void *a, const void *b)
   }
 }
 
+// time spent sorting draw items in the current frame
+static uint_64_t gld_sort_ticks;
+
+//
+// Radix sort keys: textures by type and number, which groups equal
+// textures just as comparing their pointers does, and signed or
+// descending values flipped into ascending unsigned order
+//
+#define TEXTURE_SORT_KEY(tex) (((unsigned int)(tex)->index << 3) | (unsigned int)(tex)->textype)
+#define DESCENDING_SORT_KEY(value) (~((unsigned int)(value) ^ 0x80000000u))
+
+static void gld_SortItemsByKey(GLDrawItemType itemtype, int key)
+{
+  GLDrawItem *items = gld_drawinfo.items[itemtype];
+  unsigned int *keys = gld_GetDrawItemKeys(itemtype);
+  int count = gld_drawinfo.num_items[itemtype];
+  int i;
+
+  switch (key)
+  {
+  case 0: // wall texture
+    for (i = 0; i < count; i++)
+      keys[i] = TEXTURE_SORT_KEY(items[i].item.wall->gltexture);
+    break;
+  case 1: // flat texture
+    for (i = 0; i < count; i++)
+      keys[i] = TEXTURE_SORT_KEY(items[i].item.flat->gltexture);
+    break;
+  case 2: // sprite texture
+    for (i = 0; i < count; i++)
+      keys[i] = TEXTURE_SORT_KEY(items[i].item.sprite->gltexture);
+    break;
+  case 3: // sprite scale, nearest last
+    for (i = 0; i < count; i++)
+      keys[i] = DESCENDING_SORT_KEY(items[i].item.sprite->scale);
+    break;
+  case 4: // sprite position, back to front
+    for (i = 0; i < count; i++)
+      keys[i] = DESCENDING_SORT_KEY(items[i].item.sprite->xy);
+    break;
+  }
+
+  gld_SortDrawItems(itemtype);
+}
+
 static void gld_DrawItemsSortByTexture(GLDrawItemType itemtype)
 {
   typedef int(C_DECL *DICMP_ITEM)(const void *a, const void *b);
@@ -2733,10 +3296,38 @@ static void gld_DrawItemsSortByTexture(GLDrawItemType itemtype)
     0,
   };
 
+  // radix keys in the same order; -1 means no sorting
+  static const int itemkeys[GLDIT_TYPES] = {
+    -1,
+    0, 0, 0, 0, 0,
+    0, 0,
+    1, 1,
+    1, 1,
+    2, 2, 2,
+    -1,
+    -1,
+  };
+
   if (itemfuncs[itemtype] && gld_drawinfo.num_items[itemtype] > 1)
   {
-    qsort(gld_drawinfo.items[itemtype], gld_drawinfo.num_items[itemtype],
-      sizeof(gld_drawinfo.items[itemtype][0]), itemfuncs[itemtype]);
+    uint_64_t start = SDL_GetPerformanceCounter();
+
+    if (!gl_sort_radix)
+    {
+      qsort(gld_drawinfo.items[itemtype], gld_drawinfo.num_items[itemtype],
+        sizeof(gld_drawinfo.items[itemtype][0]), itemfuncs[itemtype]);
+    }
+    else
+    {
+      gld_SortItemsByKey(itemtype, itemkeys[itemtype]);
+      if (itemtype == GLDIT_TSPRITE)
+      {
+        // scale first, texture among equal scales
+        gld_SortItemsByKey(itemtype, 3);
+      }
+    }
+
+    gld_sort_ticks += SDL_GetPerformanceCounter() - start;
   }
 }
 
@@ -2756,6 +3347,37 @@ static void gld_DrawItemsSort(GLDrawItemType itemtype, int (C_DECL *PtFuncCompar
     sizeof(gld_drawinfo.items[itemtype][0]), PtFuncCompare);
 }
 
+// back to front; clears no_overlapped_sprites if two sprites share a spot
+static void gld_DrawItemsSortByPos(GLDrawItemType itemtype)
+{
+  uint_64_t start = SDL_GetPerformanceCounter();
+
+  if (!gl_sort_radix)
+  {
+    gld_DrawItemsSort(itemtype, dicmp_sprite_by_pos);
+  }
+  else
+  {
+    GLDrawItem *items = gld_drawinfo.items[itemtype];
+    int i;
+
+    gld_SortItemsByKey(itemtype, 4);
+
+    // a comparison sort meets every pair that ends up adjacent, so this
+    // finds the same ties dicmp_sprite_by_pos does
+    for (i = 1; i < gld_drawinfo.num_items[itemtype]; i++)
+    {
+      if (items[i - 1].item.sprite->xy == items[i].item.sprite->xy)
+      {
+        no_overlapped_sprites = false;
+        break;
+      }
+    }
+  }
+
+  gld_sort_ticks += SDL_GetPerformanceCounter() - start;
+}
+
 static void gld_DrawItemsSortSprites(GLDrawItemType itemtype)
 {
   static const float delta = 0.2f / MAP_COEFF;
@@ -2778,7 +3400,7 @@ static void gld_DrawItemsSortSprites(GLDrawItemType itemtype)
   if (sprites_doom_order == DOOM_ORDER_DYNAMIC)
   {
     no_overlapped_sprites = true;
-    gld_DrawItemsSort(itemtype, dicmp_sprite_by_pos); // back to front
+    gld_DrawItemsSortByPos(itemtype); // back to front
 
     if (!no_overlapped_sprites)
     {
@@ -2965,6 +3587,8 @@ void gld_DrawScene(player_t *player)
   gld_EnableDetail(false);
   gld_InitFrameDetails();
 
+  gld_sort_ticks = 0;
+
 #if defined(USE_VERTEX_ARRAYS) || defined(USE_VBO)
   if (!gl_use_display_lists)
   {
@@ -3046,11 +3670,13 @@ void gld_DrawScene(player_t *player)
 
   // top, bottom, one-sided walls
   gld_DrawItemsSortByTexture(GLDIT_WALL);
+  gld_BeginWallBatch();
   for (i = gld_drawinfo.num_items[GLDIT_WALL] - 1; i >= 0; i--)
   {
     gld_SetFog(gld_drawinfo.items[GLDIT_WALL][i].item.wall->fogdensity);
     gld_ProcessWall(gld_drawinfo.items[GLDIT_WALL][i].item.wall);
   }
+  gld_EndWallBatch();
 
   // masked geometry
   glEnable(GL_ALPHA_TEST);
@@ -3061,6 +3687,7 @@ void gld_DrawScene(player_t *player)
       gld_drawinfo.num_items[GLDIT_MWALL] > 0)
   {
     // opaque mid walls without holes
+    gld_BeginWallBatch();
     for (i = gld_drawinfo.num_items[GLDIT_MWALL] - 1; i >= 0; i--)
     {
       GLWall *wall = gld_drawinfo.items[GLDIT_MWALL][i].item.wall;
@@ -3070,6 +3697,7 @@ void gld_DrawScene(player_t *player)
         gld_ProcessWall(wall);
       }
     }
+    gld_EndWallBatch();
 
     // opaque mid walls with holes
 
@@ -3077,6 +3705,7 @@ void gld_DrawScene(player_t *player)
     glStencilFunc(GL_ALWAYS, 1, ~0);
     glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
+    gld_BeginWallBatch();
     for (i = gld_drawinfo.num_items[GLDIT_MWALL] - 1; i >= 0; i--)
     {
       GLWall *wall = gld_drawinfo.items[GLDIT_MWALL][i].item.wall;
@@ -3086,6 +3715,7 @@ void gld_DrawScene(player_t *player)
         gld_ProcessWall(wall);
       }
     }
+    gld_EndWallBatch();
 
     glStencilFunc(GL_EQUAL, 1, ~0);
     glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
@@ -3114,11 +3744,13 @@ void gld_DrawScene(player_t *player)
   else
   {
     // opaque mid walls
+    gld_BeginWallBatch();
     for (i = gld_drawinfo.num_items[GLDIT_MWALL] - 1; i >= 0; i--)
     {
       gld_SetFog(gld_drawinfo.items[GLDIT_MWALL][i].item.wall->fogdensity);
       gld_ProcessWall(gld_drawinfo.items[GLDIT_MWALL][i].item.wall);
     }
+    gld_EndWallBatch();
   }
 
   gl_EnableFog(false);
@@ -3143,11 +3775,13 @@ void gld_DrawScene(player_t *player)
   // opaque sprites
   glAlphaFunc(GL_GEQUAL, gl_mask_sprite_threshold_f);
   gld_DrawItemsSortSprites(GLDIT_SPRITE);
+  gld_StartPatchBatch(true);
   for (i = gld_drawinfo.num_items[GLDIT_SPRITE] - 1; i >= 0; i--)
   {
     gld_SetFog(gld_drawinfo.items[GLDIT_SPRITE][i].item.sprite->fogdensity);
     gld_DrawSprite(gld_drawinfo.items[GLDIT_SPRITE][i].item.sprite);
   }
+  gld_EndPatchBatch();
   glAlphaFunc(GL_GEQUAL, 0.5f);
 
   // mode for viewing all the alive monsters
@@ -3257,11 +3891,13 @@ void gld_DrawScene(player_t *player)
       glAlphaFunc(GL_GEQUAL, gl_mask_sprite_threshold_f);
       glDepthMask(GL_FALSE);
       gld_DrawItemsSortSprites(GLDIT_TSPRITE);
+      gld_StartPatchBatch(true);
       for (i = gld_drawinfo.num_items[GLDIT_TSPRITE] - 1; i >= 0; i--)
       {
         gld_SetFog(gld_drawinfo.items[GLDIT_TSPRITE][i].item.sprite->fogdensity);
         gld_DrawSprite(gld_drawinfo.items[GLDIT_TSPRITE][i].item.sprite);
       }
+      gld_EndPatchBatch();
       glDepthMask(GL_TRUE);
     }
 
@@ -3290,4 +3926,6 @@ void gld_DrawScene(player_t *player)
 #endif
 
   glsl_SetActiveShader(NULL);
+
+  rendered_sortusec = (int)(gld_sort_ticks * 1000000 / SDL_GetPerformanceFrequency());
 }
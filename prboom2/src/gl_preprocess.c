@@ -53,6 +53,9 @@
 #include "r_main.h"
 #include "am_map.h"
 #include "lprintf.h"
+#include "m_misc.h"
+#include "i_system.h"
+#include "md5.h"
 
 static FILE *levelinfo;
 
@@ -848,6 +851,291 @@ static void gld_MarkSectorsForClamp(void)
   }
 }
 
+/*****************************
+ *
+ * PREPROCESSING CACHE
+ *
+ *****************************/
+
+// With gl_preprocess_cache, what gld_PreprocessSectors works out for a map
+// (sector and subsector loops, the flat vertexes and the closed/isolated
+// marks it leaves on sectors and lines) is kept in I_DoomExeDir as
+// glpre_<md5>.dat. The MD5 covers the loaded map geometry including the
+// nodes, so it follows the lumps and whichever node builder made them.
+
+#define GLPRE_MAGIC   "PRBGLPRE"
+#define GLPRE_VERSION 1
+
+int gl_preprocess_cache;
+
+typedef struct
+{
+  char magic[8];
+  int version;
+  int numsectors, numsubsectors, numlines;
+  int numloops;           // sector loops, then subsector loops if any
+  int numvertexes;        // flats_vbo entries
+  int hassubsectorloops;
+} glpre_header_t;
+
+static void gld_PreprocessCacheName(char *name, size_t size, const char *ext)
+{
+  struct MD5Context md5;
+  unsigned char key[16];
+  char hex[33];
+  int i, n;
+
+  MD5Init(&md5);
+  n = GLPRE_VERSION;
+  MD5Update(&md5, (const md5byte *)&n, sizeof(n));
+  n = sizeof(GLLoopDef) | (sizeof(vbo_xyz_uv_t) << 8);
+  MD5Update(&md5, (const md5byte *)&n, sizeof(n));
+  MD5Update(&md5, (const md5byte *)&nodesVersion, sizeof(nodesVersion));
+
+  for (i = 0; i < numvertexes; i++)
+  {
+    MD5Update(&md5, (const md5byte *)&vertexes[i].x, sizeof(vertexes[i].x));
+    MD5Update(&md5, (const md5byte *)&vertexes[i].y, sizeof(vertexes[i].y));
+  }
+  for (i = 0; i < numlines; i++)
+  {
+    int l[4];
+    l[0] = lines[i].v1 - vertexes;
+    l[1] = lines[i].v2 - vertexes;
+    l[2] = lines[i].sidenum[0];
+    l[3] = lines[i].sidenum[1];
+    MD5Update(&md5, (const md5byte *)l, sizeof(l));
+  }
+  for (i = 0; i < numsides; i++)
+  {
+    n = sides[i].sector - sectors;
+    MD5Update(&md5, (const md5byte *)&n, sizeof(n));
+  }
+  for (i = 0; i < numsectors; i++)
+  {
+    int j;
+    MD5Update(&md5, (const md5byte *)&sectors[i].linecount, sizeof(sectors[i].linecount));
+    for (j = 0; j < sectors[i].linecount; j++)
+    {
+      n = sectors[i].lines[j] - lines;
+      MD5Update(&md5, (const md5byte *)&n, sizeof(n));
+    }
+  }
+  for (i = 0; i < numsegs; i++)
+  {
+    int s[2];
+    s[0] = segs[i].v1 - vertexes;
+    s[1] = segs[i].v2 - vertexes;
+    MD5Update(&md5, (const md5byte *)s, sizeof(s));
+  }
+  for (i = 0; i < numsubsectors; i++)
+  {
+    int s[3];
+    s[0] = subsectors[i].sector - sectors;
+    s[1] = subsectors[i].firstline;
+    s[2] = subsectors[i].numlines;
+    MD5Update(&md5, (const md5byte *)s, sizeof(s));
+  }
+  if (numnodes)
+    MD5Update(&md5, (const md5byte *)nodes, numnodes * sizeof(nodes[0]));
+
+  MD5Final(key, &md5);
+
+  for (i = 0; i < 16; i++)
+    sprintf(hex + i * 2, "%02x", key[i]);
+  doom_snprintf(name, size, "%s/glpre_%s.dat%s", I_DoomExeDir(), hex, ext);
+}
+
+static GLLoopDef *gld_ReadCachedLoops(const GLLoopDef **src, int count)
+{
+  GLLoopDef *loops = NULL;
+
+  if (count)
+  {
+    loops = Z_Malloc(count * sizeof(loops[0]), PU_STATIC, 0);
+    memcpy(loops, *src, count * sizeof(loops[0]));
+    *src += count;
+  }
+
+  return loops;
+}
+
+static dboolean gld_LoadPreprocessCache(void)
+{
+  char name[PATH_MAX];
+  byte *data = NULL;
+  const glpre_header_t *header;
+  const byte *closed, *isolated;
+  const int *loopcounts;
+  const unsigned int *sectorflags;
+  const GLLoopDef *loops;
+  int size, numcounts, i;
+  dboolean ok = false;
+
+  gld_PreprocessCacheName(name, sizeof(name), "");
+  size = M_ReadFile(name, &data);
+  if (size < (int)sizeof(*header))
+  {
+    free(data);
+    return false;
+  }
+
+  header = (const glpre_header_t *)data;
+  numcounts = numsectors + (header->hassubsectorloops ? numsubsectors : 0);
+  if (memcmp(header->magic, GLPRE_MAGIC, sizeof(header->magic)) ||
+      header->version != GLPRE_VERSION ||
+      header->numsectors != numsectors ||
+      header->numsubsectors != numsubsectors ||
+      header->numlines != numlines ||
+      header->numloops < 0 || header->numvertexes < 0 ||
+      size != (int)(sizeof(*header) +
+        ((numsectors + numlines + 3) & ~3) +
+        numcounts * sizeof(int) + numsectors * sizeof(unsigned int) +
+        header->numloops * sizeof(GLLoopDef) +
+        header->numvertexes * sizeof(vbo_xyz_uv_t)))
+  {
+    lprintf(LO_WARN, "gld_LoadPreprocessCache: ignoring damaged %s\n", name);
+    free(data);
+    return false;
+  }
+
+  closed = (const byte *)(header + 1);
+  isolated = closed + numsectors;
+  loopcounts = (const int *)(closed + ((numsectors + numlines + 3) & ~3));
+  sectorflags = (const unsigned int *)(loopcounts + numcounts);
+  loops = (const GLLoopDef *)(sectorflags + numsectors);
+
+  // the loop counts must add up before anything is taken over
+  for (i = 0, size = 0; i < numcounts; i++)
+  {
+    if (loopcounts[i] < 0)
+      break;
+    size += loopcounts[i];
+  }
+  if (i == numcounts && size == header->numloops)
+  {
+    for (i = 0; i < header->numloops; i++)
+    {
+      if (loops[i].vertexindex < 0 || loops[i].vertexcount < 0 ||
+          loops[i].vertexindex > header->numvertexes - loops[i].vertexcount)
+        break;
+    }
+    ok = (i == header->numloops);
+  }
+
+  if (ok)
+  {
+    for (i = 0; i < numsectors; i++)
+    {
+      if (closed[i])
+        sectors[i].flags |= SECTOR_IS_CLOSED;
+      else
+        sectors[i].flags &= ~SECTOR_IS_CLOSED;
+
+      sectorloops[i].loopcount = loopcounts[i];
+      sectorloops[i].flags = sectorflags[i];
+      sectorloops[i].loops = gld_ReadCachedLoops(&loops, loopcounts[i]);
+    }
+    for (i = 0; i < numlines; i++)
+    {
+      if (isolated[i])
+        lines[i].r_flags |= RF_ISOLATED;
+    }
+    if (header->hassubsectorloops)
+    {
+      for (i = 0; i < numsubsectors; i++)
+      {
+        subsectorloops[i].loopcount = loopcounts[numsectors + i];
+        subsectorloops[i].loops = gld_ReadCachedLoops(&loops, loopcounts[numsectors + i]);
+      }
+    }
+
+    gld_num_vertexes = gld_max_vertexes = header->numvertexes;
+    flats_vbo = Z_Malloc(MAX(gld_num_vertexes, 1) * sizeof(flats_vbo[0]), PU_STATIC, 0);
+    memcpy(flats_vbo, loops, gld_num_vertexes * sizeof(flats_vbo[0]));
+  }
+  else
+  {
+    lprintf(LO_WARN, "gld_LoadPreprocessCache: ignoring damaged %s\n", name);
+  }
+
+  free(data);
+  return ok;
+}
+
+static void gld_SavePreprocessCache(void)
+{
+  char name[PATH_MAX], tmpname[PATH_MAX];
+  glpre_header_t header;
+  byte *marks;
+  int marksize, i;
+  dboolean hassubsectorloops;
+  FILE *f;
+  dboolean ok;
+
+  hassubsectorloops = (subsectorloops && subsectorloops[0].loops != NULL);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, GLPRE_MAGIC, sizeof(header.magic));
+  header.version = GLPRE_VERSION;
+  header.numsectors = numsectors;
+  header.numsubsectors = numsubsectors;
+  header.numlines = numlines;
+  header.numvertexes = gld_num_vertexes;
+  header.hassubsectorloops = hassubsectorloops;
+  for (i = 0; i < numsectors; i++)
+    header.numloops += sectorloops[i].loopcount;
+  for (i = 0; hassubsectorloops && i < numsubsectors; i++)
+    header.numloops += subsectorloops[i].loopcount;
+
+  marksize = (numsectors + numlines + 3) & ~3;
+  marks = calloc(1, MAX(marksize, 1));
+  for (i = 0; i < numsectors; i++)
+    marks[i] = !!(sectors[i].flags & SECTOR_IS_CLOSED);
+  for (i = 0; i < numlines; i++)
+    marks[numsectors + i] = !!(lines[i].r_flags & RF_ISOLATED);
+
+  gld_PreprocessCacheName(name, sizeof(name), "");
+  gld_PreprocessCacheName(tmpname, sizeof(tmpname), ".tmp");
+
+  if ((f = fopen(tmpname, "wb")) == NULL)
+  {
+    free(marks);
+    return;
+  }
+
+  ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  ok = ok && fwrite(marks, 1, marksize, f) == (size_t)marksize;
+  for (i = 0; ok && i < numsectors; i++)
+    ok = fwrite(&sectorloops[i].loopcount, sizeof(int), 1, f) == 1;
+  for (i = 0; ok && hassubsectorloops && i < numsubsectors; i++)
+    ok = fwrite(&subsectorloops[i].loopcount, sizeof(int), 1, f) == 1;
+  for (i = 0; ok && i < numsectors; i++)
+    ok = fwrite(&sectorloops[i].flags, sizeof(unsigned int), 1, f) == 1;
+  for (i = 0; ok && i < numsectors; i++)
+    ok = fwrite(sectorloops[i].loops, sizeof(GLLoopDef), sectorloops[i].loopcount, f) ==
+      (size_t)sectorloops[i].loopcount;
+  for (i = 0; ok && hassubsectorloops && i < numsubsectors; i++)
+    ok = fwrite(subsectorloops[i].loops, sizeof(GLLoopDef), subsectorloops[i].loopcount, f) ==
+      (size_t)subsectorloops[i].loopcount;
+  ok = ok && fwrite(flats_vbo, sizeof(flats_vbo[0]), gld_num_vertexes, f) ==
+    (size_t)gld_num_vertexes;
+  ok = (fclose(f) == 0) && ok;
+
+  if (ok)
+  {
+    remove(name);
+    ok = !rename(tmpname, name);
+  }
+  if (!ok)
+  {
+    lprintf(LO_WARN, "gld_SavePreprocessCache: failed to write %s\n", name);
+    remove(tmpname);
+  }
+
+  free(marks);
+}
+
 static void gld_PreprocessSectors(void)
 {
 #ifdef USE_GLU_TESS // figgi
@@ -904,6 +1192,14 @@ static void gld_PreprocessSectors(void)
   flats_vbo = NULL;
   gld_max_vertexes=0;
   gld_num_vertexes=0;
+
+  if (gl_preprocess_cache && gld_LoadPreprocessCache())
+  {
+    gld_ProcessTexturedMap();
+    if (levelinfo) fclose(levelinfo);
+    return;
+  }
+
   if (numvertexes)
   {
     gld_AddGlobalVertexes(numvertexes*2);
@@ -1009,6 +1305,9 @@ static void gld_PreprocessSectors(void)
 
   //e6y: for seamless rendering
   gld_MarkSectorsForClamp();
+
+  if (gl_preprocess_cache)
+    gld_SavePreprocessCache();
 }
 
 static void gld_PreprocessSegs(void)
@@ -101,6 +101,8 @@ void gld_InitTextureParams(void);
 
 void gld_DrawNumPatch(int x, int y, int lump, int cm, enum patch_translation_e flags);
 void gld_DrawNumPatch_f(float x, float y, int lump, int cm, enum patch_translation_e flags);
+void gld_BeginPatchBatch(void);
+void gld_EndPatchBatch(void);
 
 void gld_FillFlat(int lump, int x, int y, int width, int height, enum patch_translation_e flags);
 #define gld_FillFlatName(flatname, x, y, width, height, flags) \
@@ -166,6 +168,8 @@ extern int gl_texture_hqresize;
 extern int gl_texture_hqresize_textures;
 extern int gl_texture_hqresize_sprites;
 extern int gl_texture_hqresize_patches;
+extern int gl_texture_hqresize_cache;
+extern int gl_texture_hqresize_async;
 
 //clipper
 dboolean gld_clipper_SafeCheckRange(angle_t startAngle, angle_t endAngle);
@@ -226,6 +230,21 @@ void gld_MultisamplingSet(void);
 //display lists
 extern int gl_use_display_lists;
 
+// wall batching
+extern int gl_batch_walls;
+
+// radix sort of draw items instead of qsort
+extern int gl_sort_radix;
+
+// keep preprocessed level geometry on disk
+extern int gl_preprocess_cache;
+
+// sprites and HUD patches packed into shared textures
+extern int gl_patch_atlas;
+
+// skip BSP subtrees that the clipper found hidden in the previous frame
+extern int gl_node_occlusion;
+
 void gld_ProcessTexturedMap(void);
 void gld_ResetTexturedAutomap(void);
 void gld_MapDrawSubsectors(player_t *plr, int fx, int fy, fixed_t mx, fixed_t my, int fw, int fh, fixed_t scale);
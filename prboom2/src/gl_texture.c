@@ -976,6 +976,7 @@ void gld_BindTexture(GLTexture *gltexture, unsigned int flags)
   if (*gltexture->texid_p != 0)
   {
     glBindTexture(GL_TEXTURE_2D, *gltexture->texid_p);
+    rendered_texbinds++;
     gld_SetTexClamp(gltexture, flags);
     return;
   }
@@ -992,6 +993,7 @@ void gld_BindTexture(GLTexture *gltexture, unsigned int flags)
   if (*gltexture->texid_p == 0)
     glGenTextures(1, gltexture->texid_p);
   glBindTexture(GL_TEXTURE_2D, *gltexture->texid_p);
+  rendered_texbinds++;
   
   if (gltexture->flags & GLTEXTURE_HASHOLES)
   {
@@ -1071,6 +1073,8 @@ GLTexture *gld_RegisterPatch(int lump, int cm, dboolean is_sprite)
     if (gltexture->realtexheight>gltexture->buffer_height)
       return gltexture;
     gltexture->textype=GLDT_PATCH;
+
+    gld_AddPatchToAtlas(gltexture, !!(lumpinfo[lump].flags & LUMP_STATIC));
   }
   return gltexture;
 }
@@ -1110,6 +1114,7 @@ void gld_BindPatch(GLTexture *gltexture, int cm)
   if (*gltexture->texid_p != 0)
   {
     glBindTexture(GL_TEXTURE_2D, *gltexture->texid_p);
+    rendered_texbinds++;
     gld_SetTexClamp(gltexture, GLTEXTURE_CLAMPXY);
     return;
   }
@@ -1143,6 +1148,7 @@ void gld_BindPatch(GLTexture *gltexture, int cm)
   if (*gltexture->texid_p == 0)
     glGenTextures(1, gltexture->texid_p);
   glBindTexture(GL_TEXTURE_2D, *gltexture->texid_p);
+  rendered_texbinds++;
 
   buffer = gld_HQResize(gltexture, buffer, gltexture->buffer_width, gltexture->buffer_height, &w, &h);
 
@@ -1246,6 +1252,7 @@ void gld_BindFlat(GLTexture *gltexture, unsigned int flags)
   if (*gltexture->texid_p != 0)
   {
     glBindTexture(GL_TEXTURE_2D, *gltexture->texid_p);
+    rendered_texbinds++;
     gld_SetTexClamp(gltexture, flags);
     return;
   }
@@ -1260,6 +1267,7 @@ void gld_BindFlat(GLTexture *gltexture, unsigned int flags)
   if (*gltexture->texid_p == 0)
     glGenTextures(1, gltexture->texid_p);
   glBindTexture(GL_TEXTURE_2D, *gltexture->texid_p);
+  rendered_texbinds++;
 
   buffer = gld_HQResize(gltexture, buffer, gltexture->buffer_width, gltexture->buffer_height, &w, &h);
 
@@ -1280,6 +1288,8 @@ static void gld_CleanTexItems(int count, GLTexture ***items)
   if (!(*items))
     return;
 
+  gld_HQResizeFlush();
+
   for (i=0; i<count; i++)
   {
     if ((*items)[i])
@@ -1313,6 +1323,8 @@ void gld_FlushTextures(void)
   gld_CleanTexItems(numtextures, &gld_GLTextures);
   gld_CleanTexItems(numlumps, &gld_GLPatchTextures);
   gld_CleanTexItems(numlumps, &gld_GLStaticPatchTextures);
+  gld_FlushAtlas(false);
+  gld_FlushAtlas(true);
 
   gl_has_hires = 0;
   
@@ -1551,7 +1563,7 @@ void gld_Precache(void)
               gltexture = gld_RegisterPatch(firstspritelump + sflump[k], CR_LIMIT, true);
               if (gltexture)
               {
-                gld_BindPatch(gltexture, CR_LIMIT);
+                gld_BindAtlasPatch(gltexture, CR_LIMIT);
               }
             }
             while (--k >= 0);
@@ -1583,6 +1595,10 @@ void gld_Precache(void)
     
     lprintf(LO_INFO, "gld_Precache: %s done in %d ms\n", map, SDL_GetTicks() - tics);
   }
+
+#ifdef HAVE_LIBSDL2_IMAGE
+  gld_HiResCacheStats();
+#endif
 }
 
 void gld_CleanMemory(void)
@@ -1590,6 +1606,7 @@ void gld_CleanMemory(void)
   gld_CleanVertexData();
   gld_CleanTexItems(numtextures, &gld_GLTextures);
   gld_CleanTexItems(numlumps, &gld_GLPatchTextures);
+  gld_FlushAtlas(false);
   gld_CleanDisplayLists();
   gl_preprocessed = false;
 }
@@ -1597,4 +1614,5 @@ void gld_CleanMemory(void)
 void gld_CleanStaticMemory(void)
 {
   gld_CleanTexItems(numlumps, &gld_GLStaticPatchTextures);
+  gld_FlushAtlas(true);
 }
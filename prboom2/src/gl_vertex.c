@@ -224,6 +224,24 @@ void gld_SplitRightEdge(const GLWall *wall, dboolean detail)
   }
 }
 
+//==========================================================================
+//
+// Heights at which walls touching this vertex must be split, ascending
+//
+//==========================================================================
+int gld_GetVertexSplitHeights(const vertex_t *v, const float **heightlist)
+{
+  vertexsplit_info_t *vi;
+
+  if (v == NULL)
+    return 0;
+
+  vi = &gl_vertexsplit[v - vertexes];
+  *heightlist = vi->heightlist;
+
+  return vi->numheights;
+}
+
 //==========================================================================
 //
 // Recalculate all heights affectting this vertex.
@@ -184,6 +184,7 @@ void HUlib_drawTextLine
 
   x = (l->x < 0 ? -l->x - l->w : l->x);
   y = (l->y < 0 ? -l->y - l->f[toupper(l->l[0]) - l->sc].height : l->y);
+  V_BeginPatchBatch();
   for (i=0;i<l->len;i++)
   {
     c = toupper(l->l[i]); //jff insure were not getting a cheap toupper conv.
@@ -224,6 +225,7 @@ void HUlib_drawTextLine
     // CPhipps - patch drawing updated
     V_DrawNumPatch(x, y, FG, l->f['_' - l->sc].lumpnum, CR_DEFAULT, VPT_NONE | l->flags);
   }
+  V_EndPatchBatch();
 }
 
 //
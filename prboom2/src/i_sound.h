@@ -126,11 +126,15 @@ void I_StopSong(int handle);
 // See above (register), then think backwards
 void I_UnRegisterSong(int handle);
 
+// Times the OPL synth on the game's music (-oplbench)
+void I_OPLBenchmark(void);
+
 // Allegro card support jff 1/18/98
 extern int snd_card;
 extern int mus_card;
 // CPhipps - put these in config file
 extern int snd_samplerate;
+extern int snd_music_latency;
 
 extern int use_experimental_music;
 
@@ -138,6 +142,7 @@ extern int mus_fluidsynth_chorus;
 extern int mus_fluidsynth_reverb;
 extern int mus_fluidsynth_gain; // NSM  fine tune fluidsynth output level
 extern int mus_opl_gain; // NSM  fine tune OPL output level
+extern int mus_render_cache;
 
 // prefered MIDI player
 typedef enum
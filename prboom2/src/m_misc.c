@@ -73,6 +73,8 @@
 #include "r_fps.h"
 #include "r_main.h"
 #include "r_things.h"
+#include "r_patchstore.h"
+#include "r_precache.h"
 #include "r_sky.h"
 
 //e6y
@@ -86,6 +88,8 @@
 // NSM
 #include "i_capture.h"
 
+#include "m_profile.h"
+
 /* cph - disk icon not implemented */
 static inline void I_BeginRead(void) {}
 static inline void I_EndRead(void) {}
@@ -240,6 +244,11 @@ static int gl_ztrick;
 
 // dummy variables for !GL_DOOM declared in gl_struct.h
 int gl_use_display_lists;
+int gl_batch_walls;
+int gl_sort_radix;
+int gl_preprocess_cache;
+int gl_patch_atlas;
+int gl_node_occlusion;
 int gl_sprite_offset_default;
 int gl_sprite_blend;
 int gl_mask_sprite_threshold;
@@ -259,6 +268,8 @@ int gl_texture_hqresize;
 int gl_texture_hqresize_textures;
 int gl_texture_hqresize_sprites;
 int gl_texture_hqresize_patches;
+int gl_texture_hqresize_cache;
+int gl_texture_hqresize_async;
 motion_blur_params_t motion_blur;
 gl_lightmode_t gl_lightmode_default;
 int gl_light_ambient;
@@ -317,6 +328,8 @@ default_t defaults[] =
    def_hex, ss_none}, // 0, +1 for colours, +2 for non-ascii chars, +4 for skip-last-line
   {"level_precache",{(int*)&precache},{1},0,1,
    def_bool,ss_none}, // precache level data?
+  {"level_precache_background",{&r_precache_background},{0},0,1,
+   def_bool,ss_none}, // precache level data on a worker thread?
   {"demo_smoothturns", {&demo_smoothturns},  {0},0,1,
    def_bool,ss_stat},
   {"demo_smoothturnsfactor", {&demo_smoothturnsfactor},  {6},1,SMOOTH_PLAYING_MAXFACTOR,
@@ -431,6 +444,8 @@ default_t defaults[] =
   {"pitched_sounds",{&pitched_sounds},{0},0,1, // killough 2/21/98
    def_bool,ss_none}, // enables variable pitch in sound effects (from id's original code)
   {"samplerate",{&snd_samplerate},{44100},11025,48000, def_int,ss_none},
+  {"snd_music_latency",{&snd_music_latency},{50},0,1000,
+   def_int,ss_none}, // ms of music rendered ahead by its own thread, 0 renders in the audio callback
   {"sfx_volume",{&snd_SfxVolume},{8},0,15, def_int,ss_none},
   {"music_volume",{&snd_MusicVolume},{8},0,15, def_int,ss_none},
   {"mus_pause_opt",{&mus_pause_opt},{1},0,2, // CPhipps - music pausing
@@ -457,6 +472,8 @@ default_t defaults[] =
   {"mus_fluidsynth_reverb",{&mus_fluidsynth_reverb},{0},0,1,def_bool,ss_none},
   {"mus_fluidsynth_gain",{&mus_fluidsynth_gain},{50},0,1000,def_int,ss_none}, // NSM  fine tune fluidsynth output level
   {"mus_opl_gain",{&mus_opl_gain},{50},0,1000,def_int,ss_none}, // NSM  fine tune opl output level
+  {"mus_render_cache",{&mus_render_cache},{0},0,1,
+   def_bool,ss_none}, // keep converted MIDI, and OPL / FluidSynth songs rendered ahead, in the exe dir
 
   {"Video settings",{NULL},{0},UL,UL,def_none,ss_none},
   {"videomode",{NULL, &default_videomode},{0,"8bit"},UL,UL,def_str,ss_none},
@@ -468,6 +485,8 @@ default_t defaults[] =
   def_bool,ss_none},
   {"render_vsync",{&render_vsync},{1},0,1,
    def_bool,ss_none},
+  {"render_streaming_present",{&render_streaming_present},{1},0,1,
+   def_bool,ss_none}, // write frames straight into a streaming texture
   {"translucency",{&default_translucency},{1},0,1,   // phares
    def_bool,ss_none}, // enables translucency
   {"tran_filter_pct",{&tran_filter_pct},{66},0,100,         // killough 2/21/98
@@ -525,6 +544,16 @@ default_t defaults[] =
    def_bool,ss_stat},
   {"gl_use_display_lists",{&gl_use_display_lists},{0},0,1,
    def_bool,ss_none},
+  {"gl_batch_walls",{&gl_batch_walls},{1},0,1,
+   def_bool,ss_none},
+  {"gl_sort_radix",{&gl_sort_radix},{1},0,1,
+   def_bool,ss_none},
+  {"gl_preprocess_cache",{&gl_preprocess_cache},{0},0,1,
+   def_bool,ss_none}, // keep tessellated sectors of visited maps in the exe dir
+  {"gl_patch_atlas",{&gl_patch_atlas},{1},0,1,
+   def_bool,ss_none}, // pack sprites and HUD graphics into shared textures
+  {"gl_node_occlusion",{&gl_node_occlusion},{1},0,1,
+   def_bool,ss_none}, // skip BSP subtrees hidden in the previous frame
 
   {"gl_finish",{&gl_finish},{1},0,1,
    def_bool,ss_none},
@@ -945,6 +974,8 @@ default_t defaults[] =
   //jff 2/23/98
   {"hud_displayed", {&hud_displayed},  {0},0,1, // whether hud is displayed
    def_bool,ss_none}, // enables display of HUD
+  {"hud_profiler", {&profiler_overlay},  {0},0,1,
+   def_bool,ss_none}, // graph of where each frame's time went
 
 //e6y
   {"Prboom-plus key bindings",{NULL},{0},UL,UL,def_none,ss_none},
@@ -1089,6 +1120,10 @@ default_t defaults[] =
    def_bool,ss_none},
   {"sprites_doom_order", {&sprites_doom_order}, {DOOM_ORDER_STATIC},0,DOOM_ORDER_LAST - 1,
    def_int,ss_stat},
+  {"render_sprite_batching", {&r_sprite_batching}, {0},0,1,
+   def_bool,ss_stat},
+  {"render_patch_store", {&r_patch_store}, {0},0,1,
+   def_bool,ss_stat},
 
   {"movement_mouselook", {&movement_mouselook},  {0},0,1,
    def_bool,ss_stat},
@@ -1137,6 +1172,10 @@ default_t defaults[] =
    {hq_scale_none},hq_scale_none,hq_scale_max-1, def_int,ss_stat},
   {"gl_texture_hqresize_patches", {&gl_texture_hqresize_patches},
    {hq_scale_2x},hq_scale_none,hq_scale_max-1,def_int,ss_stat},
+  {"gl_texture_hqresize_cache", {&gl_texture_hqresize_cache},  {0},0,1,
+   def_bool,ss_stat}, // keep upscaled textures as hq_*.dat in the exe dir
+  {"gl_texture_hqresize_async", {&gl_texture_hqresize_async},  {1},0,1,
+   def_bool,ss_stat},
   {"gl_motionblur", {&gl_motionblur},  {0},0,1,
    def_bool,ss_stat},
   {"gl_motionblur_min_speed", {NULL,&motion_blur.str_min_speed}, {0,"21.36"},UL,UL,
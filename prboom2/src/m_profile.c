@@ -0,0 +1,359 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Frame pipeline profiler
+ *
+ *  M_ProfileBegin/M_ProfileEnd pairs around the stages of a frame add
+ *  up their time; M_ProfileEndFrame closes the frame and keeps it for
+ *  the graph M_ProfileDrawer puts in the top left corner, one column
+ *  per frame, a quarter of the screen high for PROF_GRAPH_MS:
+ *
+ *    dark grey  G_Ticker outside the playsim   red     R_RenderBSPNode
+ *    green      P_Ticker                       orange  R_DrawPlanes
+ *    brown      rest of R_RenderPlayerView     yellow  R_DrawMasked
+ *    blue       status bar and HUD             purple  I_FinishUpdate
+ *    light grey everything else
+ *
+ *  with white lines at 35 and 60 frames per second. "-trace file" writes
+ *  every timed stage, including the audio callback, as Chrome trace
+ *  event JSON for chrome://tracing or Perfetto.
+ *
+ *  "-benchjson file" with -timedemo or -fastdemo keeps a histogram of
+ *  frame times and writes the run's rates, frame time percentiles, time
+ *  per stage and peak zone memory to file as JSON when the demo ends;
+ *  tests/benchmark.py runs demo suites with it.
+ *
+ *---------------------------------------------------------------------
+ */
+
+#include "SDL.h"
+
+#include "doomstat.h"
+#include "v_video.h"
+#include "m_argv.h"
+#include "lprintf.h"
+#include "z_zone.h"
+#include "m_profile.h"
+
+#define PROF_HISTORY  128  // frames in the graph
+#define PROF_GRAPH_MS 50   // graph height in milliseconds
+#define BENCH_BUCKET_US 10    // frame time histogram resolution
+#define BENCH_BUCKETS   25000 // up to 250ms, longer frames go in the last
+
+int profiler_overlay;
+
+static const char *zone_names[NUMPROFZONES] =
+{
+  "G_Ticker",
+  "P_Ticker",
+  "R_RenderPlayerView",
+  "R_RenderBSPNode",
+  "R_DrawPlanes",
+  "R_DrawMasked",
+  "HUD",
+  "I_FinishUpdate",
+  "Audio",
+};
+
+static Uint64 perf_freq;
+static Uint64 zone_start[NUMPROFZONES];
+static Uint64 frame_ticks[NUMPROFZONES];
+static SDL_atomic_t audio_usec; // PROF_AUDIO, added to by the audio thread
+static Uint64 frame_start;
+
+typedef struct
+{
+  float ms[NUMPROFZONES];
+  float total;
+} profframe_t;
+
+static profframe_t history[PROF_HISTORY];
+static int history_pos;
+
+static FILE *trace_fp;
+static SDL_mutex *trace_mutex;
+static Uint64 trace_base;
+static dboolean trace_first = true;
+
+static const char *bench_file;
+static Uint64 bench_ticks[NUMPROFZONES];
+static unsigned int bench_hist[BENCH_BUCKETS];
+static unsigned int bench_frames;
+static double bench_max_ms;
+
+#define PROFILING (profiler_overlay || trace_fp || bench_file)
+
+//
+// M_TraceEvent
+//
+// Writes one complete ("X") event; the main thread is tid 1, the audio
+// thread tid 2.
+//
+static void M_TraceEvent(const char *name, Uint64 start, Uint64 duration, int tid)
+{
+  SDL_LockMutex(trace_mutex);
+  if (trace_fp)
+  {
+    fprintf(trace_fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.1f,\"dur\":%.1f}",
+            trace_first ? "" : ",\n", name, tid,
+            (double)(start - trace_base) * 1000000 / perf_freq,
+            (double)duration * 1000000 / perf_freq);
+    trace_first = false;
+  }
+  SDL_UnlockMutex(trace_mutex);
+}
+
+static void M_CloseTrace(void)
+{
+  SDL_LockMutex(trace_mutex);
+  if (trace_fp)
+  {
+    fprintf(trace_fp, "\n]\n");
+    fclose(trace_fp);
+    trace_fp = NULL;
+  }
+  SDL_UnlockMutex(trace_mutex);
+}
+
+void M_InitProfiler(void)
+{
+  int p;
+
+  perf_freq = SDL_GetPerformanceFrequency();
+
+  if ((p = M_CheckParm("-trace")) && p < myargc-1)
+  {
+    trace_mutex = SDL_CreateMutex();
+    trace_base = SDL_GetPerformanceCounter();
+    if (!(trace_fp = fopen(myargv[p+1], "w")))
+    {
+      lprintf(LO_WARN, "M_InitProfiler: couldn't open %s\n", myargv[p+1]);
+      return;
+    }
+    fprintf(trace_fp, "[\n");
+    fprintf(trace_fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}},\n");
+    fprintf(trace_fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"audio\"}}");
+    trace_first = false;
+    atexit(M_CloseTrace);
+  }
+
+  if ((p = M_CheckParm("-benchjson")) && p < myargc-1)
+    bench_file = myargv[p+1];
+}
+
+void M_ProfileBegin(profzone_t zone)
+{
+  if (PROFILING)
+    zone_start[zone] = SDL_GetPerformanceCounter();
+}
+
+void M_ProfileEnd(profzone_t zone)
+{
+  Uint64 start = zone_start[zone];
+  Uint64 duration;
+
+  // Also covers profiling switched on between begin and end
+  if (!PROFILING || !start)
+    return;
+
+  duration = SDL_GetPerformanceCounter() - start;
+  zone_start[zone] = 0;
+
+  if (zone == PROF_AUDIO)
+    SDL_AtomicAdd(&audio_usec, (int)(duration * 1000000 / perf_freq));
+  else
+    frame_ticks[zone] += duration;
+
+  if (bench_file && zone != PROF_AUDIO)
+    bench_ticks[zone] += duration;
+
+  if (trace_fp)
+    M_TraceEvent(zone_names[zone], start, duration, zone == PROF_AUDIO ? 2 : 1);
+}
+
+void M_ProfileEndFrame(void)
+{
+  Uint64 now;
+  profframe_t *frame;
+  int i;
+
+  if (!PROFILING)
+  {
+    frame_start = 0;
+    return;
+  }
+
+  now = SDL_GetPerformanceCounter();
+
+  if (frame_start)
+  {
+    frame = &history[history_pos];
+    history_pos = (history_pos + 1) % PROF_HISTORY;
+
+    for (i = 0; i < NUMPROFZONES; i++)
+      frame->ms[i] = (float)(frame_ticks[i] * 1000.0 / perf_freq);
+    frame->ms[PROF_AUDIO] = SDL_AtomicSet(&audio_usec, 0) / 1000.0f;
+    frame->total = (float)((now - frame_start) * 1000.0 / perf_freq);
+
+    if (trace_fp)
+      M_TraceEvent("Frame", frame_start, now - frame_start, 1);
+
+    if (bench_file)
+    {
+      int bucket = (int)(frame->total * 1000 / BENCH_BUCKET_US);
+
+      bench_hist[BETWEEN(0, BENCH_BUCKETS - 1, bucket)]++;
+      bench_frames++;
+      if (frame->total > bench_max_ms)
+        bench_max_ms = frame->total;
+    }
+  }
+
+  memset(frame_ticks, 0, sizeof(frame_ticks));
+  frame_start = now;
+}
+
+// Frame time in ms below which the given fraction of frames fall
+static double M_BenchPercentile(double fraction)
+{
+  unsigned int target = (unsigned int)(bench_frames * fraction);
+  unsigned int count = 0;
+  int i;
+
+  for (i = 0; i < BENCH_BUCKETS; i++)
+  {
+    count += bench_hist[i];
+    if (count > target)
+      break;
+  }
+  return (MIN(i, BENCH_BUCKETS - 1) + 0.5) * BENCH_BUCKET_US / 1000;
+}
+
+//
+// M_WriteBenchmark
+//
+// Called from G_CheckDemoStatus when a timed demo ends. With -nodraw
+// there are no frames and only the tic rate and stage times count.
+//
+void M_WriteBenchmark(unsigned int gametics, unsigned int realtics)
+{
+  static const char *mode_names[VID_MODEMAX] =
+    { "8bit", "15bit", "16bit", "32bit", "OpenGL" };
+  double seconds = MAX(realtics, 1) / (double)TICRATE;
+  FILE *fp;
+  int i;
+
+  if (!bench_file)
+    return;
+
+  if (!(fp = fopen(bench_file, "w")))
+  {
+    lprintf(LO_WARN, "M_WriteBenchmark: couldn't open %s\n", bench_file);
+    return;
+  }
+
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"mode\": \"%s\",\n", nodrawers ? "nodraw" : mode_names[V_GetMode()]);
+  fprintf(fp, "  \"width\": %d,\n", nodrawers ? 0 : SCREENWIDTH);
+  fprintf(fp, "  \"height\": %d,\n", nodrawers ? 0 : SCREENHEIGHT);
+  fprintf(fp, "  \"gametics\": %u,\n", gametics);
+  fprintf(fp, "  \"seconds\": %.3f,\n", seconds);
+  fprintf(fp, "  \"tics_per_sec\": %.2f,\n", gametics / seconds);
+  fprintf(fp, "  \"frames\": %u,\n", bench_frames);
+  fprintf(fp, "  \"frames_per_sec\": %.2f,\n", bench_frames / seconds);
+  fprintf(fp, "  \"frame_ms_p50\": %.2f,\n", bench_frames ? M_BenchPercentile(0.50) : 0.0);
+  fprintf(fp, "  \"frame_ms_p99\": %.2f,\n", bench_frames ? M_BenchPercentile(0.99) : 0.0);
+  fprintf(fp, "  \"frame_ms_max\": %.2f,\n", bench_max_ms);
+  fprintf(fp, "  \"peak_zone_bytes\": %lu,\n", (unsigned long)Z_PeakMemory());
+  fprintf(fp, "  \"stage_ms\": {");
+  for (i = 0; i < NUMPROFZONES; i++)
+  {
+    if (i == PROF_AUDIO)
+      continue;
+    fprintf(fp, "%s\n    \"%s\": %.1f", i ? "," : "", zone_names[i],
+            bench_ticks[i] * 1000.0 / perf_freq);
+  }
+  fprintf(fp, "\n  }\n}\n");
+  fclose(fp);
+}
+
+//
+// M_ProfileDrawer
+//
+// Stacks the time of each stage of the last PROF_HISTORY frames, nested
+// stages taken out of their parents.
+//
+void M_ProfileDrawer(void)
+{
+  enum { BAR_TICKER, BAR_PLAYSIM, BAR_RENDER, BAR_BSP, BAR_PLANES,
+         BAR_MASKED, BAR_HUD, BAR_PRESENT, BAR_OTHER, NUMBARS };
+  static const byte colors[NUMBARS] = { 104, 112, 64, 176, 216, 231, 200, 251, 80 };
+  int colwidth = MAX(1, SCREENWIDTH / 320);
+  int height = SCREENHEIGHT / 4;
+  int i, j;
+
+  if (!profiler_overlay)
+    return;
+
+  for (i = 0; i < PROF_HISTORY; i++)
+  {
+    const profframe_t *frame = &history[(history_pos + i) % PROF_HISTORY];
+    const float *ms = frame->ms;
+    float bars[NUMBARS];
+    int y = height;
+
+    bars[BAR_TICKER]  = ms[PROF_TICKER] - ms[PROF_PLAYSIM];
+    bars[BAR_PLAYSIM] = ms[PROF_PLAYSIM];
+    bars[BAR_RENDER]  = ms[PROF_RENDER] - ms[PROF_BSP] - ms[PROF_PLANES] - ms[PROF_MASKED];
+    bars[BAR_BSP]     = ms[PROF_BSP];
+    bars[BAR_PLANES]  = ms[PROF_PLANES];
+    bars[BAR_MASKED]  = ms[PROF_MASKED];
+    bars[BAR_HUD]     = ms[PROF_HUD];
+    bars[BAR_PRESENT] = ms[PROF_PRESENT];
+    bars[BAR_OTHER]   = frame->total - ms[PROF_TICKER] - ms[PROF_RENDER] -
+                        ms[PROF_HUD] - ms[PROF_PRESENT];
+
+    for (j = 0; j < NUMBARS && y > 0; j++)
+    {
+      int h = (int)(bars[j] * height / PROF_GRAPH_MS + 0.5f);
+
+      if (h <= 0)
+        continue;
+      if (h > y)
+        h = y;
+      y -= h;
+      V_FillRect(0, i * colwidth, y, colwidth, h, colors[j]);
+    }
+  }
+
+  V_FillRect(0, 0, height - height * 1000 / 35 / PROF_GRAPH_MS,
+             PROF_HISTORY * colwidth, 1, 4);
+  V_FillRect(0, 0, height - height * 1000 / 60 / PROF_GRAPH_MS,
+             PROF_HISTORY * colwidth, 1, 4);
+}
@@ -0,0 +1,64 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Frame pipeline profiler
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifndef __M_PROFILE__
+#define __M_PROFILE__
+
+// Timed stages of a frame. Stages may nest (the playsim runs inside
+// G_Ticker, the BSP walk inside R_RenderPlayerView); the graph shows
+// each nested stage on its own and the remainder under its parent.
+typedef enum
+{
+  PROF_TICKER,    // G_Ticker
+  PROF_PLAYSIM,   // P_Ticker
+  PROF_RENDER,    // R_RenderPlayerView
+  PROF_BSP,       // R_RenderBSPNode
+  PROF_PLANES,    // R_DrawPlanes
+  PROF_MASKED,    // R_DrawMasked
+  PROF_HUD,       // ST_Drawer, HU_Drawer
+  PROF_PRESENT,   // I_FinishUpdate
+  PROF_AUDIO,     // sound mixing callback, on the audio thread
+  NUMPROFZONES
+} profzone_t;
+
+extern int profiler_overlay;
+
+void M_InitProfiler(void);
+void M_ProfileBegin(profzone_t zone);
+void M_ProfileEnd(profzone_t zone);
+void M_ProfileEndFrame(void);
+void M_ProfileDrawer(void);
+void M_WriteBenchmark(unsigned int gametics, unsigned int realtics);
+
+#endif
@@ -2169,6 +2169,7 @@ void A_SkullPop(mobj_t *actor)
   player = actor->player;
   actor->player = NULL;
   mo->player = player;
+  P_CountPlayerSecnodes(mo);
   mo->health = actor->health;
   mo->angle = actor->angle;
   mo->pitch = 0;
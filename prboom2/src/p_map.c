@@ -2054,9 +2054,17 @@ dboolean P_ChangeSector(sector_t* sector,dboolean crunch)
 // sector. Both more accurate and faster.
 //
 
+// The sector being scanned and the node being processed; P_AddSecnode
+// and P_DelSecnode set checkrestart when the scan can't simply carry on.
+static sector_t   *checksector;
+static msecnode_t *checknode;
+static dboolean    checkrestart;
+
 dboolean P_CheckSector(sector_t* sector,dboolean crunch)
 {
   msecnode_t *n;
+  sector_t   *oldsector = checksector;
+  msecnode_t *oldnode = checknode;
 
   if (comp[comp_floors]) /* use the old routine for old demos though */
     return P_ChangeSector(sector,crunch);
@@ -2077,16 +2085,30 @@ dboolean P_CheckSector(sector_t* sector,dboolean crunch)
   for (n=sector->touching_thinglist; n; n=n->m_snext)
     n->visited = false;
 
-  do
-    for (n=sector->touching_thinglist; n; n=n->m_snext)  // go through list
-      if (!n->visited)               // unprocessed thing found
-        {
-        n->visited  = true;          // mark thing as processed
-        if (!(n->m_thing->flags & MF_NOBLOCKMAP)) //jff 4/7/98 don't do these
-          PIT_ChangeSector(n->m_thing);    // process it
-        break;                 // exit and start over
-        }
-  while (n);  // repeat from scratch until all things left are marked valid
+  // Restarting from the beginning only matters when the list changed in
+  // a way that can put an unprocessed thing before the current one: a
+  // node added to this sector (always at the head), or the current node
+  // itself removed. Otherwise the first unvisited node is further on, so
+  // carry on from the current one and keep the scan linear.
+
+  checksector = sector;
+
+  for (n=sector->touching_thinglist; n; )   // go through list
+    if (!n->visited)                 // unprocessed thing found
+      {
+      n->visited  = true;            // mark thing as processed
+      checknode = n;
+      checkrestart = false;
+      if (!(n->m_thing->flags & MF_NOBLOCKMAP)) //jff 4/7/98 don't do these
+        PIT_ChangeSector(n->m_thing);      // process it
+      n = checkrestart ? sector->touching_thinglist : n->m_snext;
+      }
+    else
+      n = n->m_snext;
+
+  checksector = oldsector;
+  checknode = oldnode;
+  checkrestart = true;      // in case this was nested in another scan
 
   return nofit;
 }
@@ -2182,6 +2204,11 @@ msecnode_t* P_AddSecnode(sector_t* s, mobj_t* thing, msecnode_t* nextnode)
     if (node->m_sector == s)   // Already have a node for this sector?
       {
       node->m_thing = thing; // Yes. Setting m_thing says 'keep it'.
+      if (thing->player && !node->m_player)
+        {
+        node->m_player = true;
+        s->touching_players++;
+        }
       return(nextnode);
       }
     node = node->m_tnext;
@@ -2195,6 +2222,15 @@ msecnode_t* P_AddSecnode(sector_t* s, mobj_t* thing, msecnode_t* nextnode)
   // killough 4/4/98, 4/7/98: mark new nodes unvisited.
   node->visited = 0;
 
+  if (s == checksector)     // P_CheckSector has to rescan from the head
+    checkrestart = true;
+
+  // count the players' things touching each sector, so wind and
+  // current pushers can skip sectors no player is in
+  node->m_player = thing->player != NULL;
+  if (node->m_player)
+    s->touching_players++;
+
   node->m_sector = s;       // sector
   node->m_thing  = thing;     // mobj
   node->m_tprev  = NULL;    // prev node on Thing thread
@@ -2249,6 +2285,12 @@ msecnode_t* P_DelSecnode(msecnode_t* node)
     if (sn)
       sn->m_sprev = sp;
 
+    if (node == checknode)  // P_CheckSector loses its place
+      checkrestart = true;
+
+    if (node->m_player)
+      node->m_sector->touching_players--;
+
     // Return this node to the freelist
 
     P_PutSecnode(node);
@@ -2257,6 +2299,24 @@ msecnode_t* P_DelSecnode(msecnode_t* node)
   return(NULL);
 }                               // phares 3/13/98
 
+// A thing can become a player's body after it has been linked, as a
+// newly spawned player does. Count it in the sectors it already touches.
+
+void P_CountPlayerSecnodes(mobj_t* thing)
+{
+  msecnode_t* node;
+
+  if (!thing->player)
+    return;
+
+  for (node = thing->touching_sectorlist; node; node = node->m_tnext)
+    if (!node->m_player)
+      {
+      node->m_player = true;
+      node->m_sector->touching_players++;
+      }
+}
+
 // Delete an entire sector list
 
 void P_DelSeclist(msecnode_t* node)
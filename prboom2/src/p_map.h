@@ -72,6 +72,7 @@ dboolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y);
 dboolean P_ChangeSector(sector_t* sector,dboolean crunch);
 dboolean P_CheckSector(sector_t *sector, dboolean crunch);
 void    P_DelSeclist(msecnode_t*);                          // phares 3/16/98
+void    P_CountPlayerSecnodes(mobj_t*);
 void    P_FreeSecNodeList(void);                            // sf
 void    P_CreateSecNodeList(mobj_t*,fixed_t,fixed_t);       // phares 3/14/98
 dboolean Check_Sides(mobj_t *, int, int);                    // phares
@@ -1179,6 +1179,7 @@ void P_SpawnPlayer (int n, const mapthing_t* mthing)
 
   mobj->angle      = ANG45 * (mthing->angle/45);
   mobj->player     = p;
+  P_CountPlayerSecnodes(mobj);
   mobj->health     = p->health;
   mobj->player->prev_viewangle = mobj->angle + viewangleoffset;
 
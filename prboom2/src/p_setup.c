@@ -34,6 +34,8 @@
 
 #include <math.h>
 
+#include "SDL.h"
+
 #include "doomstat.h"
 #include "m_bbox.h"
 #include "m_argv.h"
@@ -898,6 +900,7 @@ static void P_LoadSectors (int lump)
       ss->tag = LittleShort(ms->tag);
       ss->thinglist = NULL;
       ss->touching_thinglist = NULL;            // phares 3/14/98
+      ss->touching_players = 0;
 
       ss->nextsec = -1; //jff 2/26/98 add fields to support locking out
       ss->prevsec = -1; // stair retriggering until build completes
@@ -1700,114 +1703,59 @@ static void P_LoadSideDefs2(int lump)
                                  // jff 10/8/98 use guardband>0
                                  // jff 10/12/98 0 ok with + 1 in rows,cols
 
-typedef struct linelist_t        // type used to list lines in each block
+#define BLOCKMAP_MAXTHREADS 16
+#define BLOCKMAP_LINESPERTHREAD 16384 // fewer lines aren't worth a thread
+
+// Per thread state of the two blockmap passes. Each thread walks its own
+// range of lines; the first pass counts the lines in each block, the
+// second writes them to blockmaplump from the cursors set up after it.
+
+typedef struct
 {
-  long num;
-  struct linelist_t *next;
-} linelist_t;
+  int xorg,yorg;                 // blockmap origin (lower left)
+  int nrows,ncols;               // blockmap dimensions
+  int firstline,lastline;        // lines [firstline,lastline) of this thread
+  int *blockdone;                // line number+1 last added to each block
+  int *blockcount;               // lines of this thread in each block
+  int *blockcursor;              // where the next line goes, NULL when counting
+} blockmapjob_t;
 
 //
 // Subroutine to add a line number to a block list
 // It simply returns if the line is already in the block
 //
 
-static void AddBlockLine
-(
-  linelist_t **lists,
-  int *count,
-  int *done,
-  int blockno,
-  long lineno
-)
+static void AddBlockLine(blockmapjob_t *job, int blockno, int lineno)
 {
-  linelist_t *l;
-
-  if (done[blockno])
+  if (job->blockdone[blockno] == lineno+1)
     return;
 
-  l = malloc(sizeof(linelist_t));
-  l->num = lineno;
-  l->next = lists[blockno];
-  lists[blockno] = l;
-  count[blockno]++;
-  done[blockno] = 1;
+  job->blockdone[blockno] = lineno+1;
+  if (job->blockcursor)
+    blockmaplump[job->blockcursor[blockno]--] = lineno;
+  else
+    job->blockcount[blockno]++;
 }
 
 //
-// Actually construct the blockmap lump from the level data
+// For each of the job's lines, determine all blockmap blocks it touches,
+// and add the linedef number to the blocklists for those blocks
 //
 // This finds the intersection of each linedef with the column and
 // row lines at the left and bottom of each blockmap cell. It then
 // adds the line to all block lists touching the intersection.
 //
 
-static void P_CreateBlockMap(void)
+static int P_BlockMapLines(void *data)
 {
-  int xorg,yorg;                 // blockmap origin (lower left)
-  int nrows,ncols;               // blockmap dimensions
-  linelist_t **blocklists=NULL;  // array of pointers to lists of lines
-  int *blockcount=NULL;          // array of counters of line lists
-  int *blockdone=NULL;           // array keeping track of blocks/line
-  int NBlocks;                   // number of cells = nrows*ncols
-  long linetotal=0;              // total length of all blocklists
+  blockmapjob_t *job = data;
+  int xorg = job->xorg, yorg = job->yorg;
+  int ncols = job->ncols, nrows = job->nrows;
   int i,j;
-  int map_minx=INT_MAX;          // init for map limits search
-  int map_miny=INT_MAX;
-  int map_maxx=INT_MIN;
-  int map_maxy=INT_MIN;
 
-  // scan for map limits, which the blockmap must enclose
+  memset(job->blockdone,0,ncols*nrows*sizeof(int));
 
-  for (i=0;i<numvertexes;i++)
-  {
-    fixed_t t;
-
-    if ((t=vertexes[i].x) < map_minx)
-      map_minx = t;
-    else if (t > map_maxx)
-      map_maxx = t;
-    if ((t=vertexes[i].y) < map_miny)
-      map_miny = t;
-    else if (t > map_maxy)
-      map_maxy = t;
-  }
-  map_minx >>= FRACBITS;    // work in map coords, not fixed_t
-  map_maxx >>= FRACBITS;
-  map_miny >>= FRACBITS;
-  map_maxy >>= FRACBITS;
-
-  // set up blockmap area to enclose level plus margin
-
-  xorg = map_minx-blkmargin;
-  yorg = map_miny-blkmargin;
-  ncols = (map_maxx+blkmargin-xorg+1+blkmask)>>blkshift;  //jff 10/12/98
-  nrows = (map_maxy+blkmargin-yorg+1+blkmask)>>blkshift;  //+1 needed for
-  NBlocks = ncols*nrows;                                  //map exactly 1 cell
-
-  // create the array of pointers on NBlocks to blocklists
-  // also create an array of linelist counts on NBlocks
-  // finally make an array in which we can mark blocks done per line
-
-  // CPhipps - calloc's
-  blocklists = calloc(NBlocks,sizeof(linelist_t *));
-  blockcount = calloc(NBlocks,sizeof(int));
-  blockdone = malloc(NBlocks*sizeof(int));
-
-  // initialize each blocklist, and enter the trailing -1 in all blocklists
-  // note the linked list of lines grows backwards
-
-  for (i=0;i<NBlocks;i++)
-  {
-    blocklists[i] = malloc(sizeof(linelist_t));
-    blocklists[i]->num = -1;
-    blocklists[i]->next = NULL;
-    blockcount[i]++;
-  }
-
-  // For each linedef in the wad, determine all blockmap blocks it touches,
-  // and add the linedef number to the blocklists for those blocks
-
-  for (i=0;i<numlines;i++)
+  for (i=job->firstline;i<job->lastline;i++)
   {
     int x1 = lines[i].v1->x>>FRACBITS;         // lines[i] map coords
     int y1 = lines[i].v1->y>>FRACBITS;
@@ -1825,27 +1773,23 @@ static void P_CreateBlockMap(void)
     int miny = y1>y2? y2 : y1;
     int maxy = y1>y2? y1 : y2;
 
-    // no blocks done for this linedef yet
-
-    memset(blockdone,0,NBlocks*sizeof(int));
-
     // The line always belongs to the blocks containing its endpoints
 
     bx = (x1-xorg)>>blkshift;
     by = (y1-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+    AddBlockLine(job,by*ncols+bx,i);
     bx = (x2-xorg)>>blkshift;
     by = (y2-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+    AddBlockLine(job,by*ncols+bx,i);
 
 
     // For each column, see where the line along its left edge, which
     // it contains, intersects the Linedef i. Add i to each corresponding
-    // blocklist.
+    // blocklist. Only the columns from minx to maxx can touch the line.
 
     if (!vert)    // don't interesect vertical lines with columns
     {
-      for (j=0;j<ncols;j++)
+      for (j=(minx-xorg+blkmask)>>blkshift;j<=(maxx-xorg)>>blkshift && j<ncols;j++)
       {
         // intersection of Linedef with x=xorg+(j<<blkshift)
         // (y-y1)*dx = dy*(x-x1)
@@ -1859,12 +1803,9 @@ static void P_CreateBlockMap(void)
         if (yb<0 || yb>nrows-1)     // outside blockmap, continue
           continue;
 
-        if (x<minx || x>maxx)       // line doesn't touch column
-          continue;
-
         // The cell that contains the intersection point is always added
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j,i);
+        AddBlockLine(job,ncols*yb+j,i);
 
         // if the intersection is at a corner it depends on the slope
         // (and whether the line extends past the intersection) which
@@ -1875,33 +1816,33 @@ static void P_CreateBlockMap(void)
           if (sneg)       //   \ - blocks x,y-, x-,y
           {
             if (yb>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j,i);
+              AddBlockLine(job,ncols*(yb-1)+j,i);
             if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+              AddBlockLine(job,ncols*yb+j-1,i);
           }
           else if (spos)  //   / - block x-,y-
           {
             if (yb>0 && j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j-1,i);
+              AddBlockLine(job,ncols*(yb-1)+j-1,i);
           }
           else if (horiz) //   - - block x-,y
           {
             if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+              AddBlockLine(job,ncols*yb+j-1,i);
           }
         }
         else if (j>0 && minx<x) // else not at corner: x-,y
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+          AddBlockLine(job,ncols*yb+j-1,i);
       }
     }
 
     // For each row, see where the line along its bottom edge, which
     // it contains, intersects the Linedef i. Add i to all the corresponding
-    // blocklists.
+    // blocklists. Only the rows from miny to maxy can touch the line.
 
     if (!horiz)
     {
-      for (j=0;j<nrows;j++)
+      for (j=(miny-yorg+blkmask)>>blkshift;j<=(maxy-yorg)>>blkshift && j<nrows;j++)
       {
         // intersection of Linedef with y=yorg+(j<<blkshift)
         // (x,y) on Linedef i satisfies: (y-y1)*dx = dy*(x-x1)
@@ -1915,12 +1856,9 @@ static void P_CreateBlockMap(void)
         if (xb<0 || xb>ncols-1)   // outside blockmap, continue
           continue;
 
-        if (y<miny || y>maxy)     // line doesn't touch row
-          continue;
-
         // The cell that contains the intersection point is always added
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb,i);
+        AddBlockLine(job,ncols*j+xb,i);
 
         // if the intersection is at a corner it depends on the slope
         // (and whether the line extends past the intersection) which
@@ -1931,35 +1869,135 @@ static void P_CreateBlockMap(void)
           if (sneg)       //   \ - blocks x,y-, x-,y
           {
             if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+              AddBlockLine(job,ncols*(j-1)+xb,i);
             if (xb>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb-1,i);
+              AddBlockLine(job,ncols*j+xb-1,i);
           }
           else if (vert)  //   | - block x,y-
           {
             if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+              AddBlockLine(job,ncols*(j-1)+xb,i);
           }
           else if (spos)  //   / - block x-,y-
           {
             if (xb>0 && j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb-1,i);
+              AddBlockLine(job,ncols*(j-1)+xb-1,i);
           }
         }
         else if (j>0 && miny<y) // else not on a corner: x,y-
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+          AddBlockLine(job,ncols*(j-1)+xb,i);
       }
     }
   }
 
-  // Add initial 0 to all blocklists
-  // count the total number of lines (and 0's and -1's)
+  return 0;
+}
+
+// Runs P_BlockMapLines for every job, all but the first on threads of
+// their own.
+
+static void P_RunBlockMapJobs(blockmapjob_t *jobs, int numjobs)
+{
+  SDL_Thread *threads[BLOCKMAP_MAXTHREADS];
+  int i;
+
+  for (i=1;i<numjobs;i++)
+    threads[i] = SDL_CreateThread(P_BlockMapLines, "blockmap_thread", &jobs[i]);
+
+  P_BlockMapLines(&jobs[0]);
+
+  for (i=1;i<numjobs;i++)
+  {
+    if (threads[i])
+      SDL_WaitThread(threads[i], NULL);
+    else
+      P_BlockMapLines(&jobs[i]);
+  }
+}
+
+//
+// Actually construct the blockmap lump from the level data
+//
+// Every block list is 0, the lines in the block from the highest number
+// down, and -1. The lines are counted per block first so that the lists
+// can be written straight into place by a second pass over the lines;
+// both passes split the lines between threads on big levels.
+//
+
+static void P_CreateBlockMap(void)
+{
+  int xorg,yorg;                 // blockmap origin (lower left)
+  int nrows,ncols;               // blockmap dimensions
+  blockmapjob_t jobs[BLOCKMAP_MAXTHREADS];
+  int numjobs;
+  int NBlocks;                   // number of cells = nrows*ncols
+  long linetotal=0;              // total length of all blocklists
+  long offs;
+  int i,t;
+  int map_minx=INT_MAX;          // init for map limits search
+  int map_miny=INT_MAX;
+  int map_maxx=INT_MIN;
+  int map_maxy=INT_MIN;
+  unsigned int starttime = SDL_GetTicks();
+
+  // scan for map limits, which the blockmap must enclose
 
-  memset(blockdone,0,NBlocks*sizeof(int));
-  for (i=0,linetotal=0;i<NBlocks;i++)
+  for (i=0;i<numvertexes;i++)
   {
-    AddBlockLine(blocklists,blockcount,blockdone,i,0);
-    linetotal += blockcount[i];
+    fixed_t t;
+
+    if ((t=vertexes[i].x) < map_minx)
+      map_minx = t;
+    else if (t > map_maxx)
+      map_maxx = t;
+    if ((t=vertexes[i].y) < map_miny)
+      map_miny = t;
+    else if (t > map_maxy)
+      map_maxy = t;
+  }
+  map_minx >>= FRACBITS;    // work in map coords, not fixed_t
+  map_maxx >>= FRACBITS;
+  map_miny >>= FRACBITS;
+  map_maxy >>= FRACBITS;
+
+  // set up blockmap area to enclose level plus margin
+
+  xorg = map_minx-blkmargin;
+  yorg = map_miny-blkmargin;
+  ncols = (map_maxx+blkmargin-xorg+1+blkmask)>>blkshift;  //jff 10/12/98
+  nrows = (map_maxy+blkmargin-yorg+1+blkmask)>>blkshift;  //+1 needed for
+  NBlocks = ncols*nrows;                                  //map exactly 1 cell
+
+  // split the lines between the jobs, each with its own arrays
+
+  numjobs = numlines < BLOCKMAP_LINESPERTHREAD ? 1 :
+    BETWEEN(1, MIN(BLOCKMAP_MAXTHREADS, numlines/BLOCKMAP_LINESPERTHREAD),
+            SDL_GetCPUCount());
+
+  for (t=0;t<numjobs;t++)
+  {
+    jobs[t].xorg = xorg;
+    jobs[t].yorg = yorg;
+    jobs[t].ncols = ncols;
+    jobs[t].nrows = nrows;
+    jobs[t].firstline = (int)((long long)numlines*t/numjobs);
+    jobs[t].lastline = (int)((long long)numlines*(t+1)/numjobs);
+    jobs[t].blockdone = malloc(NBlocks*sizeof(int));
+    jobs[t].blockcount = calloc(NBlocks,sizeof(int));
+    jobs[t].blockcursor = NULL;
+  }
+
+  // first pass: count the lines in each block
+
+  P_RunBlockMapJobs(jobs, numjobs);
+
+  // each list adds the initial 0 and the trailing -1 to its lines
+
+  for (i=0;i<NBlocks;i++)
+  {
+    linetotal += 2;
+    for (t=0;t<numjobs;t++)
+      linetotal += jobs[t].blockcount[i];
   }
 
   // Create the blockmap lump
@@ -1972,31 +2010,45 @@ static void P_CreateBlockMap(void)
   blockmaplump[2] = bmapwidth  = ncols;
   blockmaplump[3] = bmapheight = nrows;
 
-  // offsets to lists and block lists
+  // offsets to lists, and the cursors each job fills its part of a list
+  // from; lines go in from the end so the highest numbers come first,
+  // and the last job's lines come before the others'
 
-  for (i=0;i<NBlocks;i++)
+  for (i=0,offs=4+NBlocks;i<NBlocks;i++)
   {
-    linelist_t *bl = blocklists[i];
-    long offs = blockmaplump[4+i] =   // set offset to block's list
-      (i? blockmaplump[4+i-1] : 4+NBlocks) + (i? blockcount[i-1] : 0);
-
-    // add the lines in each block's list to the blockmaplump
-    // delete each list node as we go
+    long linecount = 0;
 
-    while (bl)
+    blockmaplump[4+i] = offs;         // set offset to block's list
+    blockmaplump[offs] = 0;
+    for (t=numjobs-1;t>=0;t--)
     {
-      linelist_t *tmp = bl->next;
-      blockmaplump[offs++] = bl->num;
-      free(bl);
-      bl = tmp;
+      linecount += jobs[t].blockcount[i];
+      jobs[t].blockcount[i] = offs + linecount;
     }
+    blockmaplump[offs + linecount + 1] = -1;
+    offs += linecount + 2;
   }
 
+  // second pass: write the lines, reusing the counts as cursors
+
+  for (t=0;t<numjobs;t++)
+  {
+    jobs[t].blockcursor = jobs[t].blockcount;
+    jobs[t].blockcount = NULL;
+  }
+
+  P_RunBlockMapJobs(jobs, numjobs);
+
   // free all temporary storage
 
-  free (blocklists);
-  free (blockcount);
-  free (blockdone);
+  for (t=0;t<numjobs;t++)
+  {
+    free(jobs[t].blockdone);
+    free(jobs[t].blockcursor);
+  }
+
+  lprintf(LO_INFO, "P_CreateBlockMap: %d lines, %dx%d blocks in %u ms (%d thread%s)\n",
+          numlines, ncols, nrows, SDL_GetTicks() - starttime, numjobs, numjobs > 1 ? "s" : "");
 }
 
 // jff 10/6/98
@@ -2864,4 +2916,5 @@ void P_Init (void)
   P_InitSwitchList();
   P_InitPicAnims();
   R_InitSprites(sprnames);
+  P_InitThinkerStats();
 }
@@ -2767,7 +2767,24 @@ void P_SpawnSpecials (void)
 // This is the main scrolling code
 // killough 3/7/98
 
-void T_Scroll(scroll_t *s)
+// Carriers of one sector that run one after another are applied in a
+// single walk of its touching_thinglist by the first of them. The rest
+// are listed here and return at once when their turn comes, which is
+// within the same tic, so the list is always used up by the tic's end.
+
+#define CARRY_BATCH 8
+
+static scroll_t *carry_batch[CARRY_BATCH];
+static int carry_batch_len, carry_batch_pos;
+
+//
+// P_ScrollDelta
+//
+// Updates a scroller's control and acceleration state and returns how
+// far it scrolls this tic.
+//
+
+static void P_ScrollDelta(scroll_t *s, fixed_t *pdx, fixed_t *pdy)
 {
   fixed_t dx = s->dx, dy = s->dy;
 
@@ -2788,6 +2805,96 @@ void T_Scroll(scroll_t *s)
       s->vdy = dy += s->vdy;
     }
 
+  *pdx = dx;
+  *pdy = dy;
+}
+
+//
+// P_CarryThings
+//
+// Moves things on the floor of a carrier's sector, together with the
+// carriers of the same sector that follow it in the thinker list. Only
+// texture scrollers may come between them, and those don't touch
+// things, so each thing gets exactly the additions it got from the
+// carriers one at a time and in the same order.
+//
+
+static void P_CarryThings(scroll_t *s, fixed_t dx, fixed_t dy)
+{
+  sector_t *sec = sectors + s->affectee;
+  fixed_t height, waterheight;  // killough 4/4/98: add waterheight
+  fixed_t batchdx[CARRY_BATCH + 1], batchdy[CARRY_BATCH + 1];
+  thinker_t *th;
+  msecnode_t *node;
+  mobj_t *thing;
+  int i;
+
+  // nothing touching the sector: the followers see the same and return
+  if (!sec->touching_thinglist)
+    return;
+
+  batchdx[0] = dx;
+  batchdy[0] = dy;
+  carry_batch_len = carry_batch_pos = 0;
+  for (th = s->thinker.next;
+       th != &thinkercap && th->function == T_Scroll && carry_batch_len < CARRY_BATCH;
+       th = th->next)
+    {
+      scroll_t *next = (scroll_t *)th;
+
+      if (next->type != sc_carry)
+        continue;
+      if (next->affectee != s->affectee)
+        break;
+
+      // its state is updated now rather than when it runs; nothing that
+      // runs in between can change the control sector
+      P_ScrollDelta(next, &batchdx[carry_batch_len + 1], &batchdy[carry_batch_len + 1]);
+      carry_batch[carry_batch_len++] = next;
+    }
+
+  // killough 3/7/98: Carry things on floor
+  // killough 3/20/98: use new sector list which reflects true members
+  // killough 3/27/98: fix carrier bug
+  // killough 4/4/98: Underwater, carry things even w/o gravity
+
+  height = sec->floorheight;
+  waterheight = sec->heightsec != -1 &&
+    sectors[sec->heightsec].floorheight > height ?
+    sectors[sec->heightsec].floorheight : INT_MIN;
+
+  for (node = sec->touching_thinglist; node; node = node->m_snext)
+    if (!((thing = node->m_thing)->flags & MF_NOCLIP) &&
+        (!(thing->flags & MF_NOGRAVITY || thing->z > height) ||
+         thing->z < waterheight))
+      {
+        // Move objects only if on floor or underwater,
+        // non-floating, and clipped.
+        for (i = 0; i <= carry_batch_len; i++)
+          {
+            thing->momx += batchdx[i];
+            thing->momy += batchdy[i];
+          }
+      }
+}
+
+//
+// T_Scroll
+//
+
+void T_Scroll(scroll_t *s)
+{
+  fixed_t dx, dy;
+
+  // already applied by the carrier ahead of it this tic
+  if (carry_batch_pos < carry_batch_len && carry_batch[carry_batch_pos] == s)
+    {
+      carry_batch_pos++;
+      return;
+    }
+
+  P_ScrollDelta(s, &dx, &dy);
+
   if (!(dx | dy))                   // no-op if both (x,y) offsets 0
     return;
 
@@ -2795,9 +2902,6 @@ void T_Scroll(scroll_t *s)
     {
       side_t *side;
       sector_t *sec;
-      fixed_t height, waterheight;  // killough 4/4/98: add waterheight
-      msecnode_t *node;
-      mobj_t *thing;
 
     case sc_side:                   // killough 3/7/98: Scroll wall texture
         side = sides + s->affectee;
@@ -2818,28 +2922,7 @@ void T_Scroll(scroll_t *s)
         break;
 
     case sc_carry:
-
-      // killough 3/7/98: Carry things on floor
-      // killough 3/20/98: use new sector list which reflects true members
-      // killough 3/27/98: fix carrier bug
-      // killough 4/4/98: Underwater, carry things even w/o gravity
-
-      sec = sectors + s->affectee;
-      height = sec->floorheight;
-      waterheight = sec->heightsec != -1 &&
-        sectors[sec->heightsec].floorheight > height ?
-        sectors[sec->heightsec].floorheight : INT_MIN;
-
-      for (node = sec->touching_thinglist; node; node = node->m_snext)
-        if (!((thing = node->m_thing)->flags & MF_NOCLIP) &&
-            (!(thing->flags & MF_NOGRAVITY || thing->z > height) ||
-             thing->z < waterheight))
-          {
-            // Move objects only if on floor or underwater,
-            // non-floating, and clipped.
-            thing->momx += dx;
-            thing->momy += dy;
-          }
+      P_CarryThings(s, dx, dy);
       break;
 
     case sc_carry_ceiling:       // to be added later
@@ -3331,6 +3414,77 @@ static dboolean PIT_PushThing(mobj_t* thing)
   return true;
 }
 
+/////////////////////////////
+//
+// P_ConstantPush applies a wind or current pusher to a player's thing
+// touching its sector. ht is the floor of the sector's water, if any.
+//
+
+static void P_ConstantPush(const pusher_t *p, const sector_t *sec, mobj_t *thing, int ht)
+{
+    int xspeed,yspeed;
+
+    if (p->type == p_wind)
+        {
+        if (sec->heightsec == -1) // NOT special water sector
+            if (thing->z > thing->floorz) // above ground
+                {
+                xspeed = p->x_mag; // full force
+                yspeed = p->y_mag;
+                }
+            else // on ground
+                {
+                xspeed = (p->x_mag)>>1; // half force
+                yspeed = (p->y_mag)>>1;
+                }
+        else // special water sector
+            {
+            if (thing->z > ht) // above ground
+                {
+                xspeed = p->x_mag; // full force
+                yspeed = p->y_mag;
+                }
+            else if (thing->player->viewz < ht) // underwater
+                xspeed = yspeed = 0; // no force
+            else // wading in water
+                {
+                xspeed = (p->x_mag)>>1; // half force
+                yspeed = (p->y_mag)>>1;
+                }
+            }
+        }
+    else // p_current
+        {
+        if (sec->heightsec == -1) // NOT special water sector
+            if (thing->z > sec->floorheight) // above ground
+                xspeed = yspeed = 0; // no force
+            else // on ground
+                {
+                xspeed = p->x_mag; // full force
+                yspeed = p->y_mag;
+                }
+        else // special water sector
+            if (thing->z > ht) // above ground
+                xspeed = yspeed = 0; // no force
+            else // underwater
+                {
+                xspeed = p->x_mag; // full force
+                yspeed = p->y_mag;
+                }
+        }
+    thing->momx += xspeed<<(FRACBITS-PUSH_FACTOR);
+    thing->momy += yspeed<<(FRACBITS-PUSH_FACTOR);
+}
+
+// Wind and current pushers of one sector that run one after another are
+// applied in a single walk of its touching_thinglist by the first one,
+// as carriers are; see carry_batch.
+
+#define PUSH_BATCH 8
+
+static pusher_t *push_batch[PUSH_BATCH];
+static int push_batch_len, push_batch_pos;
+
 /////////////////////////////
 //
 // T_Pusher looks for all objects that are inside the radius of
@@ -3342,10 +3496,18 @@ void T_Pusher(pusher_t *p)
     sector_t *sec;
     mobj_t   *thing;
     msecnode_t* node;
-    int xspeed,yspeed;
+    thinker_t *th;
     int xl,xh,yl,yh,bx,by;
     int radius;
     int ht = 0;
+    int i;
+
+    // already applied by the pusher ahead of it this tic
+    if (push_batch_pos < push_batch_len && push_batch[push_batch_pos] == p)
+        {
+        push_batch_pos++;
+        return;
+        }
 
     if (!allow_pushers)
         return;
@@ -3385,10 +3547,16 @@ void T_Pusher(pusher_t *p)
         tmbbox[BOXRIGHT]  = p->x + radius;
         tmbbox[BOXLEFT]   = p->x - radius;
 
-        xl = P_GetSafeBlockX(tmbbox[BOXLEFT] - bmaporgx - MAXRADIUS);
-        xh = P_GetSafeBlockX(tmbbox[BOXRIGHT] - bmaporgx + MAXRADIUS);
-        yl = P_GetSafeBlockY(tmbbox[BOXBOTTOM] - bmaporgy - MAXRADIUS);
-        yh = P_GetSafeBlockY(tmbbox[BOXTOP] - bmaporgy + MAXRADIUS);
+        // Things are linked into the block holding their centre, and
+        // PIT_PushThing does nothing to a thing whose centre is not
+        // within radius of the source on both axes (P_AproxDistance is
+        // never less than the larger of the two), so the usual MAXRADIUS
+        // margin would only add blocks that can't be affected.
+
+        xl = P_GetSafeBlockX(tmbbox[BOXLEFT] - bmaporgx);
+        xh = P_GetSafeBlockX(tmbbox[BOXRIGHT] - bmaporgx);
+        yl = P_GetSafeBlockY(tmbbox[BOXBOTTOM] - bmaporgy);
+        yh = P_GetSafeBlockY(tmbbox[BOXTOP] - bmaporgy);
         for (bx=xl ; bx<=xh ; bx++)
             for (by=yl ; by<=yh ; by++)
                 P_BlockThingsIterator(bx,by,PIT_PushThing);
@@ -3397,6 +3565,24 @@ void T_Pusher(pusher_t *p)
 
     // constant pushers p_wind and p_current
 
+    // only players' things are pushed; the followers see the same
+    if (!sec->touching_players)
+        return;
+
+    // each thing gets the same pushes in the same order as it would from
+    // the pushers one at a time, as they only change its momentum
+    push_batch_len = push_batch_pos = 0;
+    for (th = p->thinker.next;
+         th != &thinkercap && th->function == T_Pusher && push_batch_len < PUSH_BATCH;
+         th = th->next)
+        {
+        pusher_t *next = (pusher_t *)th;
+
+        if (next->type == p_push || next->affectee != p->affectee)
+            break;
+        push_batch[push_batch_len++] = next;
+        }
+
     if (sec->heightsec != -1) // special water sector?
         ht = sectors[sec->heightsec].floorheight;
     node = sec->touching_thinglist; // things touching this sector
@@ -3405,56 +3591,9 @@ void T_Pusher(pusher_t *p)
         thing = node->m_thing;
         if (!thing->player || (thing->flags & (MF_NOGRAVITY | MF_NOCLIP)))
             continue;
-        if (p->type == p_wind)
-            {
-            if (sec->heightsec == -1) // NOT special water sector
-                if (thing->z > thing->floorz) // above ground
-                    {
-                    xspeed = p->x_mag; // full force
-                    yspeed = p->y_mag;
-                    }
-                else // on ground
-                    {
-                    xspeed = (p->x_mag)>>1; // half force
-                    yspeed = (p->y_mag)>>1;
-                    }
-            else // special water sector
-                {
-                if (thing->z > ht) // above ground
-                    {
-                    xspeed = p->x_mag; // full force
-                    yspeed = p->y_mag;
-                    }
-                else if (thing->player->viewz < ht) // underwater
-                    xspeed = yspeed = 0; // no force
-                else // wading in water
-                    {
-                    xspeed = (p->x_mag)>>1; // half force
-                    yspeed = (p->y_mag)>>1;
-                    }
-                }
-            }
-        else // p_current
-            {
-            if (sec->heightsec == -1) // NOT special water sector
-                if (thing->z > sec->floorheight) // above ground
-                    xspeed = yspeed = 0; // no force
-                else // on ground
-                    {
-                    xspeed = p->x_mag; // full force
-                    yspeed = p->y_mag;
-                    }
-            else // special water sector
-                if (thing->z > ht) // above ground
-                    xspeed = yspeed = 0; // no force
-                else // underwater
-                    {
-                    xspeed = p->x_mag; // full force
-                    yspeed = p->y_mag;
-                    }
-            }
-        thing->momx += xspeed<<(FRACBITS-PUSH_FACTOR);
-        thing->momy += yspeed<<(FRACBITS-PUSH_FACTOR);
+        P_ConstantPush(p, sec, thing, ht);
+        for (i = 0; i < push_batch_len; i++)
+            P_ConstantPush(push_batch[i], sec, thing, ht);
         }
 }
 
@@ -39,6 +39,9 @@
 #include "r_fps.h"
 #include "e6y.h"
 #include "s_advsound.h"
+#include "m_argv.h"
+#include "lprintf.h"
+#include "SDL.h"
 
 int leveltime;
 
@@ -217,6 +220,160 @@ void P_SetTarget(mobj_t **mop, mobj_t *targ)
     targ->thinker.references++;
 }
 
+//
+// Thinker cost accounting
+//
+// With -thinkerstats [file] P_RunThinkers times every thinker call,
+// adding it up per thinker function and, for P_MobjThinker, per mobj
+// type. P_WriteThinkerStats reports and resets the totals at the end of
+// each level, appending them to a CSV file (thinkerstats.csv by default).
+//
+
+typedef struct
+{
+  think_t function;
+  const char *name;
+  unsigned int calls;
+  Uint64 ticks;
+} thinkerstat_t;
+
+static thinkerstat_t thinkerstats[] =
+{
+  { (think_t)P_MobjThinker,          "P_MobjThinker" },
+  { (think_t)T_MoveFloor,            "T_MoveFloor" },
+  { (think_t)T_MoveCeiling,          "T_MoveCeiling" },
+  { (think_t)T_MoveElevator,         "T_MoveElevator" },
+  { (think_t)T_VerticalDoor,         "T_VerticalDoor" },
+  { (think_t)T_PlatRaise,            "T_PlatRaise" },
+  { (think_t)T_Scroll,               "T_Scroll" },
+  { (think_t)T_Pusher,               "T_Pusher" },
+  { (think_t)T_Friction,             "T_Friction" },
+  { (think_t)T_LightFlash,           "T_LightFlash" },
+  { (think_t)T_StrobeFlash,          "T_StrobeFlash" },
+  { (think_t)T_FireFlicker,          "T_FireFlicker" },
+  { (think_t)T_Glow,                 "T_Glow" },
+  { (think_t)P_RemoveThinkerDelayed, "P_RemoveThinkerDelayed" },
+  { NULL,                            "other" } // must be last
+};
+
+#define NUMTHINKERSTATS (sizeof(thinkerstats)/sizeof(thinkerstats[0]))
+
+static struct
+{
+  unsigned int calls;
+  Uint64 ticks;
+} mobjtypestats[NUMMOBJTYPES];
+
+static const char *thinkerstats_file;
+static dboolean thinkerstats_header;
+
+static thinkerstat_t *P_ThinkerStat(think_t function)
+{
+  thinkerstat_t *stat = thinkerstats;
+
+  while (stat->function && stat->function != function)
+    stat++;
+  return stat;
+}
+
+void P_WriteThinkerStats(void)
+{
+  double ms = 1000.0 / SDL_GetPerformanceFrequency();
+  Uint64 total = 0;
+  FILE *f;
+  size_t i;
+
+  if (!thinkerstats_file)
+    return;
+
+  for (i = 0; i < NUMTHINKERSTATS; i++)
+    total += thinkerstats[i].ticks;
+  if (!total)
+    return;
+
+  lprintf(LO_INFO, "P_WriteThinkerStats: %s, %d tics, %.1f ms in thinkers\n",
+          MAPNAME(gameepisode, gamemap), leveltime, total * ms);
+  for (i = 0; i < NUMTHINKERSTATS; i++)
+    if (thinkerstats[i].calls)
+      lprintf(LO_INFO, " %-24s %10u calls %10.1f ms %5.1f%%\n",
+              thinkerstats[i].name, thinkerstats[i].calls,
+              thinkerstats[i].ticks * ms, 100.0 * thinkerstats[i].ticks / total);
+
+  if ((f = fopen(thinkerstats_file, thinkerstats_header ? "a" : "w")))
+  {
+    if (!thinkerstats_header)
+      fprintf(f, "map,tics,kind,name,calls,ms,us_per_call\n");
+    thinkerstats_header = true;
+
+    for (i = 0; i < NUMTHINKERSTATS; i++)
+      if (thinkerstats[i].calls)
+        fprintf(f, "%s,%d,function,%s,%u,%.3f,%.3f\n",
+                MAPNAME(gameepisode, gamemap), leveltime, thinkerstats[i].name,
+                thinkerstats[i].calls, thinkerstats[i].ticks * ms,
+                thinkerstats[i].ticks * ms * 1000 / thinkerstats[i].calls);
+    for (i = 0; i < NUMMOBJTYPES; i++)
+      if (mobjtypestats[i].calls)
+        fprintf(f, "%s,%d,mobjtype,%d,%u,%.3f,%.3f\n",
+                MAPNAME(gameepisode, gamemap), leveltime, (int)i,
+                mobjtypestats[i].calls, mobjtypestats[i].ticks * ms,
+                mobjtypestats[i].ticks * ms * 1000 / mobjtypestats[i].calls);
+    fclose(f);
+  }
+
+  for (i = 0; i < NUMTHINKERSTATS; i++)
+  {
+    thinkerstats[i].calls = 0;
+    thinkerstats[i].ticks = 0;
+  }
+  memset(mobjtypestats, 0, sizeof(mobjtypestats));
+}
+
+void P_InitThinkerStats(void)
+{
+  int p;
+
+  if ((p = M_CheckParm("-thinkerstats")))
+  {
+    thinkerstats_file = "thinkerstats.csv";
+    if (p < myargc-1 && *myargv[p+1] != '-')
+      thinkerstats_file = myargv[p+1];
+    atexit(P_WriteThinkerStats); // the level a demo ends on
+  }
+}
+
+// Same as the loop in P_RunThinkers, with the timing around each call
+static void P_RunThinkersTimed(void)
+{
+  for (currentthinker = thinkercap.next;
+       currentthinker != &thinkercap;
+       currentthinker = currentthinker->next)
+  {
+    think_t function = currentthinker->function;
+
+    if (newthinkerpresent)
+      R_ActivateThinkerInterpolations(currentthinker);
+    if (function)
+    {
+      thinkerstat_t *stat = P_ThinkerStat(function);
+      // the thinker may be gone after the call
+      int type = (function == (think_t)P_MobjThinker ? ((mobj_t *)currentthinker)->type : -1);
+      Uint64 start = SDL_GetPerformanceCounter();
+      Uint64 ticks;
+
+      function(currentthinker);
+
+      ticks = SDL_GetPerformanceCounter() - start;
+      stat->calls++;
+      stat->ticks += ticks;
+      if (type >= 0)
+      {
+        mobjtypestats[type].calls++;
+        mobjtypestats[type].ticks += ticks;
+      }
+    }
+  }
+}
+
 //
 // P_RunThinkers
 //
@@ -242,15 +399,18 @@ void P_SetTarget(mobj_t **mop, mobj_t *targ)
 
 static void P_RunThinkers (void)
 {
-  for (currentthinker = thinkercap.next;
-       currentthinker != &thinkercap;
-       currentthinker = currentthinker->next)
-  {
-    if (newthinkerpresent)
-      R_ActivateThinkerInterpolations(currentthinker);
-    if (currentthinker->function)
-      currentthinker->function(currentthinker);
-  }
+  if (thinkerstats_file)
+    P_RunThinkersTimed();
+  else
+    for (currentthinker = thinkercap.next;
+         currentthinker != &thinkercap;
+         currentthinker = currentthinker->next)
+    {
+      if (newthinkerpresent)
+        R_ActivateThinkerInterpolations(currentthinker);
+      if (currentthinker->function)
+        currentthinker->function(currentthinker);
+    }
   newthinkerpresent = false;
 
   // Dedicated thinkers
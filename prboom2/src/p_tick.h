@@ -51,6 +51,9 @@ void P_RemoveThinkerDelayed(thinker_t *thinker);    // killough 4/25/98
 
 void P_UpdateThinker(thinker_t *thinker);   // killough 8/29/98
 
+void P_InitThinkerStats(void);
+void P_WriteThinkerStats(void);
+
 void P_SetTarget(mobj_t **mo, mobj_t *target);   // killough 11/98
 
 /* killough 8/29/98: threads of thinkers, for more efficient searches
@@ -736,6 +736,84 @@ static void R_Subsector(int num)
   }
 }
 
+#ifdef GL_DOOM
+//
+// Node occlusion cache
+//
+// R_RenderBSPNode always walks the front child of a node and only tests
+// the back one. On big open maps whole front subtrees are often hidden
+// behind walls that were drawn earlier, or lie outside the view cone, and
+// walking them costs more than the drawing. Testing every front child
+// would double the clipper queries, so only nodes whose front subtree was
+// hidden in the previous frame are tested every frame. The other nodes are
+// tested once every NODECACHE_SAMPLE frames to find new hidden subtrees.
+// Each skip is checked against the clipper again in the current frame, so
+// a stale entry costs one query and never hides a wall.
+//
+
+#define NODECACHE_SAMPLE  8               // power of two
+#define NODECACHE_MOVE    (128*FRACUNIT)  // a bigger jump drops the cache
+
+int gl_node_occlusion;
+
+static int *nodecache_frame;  // when the front child was last found hidden
+static int nodecache_framecount;
+static fixed_t nodecache_viewx, nodecache_viewy;
+static angle_t nodecache_viewangle;
+static dboolean nodecache_active;
+
+void R_SetupNodeCache(void)
+{
+  nodecache_active = false;
+
+  if (!gl_node_occlusion || V_GetMode() != VID_MODEGL || numnodes <= 0)
+    return;
+
+  // PU_LEVEL, so it is freed and cleared when the next level is loaded
+  if (!nodecache_frame)
+  {
+    nodecache_frame = Z_Calloc(numnodes, sizeof(nodecache_frame[0]),
+      PU_LEVEL, (void **)&nodecache_frame);
+  }
+
+  // after a teleport or a quick turn, what was hidden says nothing
+  // about the new view
+  if (D_abs(viewx - nodecache_viewx) > NODECACHE_MOVE ||
+      D_abs(viewy - nodecache_viewy) > NODECACHE_MOVE ||
+      viewangle - nodecache_viewangle + ANG45 > ANG90)
+  {
+    nodecache_framecount++;
+  }
+  nodecache_framecount++;
+
+  nodecache_viewx = viewx;
+  nodecache_viewy = viewy;
+  nodecache_viewangle = viewangle;
+  nodecache_active = true;
+}
+
+// Returns false if the front subtree of the node can be skipped
+static dboolean R_CheckNodeFront(int bspnum, const fixed_t *bspcoord)
+{
+  // freed with the level; R_SetupNodeCache has not run since
+  if (!nodecache_frame)
+    return true;
+
+  if (nodecache_frame[bspnum] != nodecache_framecount - 1 &&
+      ((bspnum + nodecache_framecount) & (NODECACHE_SAMPLE - 1)))
+  {
+    return true;
+  }
+
+  if (R_CheckBBox(bspcoord))
+    return true;
+
+  nodecache_frame[bspnum] = nodecache_framecount;
+  rendered_nodeskips++;
+  return false;
+}
+#endif
+
 //
 // RenderBSPNode
 // Renders all subsectors below a given node,
@@ -752,8 +830,16 @@ void R_RenderBSPNode(int bspnum)
 
       // Decide which side the view point is on.
       int side = R_PointOnSide(viewx, viewy, bsp);
+
+      rendered_nodes++;
+
       // Recursively divide front space.
-      R_RenderBSPNode(bsp->children[side]);
+#ifdef GL_DOOM
+      // only set up in GL frames, so it can be left over from the last one
+      if (V_GetMode() != VID_MODEGL || !nodecache_active ||
+          R_CheckNodeFront(bspnum, bsp->bbox[side]))
+#endif
+        R_RenderBSPNode(bsp->children[side]);
 
       // Possibly divide back space.
 
@@ -58,6 +58,7 @@ extern drawseg_t *ds_p;
 void R_ClearClipSegs(void);
 void R_ClearDrawSegs(void);
 void R_RenderBSPNode(int bspnum);
+void R_SetupNodeCache(void);
 
 /* killough 4/13/98: fake floors/ceilings for deep water / fake ceilings: */
 sector_t *R_FakeFlat(sector_t *, sector_t *, int *, int *, dboolean);
@@ -42,7 +42,10 @@
 #include "r_things.h"
 #include "p_tick.h"
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
+#include "r_precache.h"
 #include "p_tick.h"
+#include "md5.h"
+#include "SDL.h"
 
 //
 // Graphics.
@@ -414,6 +417,122 @@ int tran_filter_pct = 66;       // filter percent
 
 #define TSC 12        /* number of fixed point digits in filter percent */
 
+// Translucency maps already built this session, keyed by PLAYPAL and
+// filter percent, so that toggling tran_filter_pct or switching back to
+// a previously seen palette doesn't rebuild or even reread the map.
+
+typedef struct tranmap_cache_s {
+  struct tranmap_cache_s *next;
+  byte md5[16];
+  int pct;
+  byte *map;
+} tranmap_cache_t;
+
+static tranmap_cache_t *tranmap_cache;
+
+// Build parameters shared by the worker threads. All arithmetic fits in
+// 32 bits: the products are at most 255*255*(1<<TSC)*3.
+
+typedef struct {
+  int pal[3][256], tot[256], pal_w1[3][256];
+  int w2;
+  byte *map;
+  SDL_atomic_t nextrow;
+} tranmap_build_t;
+
+#define TRANMAP_ROWS_PER_JOB 8
+
+static void R_BuildTranMapRow(tranmap_build_t *tb, int i)
+{
+  int r1 = tb->pal[0][i] * tb->w2;
+  int g1 = tb->pal[1][i] * tb->w2;
+  int b1 = tb->pal[2][i] * tb->w2;
+  byte *tp = tb->map + i*256;
+  int j;
+
+  for (j=0;j<256;j++,tp++)
+    {
+      int err[256];
+      int r = tb->pal_w1[0][j] + r1;
+      int g = tb->pal_w1[1][j] + g1;
+      int b = tb->pal_w1[2][j] + b1;
+      int best = INT_MAX;
+      int color;
+
+      // Straight-line loops the compiler can vectorize: all the errors
+      // first, then their minimum.
+      for (color = 0; color < 256; color++)
+        err[color] = tb->tot[color] - tb->pal[0][color]*r
+          - tb->pal[1][color]*g - tb->pal[2][color]*b;
+      for (color = 0; color < 256; color++)
+        best = err[color] < best ? err[color] : best;
+
+      // Ties go to the highest colour, as in the original descending search
+      color = 255;
+      while (err[color] != best)
+        color--;
+      *tp = color;
+    }
+}
+
+static int R_TranMapWorker(void *data)
+{
+  tranmap_build_t *tb = data;
+  int i, row;
+
+  while ((row = SDL_AtomicAdd(&tb->nextrow, TRANMAP_ROWS_PER_JOB)) < 256)
+    for (i = row; i < row + TRANMAP_ROWS_PER_JOB; i++)
+      R_BuildTranMapRow(tb, i);
+  return 0;
+}
+
+static void R_BuildTranMap(byte *my_tranmap, const byte *playpal, int progress)
+{
+  tranmap_build_t *tb = malloc(sizeof(*tb));
+  SDL_Thread *threads[16];
+  int numthreads, i, w1;
+
+  w1 = ((unsigned int) tran_filter_pct<<TSC)/100;
+  tb->w2 = (1<<TSC)-w1;
+  tb->map = my_tranmap;
+  SDL_AtomicSet(&tb->nextrow, 0);
+
+  if (progress)
+    lprintf(LO_INFO, "Tranmap build [        ]\x08\x08\x08\x08\x08\x08\x08\x08\x08");
+
+  // First, convert playpal into int type, and transpose array,
+  // for fast inner-loop calculations. Precompute tot array.
+
+  for (i = 0; i < 256; i++)
+    {
+      const byte *p = playpal + i*3;
+      tb->pal_w1[0][i] = (tb->pal[0][i] = p[0]) * w1;
+      tb->pal_w1[1][i] = (tb->pal[1][i] = p[1]) * w1;
+      tb->pal_w1[2][i] = (tb->pal[2][i] = p[2]) * w1;
+      tb->tot[i] = (p[0]*p[0] + p[1]*p[1] + p[2]*p[2]) << (TSC-1);
+    }
+
+  // Next, compute all entries, spreading the rows over the CPUs.
+  // The calling thread takes part too, so a failed thread creation
+  // only costs speed.
+
+  numthreads = BETWEEN(1, 16, SDL_GetCPUCount()) - 1;
+  for (i = 0; i < numthreads; i++)
+    if (!(threads[i] = SDL_CreateThread(R_TranMapWorker, "tranmap_thread", tb)))
+      break;
+  numthreads = i;
+
+  R_TranMapWorker(tb);
+
+  for (i = 0; i < numthreads; i++)
+    SDL_WaitThread(threads[i], NULL);
+
+  if (progress)
+    lprintf(LO_INFO, "........");
+
+  free(tb);
+}
+
 void R_InitTranMap(int progress)
 {
   int lump = W_CheckNumForName("TRANMAP");
@@ -426,6 +545,9 @@ void R_InitTranMap(int progress)
     {   // Compose a default transparent filter map based on PLAYPAL.
       const byte *playpal = W_CacheLumpName("PLAYPAL");
       byte       *my_tranmap;
+      tranmap_cache_t *tc;
+      struct MD5Context md5;
+      byte        digest[16];
 
       char *fname;
       int fnlen;
@@ -435,9 +557,30 @@ void R_InitTranMap(int progress)
       } cache;
       FILE *cachefp;
 
-      fnlen = doom_snprintf(NULL, 0, "%s/tranmap.dat", I_DoomExeDir());
+      MD5Init(&md5);
+      MD5Update(&md5, playpal, 256*3);
+      MD5Final(digest, &md5);
+
+      for (tc = tranmap_cache; tc; tc = tc->next)
+        if (tc->pct == tran_filter_pct && !memcmp(tc->md5, digest, 16))
+          break;
+
+      if (tc)
+        {
+          main_tranmap = tc->map;
+          W_UnlockLumpName("PLAYPAL");
+          return;
+        }
+
+      // One cache file per palette and filter percent, so that switching
+      // between PWADs or percentages reuses earlier builds.
+
+      fnlen = doom_snprintf(NULL, 0, "%s/tranmap_%02x%02x%02x%02x%02x%02x%02x%02x_%d.dat",
+                            I_DoomExeDir(), 0, 0, 0, 0, 0, 0, 0, 0, tran_filter_pct);
       fname = malloc(fnlen+1);
-      doom_snprintf(fname, fnlen+1, "%s/tranmap.dat", I_DoomExeDir());
+      doom_snprintf(fname, fnlen+1, "%s/tranmap_%02x%02x%02x%02x%02x%02x%02x%02x_%d.dat",
+                    I_DoomExeDir(), digest[0], digest[1], digest[2], digest[3],
+                    digest[4], digest[5], digest[6], digest[7], tran_filter_pct);
       cachefp = fopen(fname, "rb");
 
       main_tranmap = my_tranmap = Z_Malloc(256*256, PU_STATIC, 0);  // killough 4/11/98
@@ -450,63 +593,11 @@ void R_InitTranMap(int progress)
           memcmp(cache.playpal, playpal, sizeof cache.playpal) ||
           fread(my_tranmap, 256, 256, cachefp) != 256 ) // killough 4/11/98
         {
-          long pal[3][256], tot[256], pal_w1[3][256];
-          long w1 = ((unsigned long) tran_filter_pct<<TSC)/100;
-          long w2 = (1l<<TSC)-w1;
-
-          if (progress)
-            lprintf(LO_INFO, "Tranmap build [        ]\x08\x08\x08\x08\x08\x08\x08\x08\x08");
+          if (cachefp)
+            fclose(cachefp);
 
-          // First, convert playpal into long int type, and transpose array,
-          // for fast inner-loop calculations. Precompute tot array.
+          R_BuildTranMap(my_tranmap, playpal, progress);
 
-          {
-            register int i = 255;
-            register const unsigned char *p = playpal+255*3;
-            do
-              {
-                register long t,d;
-                pal_w1[0][i] = (pal[0][i] = t = p[0]) * w1;
-                d = t*t;
-                pal_w1[1][i] = (pal[1][i] = t = p[1]) * w1;
-                d += t*t;
-                pal_w1[2][i] = (pal[2][i] = t = p[2]) * w1;
-                d += t*t;
-                p -= 3;
-                tot[i] = d << (TSC-1);
-              }
-            while (--i>=0);
-          }
-
-          // Next, compute all entries using minimum arithmetic.
-
-          {
-            int i,j;
-            byte *tp = my_tranmap;
-            for (i=0;i<256;i++)
-              {
-                long r1 = pal[0][i] * w2;
-                long g1 = pal[1][i] * w2;
-                long b1 = pal[2][i] * w2;
-                if (!(i & 31) && progress)
-                  //jff 8/3/98 use logical output routine
-                  lprintf(LO_INFO,".");
-                for (j=0;j<256;j++,tp++)
-                  {
-                    register int color = 255;
-                    register long err;
-                    long r = pal_w1[0][j] + r1;
-                    long g = pal_w1[1][j] + g1;
-                    long b = pal_w1[2][j] + b1;
-                    long best = LONG_MAX;
-                    do
-                      if ((err = tot[color] - pal[0][color]*r
-                          - pal[1][color]*g - pal[2][color]*b) < best)
-                        best = err, *tp = color;
-                    while (--color >= 0);
-                  }
-              }
-          }
           if ((cachefp = fopen(fname,"wb")) != NULL) // write out the cached translucency map
             {
               cache.pct = tran_filter_pct;
@@ -523,6 +614,13 @@ void R_InitTranMap(int progress)
 
       free(fname);
 
+      tc = malloc(sizeof(*tc));
+      memcpy(tc->md5, digest, 16);
+      tc->pct = tran_filter_pct;
+      tc->map = my_tranmap;
+      tc->next = tranmap_cache;
+      tranmap_cache = tc;
+
       W_UnlockLumpName("PLAYPAL");
     }
 }
@@ -651,6 +749,12 @@ void R_PrecacheLevel(void)
   if (timingdemo)
     return;
 
+  if (r_precache_background)
+  {
+    R_StartBackgroundPrecache();
+    return;
+  }
+
   {
     int size = numflats > numsprites  ? numflats : numsprites;
     hitlist = malloc(numtextures > size ? numtextures : size);
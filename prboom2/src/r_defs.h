@@ -139,6 +139,7 @@ typedef struct
   // list of mobjs that are at least partially in the sector
   // thinglist is a subset of touching_thinglist
   struct msecnode_s *touching_thinglist;               // phares 3/14/98
+  int touching_players; // nodes in touching_thinglist with m_player set
 
   int linecount;
   struct line_s **lines;
@@ -273,6 +274,7 @@ typedef struct msecnode_s
   struct msecnode_s *m_sprev;  // prev msecnode_t for this sector
   struct msecnode_s *m_snext;  // next msecnode_t for this sector
   dboolean visited; // killough 4/4/98, 4/7/98: used in search algorithms
+  dboolean m_player; // counted in m_sector->touching_players
 } msecnode_t;
 
 //
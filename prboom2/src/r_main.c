@@ -59,6 +59,7 @@
 #include <math.h>
 #include "e6y.h"//e6y
 #include "xs_Float.h"
+#include "m_profile.h"
 
 // e6y
 // Now they are variables. Depends from render_doom_lightmaps variable.
@@ -1042,6 +1043,9 @@ static void R_SetupFrame (player_t *player)
 // R_ShowStats
 //
 int rendered_visplanes, rendered_segs, rendered_vissprites;
+int rendered_drawcalls, rendered_sortusec;
+int rendered_texbinds, rendered_atlaspages, rendered_atlasfill;
+int rendered_nodes, rendered_nodeskips;
 dboolean rendering_stats;
 int renderer_fps = 0;
 
@@ -1056,9 +1060,14 @@ void R_ShowStats(void)
     if (rendering_stats)
     {
       doom_printf((V_GetMode() == VID_MODEGL)
-                  ?"Frame rate %d fps\nWalls %d, Flats %d, Sprites %d"
+                  ?"Frame rate %d fps\nWalls %d, Flats %d, Sprites %d, Draws %d, Sort %dus\n"
+                   "Binds %d, Atlas pages %d (%d%% full)\n"
+                   "Nodes %d, %d hidden subtrees skipped"
                   :"Frame rate %d fps\nSegs %d, Visplanes %d, Sprites %d",
-      renderer_fps, rendered_segs, rendered_visplanes, rendered_vissprites);
+      renderer_fps, rendered_segs, rendered_visplanes, rendered_vissprites,
+      rendered_drawcalls, rendered_sortusec,
+      rendered_texbinds, rendered_atlaspages, rendered_atlasfill,
+      rendered_nodes, rendered_nodeskips);
     }
     FPS_SavedTick = tick;
     FPS_FrameCount = 0;
@@ -1070,6 +1079,10 @@ void R_ClearStats(void)
   rendered_visplanes = 0;
   rendered_segs = 0;
   rendered_vissprites = 0;
+  rendered_drawcalls = 0;
+  rendered_texbinds = 0;
+  rendered_nodes = 0;
+  rendered_nodeskips = 0;
 }
 
 //
@@ -1079,6 +1092,8 @@ void R_RenderPlayerView (player_t* player)
 {
   dboolean automap = (automapmode & am_active) && !(automapmode & am_overlay);
 
+  M_ProfileBegin(PROF_RENDER);
+
   r_frame_count++;
 
   R_SetupFrame (player);
@@ -1102,6 +1117,8 @@ void R_RenderPlayerView (player_t* player)
     }
 #endif
   } else {
+    V_MarkRows(0, viewwindowy, viewwindowy + viewheight - 1);
+
     if (flashing_hom)
     { // killough 2/10/98: add flashing red HOM indicators
       unsigned char color=(gametic % 20) < 9 ? 0xb0 : 0;
@@ -1122,19 +1139,26 @@ void R_RenderPlayerView (player_t* player)
       gld_clipper_Clear();
       gld_clipper_SafeAddClipRangeRealAngles(viewangle + a1, viewangle - a1);
       gld_FrustrumSetup();
+      R_SetupNodeCache();
     }
   }
 #endif
 
   // The head node is the last node output.
+  M_ProfileBegin(PROF_BSP);
   R_RenderBSPNode (numnodes-1);
+  M_ProfileEnd(PROF_BSP);
 
 #ifdef HAVE_NET
   NetUpdate ();
 #endif
 
   if (V_GetMode() != VID_MODEGL)
+  {
+    M_ProfileBegin(PROF_PLANES);
     R_DrawPlanes();
+    M_ProfileEnd(PROF_PLANES);
+  }
 
   R_ResetColumnBuffer();
 
@@ -1144,8 +1168,10 @@ void R_RenderPlayerView (player_t* player)
 #endif
 
   if (V_GetMode() != VID_MODEGL) {
+    M_ProfileBegin(PROF_MASKED);
     R_DrawMasked ();
     R_ResetColumnBuffer();
+    M_ProfileEnd(PROF_MASKED);
   }
 
   // Check for new console commands.
@@ -1161,4 +1187,6 @@ void R_RenderPlayerView (player_t* player)
     gld_EndDrawScene();
 #endif
   }
+
+  M_ProfileEnd(PROF_RENDER);
 }
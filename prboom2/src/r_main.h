@@ -84,6 +84,9 @@ extern fixed_t viewfocratio;
 //
 
 extern int rendered_visplanes, rendered_segs, rendered_vissprites;
+extern int rendered_drawcalls, rendered_sortusec;
+extern int rendered_texbinds, rendered_atlaspages, rendered_atlasfill;
+extern int rendered_nodes, rendered_nodeskips;
 extern dboolean rendering_stats;
 
 //
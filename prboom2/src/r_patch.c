@@ -71,6 +71,8 @@
 #include "lprintf.h"
 #include "r_patch.h"
 #include "v_video.h"
+#include "md5.h"
+#include "r_patchstore.h"
 #include <assert.h>
 
 // posts are runs of non masked source pixels
@@ -109,6 +111,10 @@ static rpatch_t *texture_composites = 0;
 // indices of two duplicate PLAYPAL entries, second is -1 if none found
 static int playpal_transparent, playpal_duplicate;
 
+// MD5 of every lump converted so far, for R_AddStoredPatch keys
+static patchkey_t *lump_md5;
+static byte *lump_md5_valid;
+
 //---------------------------------------------------------------------------
 void R_InitPatches(void) {
   if (!patches)
@@ -124,6 +130,12 @@ void R_InitPatches(void) {
     memset(texture_composites, 0, sizeof(rpatch_t)*numtextures);
   }
 
+  if (!lump_md5)
+  {
+    lump_md5 = malloc(numlumps * sizeof(*lump_md5));
+    lump_md5_valid = calloc(numlumps, sizeof(*lump_md5_valid));
+  }
+
   if (!playpal_duplicate)
   {
     int lump = W_GetNumForName("PLAYPAL");
@@ -160,6 +172,8 @@ void R_InitPatches(void) {
 
     W_UnlockLumpNum(lump);
   }
+
+  R_InitPatchStore();
 }
 
 //---------------------------------------------------------------------------
@@ -182,6 +196,13 @@ void R_FlushAllPatches(void) {
     free(texture_composites);
     texture_composites = NULL;
   }
+  if (lump_md5)
+  {
+    free(lump_md5);
+    free(lump_md5_valid);
+    lump_md5 = NULL;
+    lump_md5_valid = NULL;
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -401,6 +422,67 @@ static void StorePixel(rpatch_t *patch, int x, int y, byte color)
   patch->pixels[x * patch->height + y] = color;
 }
 
+//---------------------------------------------------------------------------
+// Store keys cover the source lumps and everything else the conversion
+// depends on, so a stored patch is only reused if it would come out the same
+//---------------------------------------------------------------------------
+static const byte *getLumpMD5(int lump)
+{
+  if (!lump_md5_valid[lump])
+  {
+    struct MD5Context md5;
+
+    MD5Init(&md5);
+    MD5Update(&md5, W_CacheLumpNum(lump), W_LumpLength(lump));
+    MD5Final(lump_md5[lump], &md5);
+    W_UnlockLumpNum(lump);
+    lump_md5_valid[lump] = 1;
+  }
+  return lump_md5[lump];
+}
+
+static void getPatchKey(int id, int trimmed, patchkey_t key)
+{
+  struct MD5Context md5;
+  int params[3];
+
+  params[0] = playpal_transparent;
+  params[1] = playpal_duplicate;
+  params[2] = trimmed;
+
+  MD5Init(&md5);
+  MD5Update(&md5, getLumpMD5(id), sizeof(patchkey_t));
+  MD5Update(&md5, (const md5byte *)params, sizeof(params));
+  MD5Final(key, &md5);
+}
+
+static void getTextureCompositeKey(const texture_t *texture, patchkey_t key)
+{
+  struct MD5Context md5;
+  int params[5];
+  int i;
+
+  params[0] = playpal_transparent;
+  params[1] = playpal_duplicate;
+  params[2] = texture->width;
+  params[3] = texture->height;
+  params[4] = texture->patchcount;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const md5byte *)params, sizeof(params));
+  for (i = 0; i < texture->patchcount; i++)
+  {
+    const texpatch_t *texpatch = &texture->patches[i];
+    int origin[2];
+
+    origin[0] = texpatch->originx;
+    origin[1] = texpatch->originy;
+    MD5Update(&md5, getLumpMD5(texpatch->patch), sizeof(patchkey_t));
+    MD5Update(&md5, (const md5byte *)origin, sizeof(origin));
+  }
+  MD5Final(key, &md5);
+}
+
 //---------------------------------------------------------------------------
 static void createPatch(int id) {
   rpatch_t *patch;
@@ -417,6 +499,8 @@ static void createPatch(int id) {
   const unsigned char *oldColumnPixelData;
   int numPostsUsedSoFar;
   int edgeSlope;
+  int trimmed = 0;
+  patchkey_t key;
 
 #ifdef RANGECHECK
   if (id >= numlumps)
@@ -429,9 +513,25 @@ static void createPatch(int id) {
       (patchNum < numlumps ? lumpinfo[patchNum].name : NULL));
   }
 
+  patch = &patches[id];
+
+#ifdef GL_DOOM
+  // Width of M_THERMM patch is 9, but Doom interprets it as 8-columns lump
+  // during drawing. It is not a problem for software mode and GL_NEAREST,
+  // but looks wrong with filtering. So I need to patch it during loading.
+  if (V_GetMode() == VID_MODEGL)
+    trimmed = !strncasecmp(lumpinfo[id].name, "M_THERMM", 8);
+#endif
+
+  if (r_patch_store)
+  {
+    getPatchKey(id, trimmed, key);
+    if (R_LoadStoredPatch(key, patch, PU_CACHE))
+      return;
+  }
+
   oldPatch = (const patch_t*)W_CacheLumpNum(patchNum);
 
-  patch = &patches[id];
   // proff - 2003-02-16 What about endianess?
   patch->width = LittleShort(oldPatch->width);
   patch->widthmask = 0;
@@ -442,18 +542,10 @@ static void createPatch(int id) {
   if (getPatchIsNotTileable(oldPatch))
     patch->flags |= PATCH_ISNOTTILEABLE;
 
-#ifdef GL_DOOM
-  // Width of M_THERMM patch is 9, but Doom interprets it as 8-columns lump
-  // during drawing. It is not a problem for software mode and GL_NEAREST,
-  // but looks wrong with filtering. So I need to patch it during loading.
-  if (V_GetMode() == VID_MODEGL)
+  if (trimmed && patch->width > 8)
   {
-    if (!strncasecmp(lumpinfo[id].name, "M_THERMM", 8) && patch->width > 8)
-    {
-      patch->width--;
-    }
+    patch->width--;
   }
-#endif
 
   // work out how much memory we need to allocate for this patch's data
   pixelDataSize = (patch->width * patch->height + 4) & ~3;
@@ -569,6 +661,9 @@ static void createPatch(int id) {
 
   W_UnlockLumpNum(patchNum);
   free(numPostsInColumn);
+
+  if (r_patch_store)
+    R_AddStoredPatch(key, patch, PU_CACHE);
 }
 
 typedef struct {
@@ -627,6 +722,7 @@ static void createTextureCompositePatch(int id) {
   int numPostsUsedSoFar;
   int edgeSlope;
   count_t *countsInColumn;
+  patchkey_t key;
 
 #ifdef RANGECHECK
   if (id >= numtextures)
@@ -637,6 +733,13 @@ static void createTextureCompositePatch(int id) {
 
   texture = textures[id];
 
+  if (r_patch_store)
+  {
+    getTextureCompositeKey(texture, key);
+    if (R_LoadStoredPatch(key, composite_patch, PU_STATIC))
+      return;
+  }
+
   composite_patch->width = texture->width;
   composite_patch->height = texture->height;
   composite_patch->widthmask = texture->widthmask;
@@ -855,6 +958,9 @@ static void createTextureCompositePatch(int id) {
   FillEmptySpace(composite_patch);
 
   free(countsInColumn);
+
+  if (r_patch_store)
+    R_AddStoredPatch(key, composite_patch, PU_STATIC);
 }
 
 //---------------------------------------------------------------------------
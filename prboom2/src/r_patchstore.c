@@ -0,0 +1,577 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Persistent store of converted patches and composite textures
+ *
+ *  createPatch and createTextureCompositePatch convert every patch and
+ *  texture on first use. The results are written to rpatch.dat next to
+ *  the executable, keyed by an MD5 of the source lumps, and the file is
+ *  memory mapped on the next run. A stored patch only needs its column
+ *  table rebuilt; pixels and posts are used straight from the mapping,
+ *  so purging it under memory pressure costs next to nothing. Without
+ *  mmap an entry is read into the patch's own block on use instead.
+ *
+ *  The file is not trusted: an entry's column and post offsets are
+ *  checked the first time it is used, and one that fails is converted
+ *  again and replaced.
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef _WIN32
+#include <io.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+#include "doomstat.h"
+#include "z_zone.h"
+#include "m_misc.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "r_patchstore.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define PATCHSTORE_MAGIC    "PRBPATCH"
+#define PATCHSTORE_VERSION  1
+#define PATCHSTORE_MAXSIZE  (64*1024*1024)
+#define PATCHSTORE_HASHSIZE 4096
+
+int r_patch_store;
+
+typedef struct
+{
+  char magic[8];
+  int version;
+  int postsize;         // sizeof(rpost_t) of the writer
+  int numentries;
+} patchstore_header_t;
+
+// Entry data is laid out as the pixels (padded to 4 bytes), then a
+// (first post, number of posts) pair per column, then the posts.
+typedef struct
+{
+  patchkey_t key;
+  int offset;           // of the entry data from the start of the file
+  int size;
+  int width, height;
+  int leftoffset, topoffset;
+  unsigned int widthmask;
+  unsigned int flags;
+  int numposts;
+} patchstore_entry_t;
+
+typedef struct
+{
+  patchstore_entry_t info;
+  const byte *data;     // NULL if it has to be read from store_fp
+  int next;             // hash chain
+  dboolean isnew;       // data is malloc'ed, not in the store file
+  dboolean used;
+  dboolean checked;     // data passed R_CheckStoredPatch
+  dboolean bad;         // failed it, R_AddStoredPatch may replace it
+} storedpatch_t;
+
+static storedpatch_t *storedpatches;
+static int numstoredpatches, maxstoredpatches;
+static int storehash[PATCHSTORE_HASHSIZE];
+
+static byte *store_data;
+static FILE *store_fp;
+static int store_size;
+static int store_hits, store_misses, store_added, store_bad;
+
+static char *R_PatchStoreFileName(const char *ext)
+{
+  int len = doom_snprintf(NULL, 0, "%s/rpatch.dat%s", I_DoomExeDir(), ext);
+  char *fname = malloc(len+1);
+  doom_snprintf(fname, len+1, "%s/rpatch.dat%s", I_DoomExeDir(), ext);
+  return fname;
+}
+
+static int R_PatchStoreHash(const patchkey_t key)
+{
+  return (key[0] | (key[1] << 8)) & (PATCHSTORE_HASHSIZE - 1);
+}
+
+static int R_PatchDataSize(int width, int height, int numposts)
+{
+  return ((width * height + 3) & ~3) + width * 2 * sizeof(int) +
+    numposts * sizeof(rpost_t);
+}
+
+static storedpatch_t *R_FindStoredPatch(const patchkey_t key)
+{
+  int i;
+
+  for (i = storehash[R_PatchStoreHash(key)]; i >= 0; i = storedpatches[i].next)
+    if (!memcmp(storedpatches[i].info.key, key, sizeof(patchkey_t)))
+      return &storedpatches[i];
+
+  return NULL;
+}
+
+static storedpatch_t *R_NewStoredPatch(const patchstore_entry_t *info)
+{
+  storedpatch_t *sp;
+  int hash = R_PatchStoreHash(info->key);
+
+  if (numstoredpatches >= maxstoredpatches)
+  {
+    maxstoredpatches = maxstoredpatches ? maxstoredpatches * 2 : 1024;
+    storedpatches = realloc(storedpatches, maxstoredpatches * sizeof(*storedpatches));
+  }
+
+  sp = &storedpatches[numstoredpatches];
+  memset(sp, 0, sizeof(*sp));
+  sp->info = *info;
+  sp->next = storehash[hash];
+  storehash[hash] = numstoredpatches++;
+
+  return sp;
+}
+
+static dboolean R_OpenPatchStore(const char *fname)
+{
+#ifdef HAVE_MMAP
+  int fd = open(fname, O_RDONLY | O_BINARY);
+  void *map;
+
+  if (fd == -1)
+    return false;
+
+  store_size = I_Filelength(fd);
+  map = store_size > 0 ? mmap(NULL, store_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+
+  if (map != MAP_FAILED)
+  {
+    store_data = map;
+    return true;
+  }
+#endif
+
+  // no mapping: keep the file open and read entries as they are used
+  store_fp = fopen(fname, "rb");
+  if (!store_fp)
+    return false;
+
+  fseek(store_fp, 0, SEEK_END);
+  store_size = ftell(store_fp);
+  return true;
+}
+
+static void R_ClosePatchStore(void)
+{
+#ifdef HAVE_MMAP
+  if (store_data)
+    munmap(store_data, store_size);
+#endif
+  store_data = NULL;
+
+  if (store_fp)
+    fclose(store_fp);
+  store_fp = NULL;
+
+  store_size = 0;
+}
+
+// Copies len bytes at offset out of the store file
+static dboolean R_ReadPatchStore(int offset, void *buf, int len)
+{
+  if (offset < 0 || len < 0 || offset > store_size - len)
+    return false;
+  if (!len)
+    return true;
+
+  if (store_data)
+  {
+    memcpy(buf, store_data + offset, len);
+    return true;
+  }
+
+  return store_fp && !fseek(store_fp, offset, SEEK_SET) &&
+    fread(buf, len, 1, store_fp) == 1;
+}
+
+//
+// R_CheckStoredPatch
+//
+// The column table must stay within the entry's posts and every post
+// within the patch height, or drawing would read past the entry.
+//
+
+static dboolean R_CheckStoredPatch(const patchstore_entry_t *info, const byte *data)
+{
+  const int *columns = (const int *)(data + ((info->width * info->height + 3) & ~3));
+  const rpost_t *posts = (const rpost_t *)(columns + 2 * info->width);
+  int i;
+
+  for (i = 0; i < info->width; i++)
+  {
+    int first = columns[2*i], count = columns[2*i+1];
+
+    if (first < 0 || count < 0 || first > info->numposts - count)
+      return false;
+  }
+
+  // merging composite posts can leave empty ones anywhere
+  for (i = 0; i < info->numposts; i++)
+  {
+    if (posts[i].length < 0 ||
+        (posts[i].length > 0 &&
+         (posts[i].topdelta < 0 || posts[i].topdelta > info->height - posts[i].length)))
+      return false;
+  }
+
+  return true;
+}
+
+// Points patch at an entry's pixels and posts; patch->data must hold
+// the column table
+static void R_SetupStoredPatch(const patchstore_entry_t *info, const byte *data, rpatch_t *patch)
+{
+  int pixelDataSize = (info->width * info->height + 3) & ~3;
+  const int *columns = (const int *)(data + pixelDataSize);
+  int x;
+
+  patch->width = info->width;
+  patch->height = info->height;
+  patch->widthmask = info->widthmask;
+  patch->leftoffset = info->leftoffset;
+  patch->topoffset = info->topoffset;
+  patch->flags = info->flags;
+
+  patch->pixels = (unsigned char *)data;
+  patch->columns = (rcolumn_t *)patch->data;
+  patch->posts = (rpost_t *)(columns + 2 * info->width);
+
+  for (x = 0; x < patch->width; x++)
+  {
+    patch->columns[x].pixels = patch->pixels + x * patch->height;
+    patch->columns[x].posts = patch->posts + columns[2*x];
+    patch->columns[x].numPosts = columns[2*x+1];
+  }
+}
+
+void R_InitPatchStore(void)
+{
+  static dboolean initialized;
+  patchstore_header_t header;
+  patchstore_entry_t *entries;
+  char *fname;
+  int i;
+
+  if (initialized || !r_patch_store)
+    return;
+  initialized = true;
+
+  for (i = 0; i < PATCHSTORE_HASHSIZE; i++)
+    storehash[i] = -1;
+
+  atexit(R_SavePatchStore);
+
+  fname = R_PatchStoreFileName("");
+  if (!R_OpenPatchStore(fname))
+  {
+    free(fname);
+    return;
+  }
+  free(fname);
+
+  if (!R_ReadPatchStore(0, &header, sizeof(header)) ||
+      memcmp(header.magic, PATCHSTORE_MAGIC, sizeof(header.magic)) ||
+      header.version != PATCHSTORE_VERSION ||
+      header.postsize != sizeof(rpost_t) ||
+      header.numentries < 0 ||
+      header.numentries > (store_size - (int)sizeof(header)) / (int)sizeof(*entries))
+  {
+    lprintf(LO_WARN, "R_InitPatchStore: ignoring outdated or damaged patch store\n");
+    R_ClosePatchStore();
+    return;
+  }
+
+  entries = malloc(header.numentries * sizeof(*entries));
+  R_ReadPatchStore(sizeof(header), entries, header.numentries * sizeof(*entries));
+
+  for (i = 0; i < header.numentries; i++)
+  {
+    const patchstore_entry_t *e = &entries[i];
+
+    // the size check below can't overflow once these hold
+    if (e->width <= 0 || e->height <= 0 || e->numposts < 0 ||
+        e->width > 0x7fff || e->height > 0x7fff ||
+        e->numposts > store_size / (int)sizeof(rpost_t) ||
+        e->offset < (int)sizeof(header) || (e->offset & 3) ||
+        e->size != R_PatchDataSize(e->width, e->height, e->numposts) ||
+        e->offset > store_size - e->size ||
+        R_FindStoredPatch(e->key))
+      continue;
+
+    R_NewStoredPatch(e)->data = store_data ? store_data + e->offset : NULL;
+  }
+
+  free(entries);
+
+  lprintf(LO_INFO, "R_InitPatchStore: %d stored patches\n", numstoredpatches);
+}
+
+dboolean R_LoadStoredPatch(const patchkey_t key, rpatch_t *patch, int tag)
+{
+  storedpatch_t *sp = R_FindStoredPatch(key);
+  int columnsSize;
+  byte *data;
+
+  if (!sp || sp->bad)
+  {
+    store_misses++;
+    return false;
+  }
+
+  columnsSize = sp->info.width * sizeof(rcolumn_t);
+
+  if (sp->data)
+  {
+    if (!sp->checked && !R_CheckStoredPatch(&sp->info, sp->data))
+    {
+      sp->bad = true;
+      store_bad++;
+      store_misses++;
+      return false;
+    }
+    sp->checked = true;
+
+    // only the column table is owned by the patch, the rest stays in the store
+    patch->data = Z_Malloc(columnsSize, tag, (void **)&patch->data);
+    R_SetupStoredPatch(&sp->info, sp->data, patch);
+  }
+  else
+  {
+    // the entry goes in the patch's block after the column table, so
+    // purging the patch frees it
+    patch->data = Z_Malloc(columnsSize + sp->info.size, tag, (void **)&patch->data);
+    data = patch->data + columnsSize;
+
+    if (!R_ReadPatchStore(sp->info.offset, data, sp->info.size) ||
+        !R_CheckStoredPatch(&sp->info, data))
+    {
+      Z_Free(patch->data);
+      sp->bad = true;
+      store_bad++;
+      store_misses++;
+      return false;
+    }
+
+    R_SetupStoredPatch(&sp->info, data, patch);
+  }
+
+  sp->used = true;
+  store_hits++;
+  return true;
+}
+
+void R_AddStoredPatch(const patchkey_t key, rpatch_t *patch, int tag)
+{
+  patchstore_entry_t info;
+  storedpatch_t *sp = R_FindStoredPatch(key);
+  byte *data;
+  int *columns;
+  int pixelDataSize;
+  int numposts = 0;
+  int x;
+
+  // an entry that failed its check is written over
+  if (!r_patch_store || (sp && !sp->bad))
+    return;
+
+  // composites leave unused posts behind merged ones, so store up to the
+  // last post referenced by any column
+  for (x = 0; x < patch->width; x++)
+  {
+    int last = (int)(patch->columns[x].posts - patch->posts) + patch->columns[x].numPosts;
+    if (last > numposts)
+      numposts = last;
+  }
+
+  memset(&info, 0, sizeof(info));
+  memcpy(info.key, key, sizeof(patchkey_t));
+  info.width = patch->width;
+  info.height = patch->height;
+  info.leftoffset = patch->leftoffset;
+  info.topoffset = patch->topoffset;
+  info.widthmask = patch->widthmask;
+  info.flags = patch->flags;
+  info.numposts = numposts;
+  info.size = R_PatchDataSize(patch->width, patch->height, numposts);
+
+  data = calloc(1, info.size);
+  pixelDataSize = (patch->width * patch->height + 3) & ~3;
+  memcpy(data, patch->pixels, patch->width * patch->height);
+
+  columns = (int *)(data + pixelDataSize);
+  for (x = 0; x < patch->width; x++)
+  {
+    columns[2*x] = (int)(patch->columns[x].posts - patch->posts);
+    columns[2*x+1] = patch->columns[x].numPosts;
+  }
+  memcpy(columns + 2 * patch->width, patch->posts, numposts * sizeof(rpost_t));
+
+  if (sp)
+    sp->info = info;
+  else
+    sp = R_NewStoredPatch(&info);
+  sp->data = data;
+  sp->isnew = true;
+  sp->used = true;
+  sp->checked = true;
+  sp->bad = false;
+  store_added++;
+
+  // keep one copy: the patch now uses the stored one, like a hit would
+  Z_Free(patch->data);
+  patch->data = Z_Malloc(patch->width * sizeof(rcolumn_t), tag, (void **)&patch->data);
+  R_SetupStoredPatch(&sp->info, sp->data, patch);
+}
+
+//
+// R_SavePatchStore
+//
+// Rewrites the store if anything was added. New and used entries always
+// make it, unused ones from earlier runs only while under PATCHSTORE_MAXSIZE.
+// Entries that failed their check are dropped.
+//
+
+void R_SavePatchStore(void)
+{
+  patchstore_header_t header;
+  patchstore_entry_t *entries;
+  char *fname, *tmpname;
+  byte *readbuf = NULL;
+  FILE *f;
+  int pass, i, count = 0;
+  int offset;
+
+  if (!store_added)
+    return;
+
+  lprintf(LO_INFO, "R_SavePatchStore: %d hits, %d misses, %d added, %d damaged\n",
+          store_hits, store_misses, store_added, store_bad);
+
+  entries = malloc(numstoredpatches * sizeof(*entries));
+  offset = 0;
+  for (pass = 0; pass < 2; pass++)
+  {
+    for (i = 0; i < numstoredpatches; i++)
+    {
+      storedpatch_t *sp = &storedpatches[i];
+
+      if (sp->bad || (pass == 0) != (sp->isnew || sp->used))
+        continue;
+      if (pass == 1 && offset + sp->info.size > PATCHSTORE_MAXSIZE)
+        continue;
+
+      entries[count] = sp->info;
+      entries[count].offset = offset;
+      offset += sp->info.size;
+      count++;
+    }
+  }
+
+  // entry data follows the header and the entry table
+  offset = sizeof(header) + count * sizeof(*entries);
+  for (i = 0; i < count; i++)
+    entries[i].offset += offset;
+
+  fname = R_PatchStoreFileName("");
+  tmpname = R_PatchStoreFileName(".tmp");
+
+  if ((f = fopen(tmpname, "wb")) != NULL)
+  {
+    dboolean ok;
+
+    memcpy(header.magic, PATCHSTORE_MAGIC, sizeof(header.magic));
+    header.version = PATCHSTORE_VERSION;
+    header.postsize = sizeof(rpost_t);
+    header.numentries = count;
+
+    ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(entries, sizeof(*entries), count, f) == (size_t)count;
+    for (i = 0; ok && i < count; i++)
+    {
+      storedpatch_t *sp = R_FindStoredPatch(entries[i].key);
+      const byte *data = sp->data;
+
+      if (!data)
+      {
+        // unused entries of an unmapped store are still in the old file
+        readbuf = realloc(readbuf, sp->info.size);
+        ok = R_ReadPatchStore(sp->info.offset, readbuf, sp->info.size);
+        data = readbuf;
+      }
+      ok = ok && fwrite(data, sp->info.size, 1, f) == 1;
+    }
+    ok = (fclose(f) == 0) && ok;
+
+    if (ok)
+    {
+      // an open file can't be replaced everywhere; the old mapping may
+      // stay, this only runs on exit
+      if (store_fp)
+        R_ClosePatchStore();
+      remove(fname);
+      if (rename(tmpname, fname))
+        ok = false;
+    }
+    if (!ok)
+    {
+      lprintf(LO_WARN, "R_SavePatchStore: failed to write %s\n", fname);
+      remove(tmpname);
+    }
+  }
+
+  free(readbuf);
+  free(entries);
+  free(fname);
+  free(tmpname);
+  store_added = 0;
+}
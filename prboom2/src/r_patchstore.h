@@ -0,0 +1,54 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Persistent store of converted patches and composite textures
+ *
+ *---------------------------------------------------------------------
+ */
+
+#ifndef __R_PATCHSTORE__
+#define __R_PATCHSTORE__
+
+#include "doomtype.h"
+#include "r_patch.h"
+
+typedef unsigned char patchkey_t[16];
+
+extern int r_patch_store;
+
+void R_InitPatchStore(void);
+void R_SavePatchStore(void);
+
+// Sets up patch from the store; patch->data is Z_Malloc'ed with tag
+dboolean R_LoadStoredPatch(const patchkey_t key, rpatch_t *patch, int tag);
+// Stores a converted patch and, if it was added, sets it up from the
+// store as above, freeing the old patch->data
+void R_AddStoredPatch(const patchkey_t key, rpatch_t *patch, int tag);
+
+#endif
@@ -0,0 +1,348 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze, Andrey Budko
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *      Background level precaching
+ *
+ *  Instead of touching every graphic the level uses before the first
+ *  frame, R_StartBackgroundPrecache orders them by distance from the
+ *  player's sector and returns at once. A worker thread walks the list
+ *  and faults the lump data of memory mapped WADs in. Zone memory and
+ *  the patch caches are not thread safe, so the conversion to rpatch_t
+ *  happens in R_PrecacheTicker on the main thread, a few milliseconds
+ *  per tic, for the items the worker has already warmed.
+ *
+ *---------------------------------------------------------------------
+ */
+
+#include "SDL.h"
+
+#include "doomstat.h"
+#include "w_wad.h"
+#include "r_main.h"
+#include "r_sky.h"
+#include "r_things.h"
+#include "r_patch.h"
+#include "p_tick.h"
+#include "lprintf.h"
+#include "r_precache.h"
+
+#define PRECACHE_TIC_MS 4
+
+int r_precache_background;
+
+typedef enum
+{
+  pc_flat,
+  pc_texture,
+  pc_sprite,
+} precache_type_t;
+
+typedef struct
+{
+  precache_type_t type;
+  int num;
+} precache_item_t;
+
+static precache_item_t *precache_items;
+static int precache_count, precache_alloc;
+static int precache_next;             // next item to convert on the main thread
+static unsigned int precache_starttime;
+
+static SDL_Thread *precache_thread;
+static SDL_atomic_t precache_warmed;  // items the worker is done with
+static SDL_atomic_t precache_cancel;
+
+static byte *flathit, *texturehit, *spritehit;
+
+static void R_AddPrecacheItem(precache_type_t type, int num, byte *hitlist)
+{
+  if (hitlist[num])
+    return;
+  hitlist[num] = 1;
+
+  if (precache_count >= precache_alloc)
+  {
+    precache_alloc = precache_alloc ? precache_alloc * 2 : 1024;
+    precache_items = realloc(precache_items, precache_alloc * sizeof(*precache_items));
+  }
+  precache_items[precache_count].type = type;
+  precache_items[precache_count].num = num;
+  precache_count++;
+}
+
+static void R_AddSectorPrecacheItems(const sector_t *sec)
+{
+  const mobj_t *mo;
+  int i, s;
+
+  R_AddPrecacheItem(pc_flat, sec->floorpic, flathit);
+  R_AddPrecacheItem(pc_flat, sec->ceilingpic, flathit);
+
+  for (i = 0; i < sec->linecount; i++)
+  {
+    const line_t *line = sec->lines[i];
+
+    for (s = 0; s < 2; s++)
+    {
+      const side_t *side;
+
+      if (line->sidenum[s] == NO_INDEX)
+        continue;
+
+      side = &sides[line->sidenum[s]];
+      R_AddPrecacheItem(pc_texture, side->bottomtexture, texturehit);
+      R_AddPrecacheItem(pc_texture, side->toptexture, texturehit);
+      R_AddPrecacheItem(pc_texture, side->midtexture, texturehit);
+    }
+  }
+
+  for (mo = sec->thinglist; mo; mo = mo->snext)
+    R_AddPrecacheItem(pc_sprite, mo->sprite, spritehit);
+}
+
+//
+// R_BuildPrecacheList
+// Same set of graphics as R_PrecacheLevel, in breadth first order over
+// the sectors starting from the one the player is in.
+//
+
+static void R_BuildPrecacheList(void)
+{
+  int *queue;
+  byte *visited;
+  int head = 0, tail = 0;
+  int i;
+  thinker_t *th = NULL;
+
+  precache_count = 0;
+  precache_next = 0;
+
+  {
+    int size = numflats > numsprites  ? numflats : numsprites;
+    size = numtextures > size ? numtextures : size;
+    flathit = calloc(size, 1);
+    texturehit = calloc(size, 1);
+    spritehit = calloc(size, 1);
+  }
+
+  queue = malloc(numsectors * sizeof(*queue));
+  visited = calloc(numsectors, 1);
+
+  // the sky is visible from almost anywhere
+  R_AddPrecacheItem(pc_texture, skytexture, texturehit);
+
+  for (i = -1; i < numsectors; i++)
+  {
+    int start;
+
+    if (i == -1)
+    {
+      mobj_t *mo = players[displayplayer].mo;
+      if (!mo || !mo->subsector)
+        continue;
+      start = mo->subsector->sector->iSectorID;
+    }
+    else
+      start = i;
+
+    if (visited[start])
+      continue;
+
+    visited[start] = 1;
+    queue[tail++] = start;
+
+    while (head < tail)
+    {
+      const sector_t *sec = &sectors[queue[head++]];
+      int j;
+
+      R_AddSectorPrecacheItems(sec);
+
+      for (j = 0; j < sec->linecount; j++)
+      {
+        const line_t *line = sec->lines[j];
+        const sector_t *other = line->frontsector == sec ? line->backsector : line->frontsector;
+
+        if (other && !visited[other->iSectorID])
+        {
+          visited[other->iSectorID] = 1;
+          queue[tail++] = other->iSectorID;
+        }
+      }
+    }
+  }
+
+  // things that are not linked into a sector
+  while ((th = P_NextThinker(th, th_all)) != NULL)
+    if (th->function == P_MobjThinker)
+      R_AddPrecacheItem(pc_sprite, ((mobj_t *)th)->sprite, spritehit);
+
+  free(queue);
+  free(visited);
+  free(flathit);
+  free(texturehit);
+  free(spritehit);
+}
+
+static void R_WarmLump(int lump)
+{
+  static volatile byte sink;
+  const byte *data = W_MappedLumpNum(lump);
+  int len, i;
+
+  if (!data)
+    return;
+
+  len = W_LumpLength(lump);
+  for (i = 0; i < len; i += 4096)
+    sink += data[i];
+}
+
+static void R_WarmPrecacheItem(const precache_item_t *item)
+{
+  int j, k;
+
+  switch (item->type)
+  {
+  case pc_flat:
+    R_WarmLump(firstflat + item->num);
+    break;
+  case pc_texture:
+    for (j = 0; j < textures[item->num]->patchcount; j++)
+      R_WarmLump(textures[item->num]->patches[j].patch);
+    break;
+  case pc_sprite:
+    for (j = 0; j < sprites[item->num].numframes; j++)
+      for (k = 0; k < 8; k++)
+        R_WarmLump(firstspritelump + sprites[item->num].spriteframes[j].lump[k]);
+    break;
+  }
+}
+
+static void R_DecodePrecacheItem(const precache_item_t *item)
+{
+  int j, k;
+
+  switch (item->type)
+  {
+  case pc_flat:
+    W_CacheLumpNum(firstflat + item->num);
+    W_UnlockLumpNum(firstflat + item->num);
+    break;
+  case pc_texture:
+    R_CacheTextureCompositePatchNum(item->num);
+    R_UnlockTextureCompositePatchNum(item->num);
+    break;
+  case pc_sprite:
+    for (j = 0; j < sprites[item->num].numframes; j++)
+      for (k = 0; k < 8; k++)
+      {
+        int lump = firstspritelump + sprites[item->num].spriteframes[j].lump[k];
+        R_CachePatchNum(lump);
+        R_UnlockPatchNum(lump);
+      }
+    break;
+  }
+}
+
+static int R_PrecacheThread(void *unused)
+{
+  int i;
+
+  for (i = 0; i < precache_count && !SDL_AtomicGet(&precache_cancel); i++)
+  {
+    R_WarmPrecacheItem(&precache_items[i]);
+    SDL_AtomicSet(&precache_warmed, i + 1);
+  }
+  return 0;
+}
+
+void R_StopBackgroundPrecache(void)
+{
+  if (precache_thread)
+  {
+    SDL_AtomicSet(&precache_cancel, 1);
+    SDL_WaitThread(precache_thread, NULL);
+    precache_thread = NULL;
+  }
+  precache_count = 0;
+  precache_next = 0;
+}
+
+void R_StartBackgroundPrecache(void)
+{
+  static dboolean atexit_set;
+
+  if (!atexit_set)
+  {
+    atexit(R_StopBackgroundPrecache);
+    atexit_set = true;
+  }
+
+  R_StopBackgroundPrecache();
+
+  precache_starttime = SDL_GetTicks();
+  R_BuildPrecacheList();
+
+  SDL_AtomicSet(&precache_warmed, 0);
+  SDL_AtomicSet(&precache_cancel, 0);
+  precache_thread = SDL_CreateThread(R_PrecacheThread, "precache_thread", NULL);
+  if (!precache_thread)
+  {
+    // convert everything on the main thread, still spread over tics
+    SDL_AtomicSet(&precache_warmed, precache_count);
+  }
+}
+
+//
+// R_PrecacheTicker
+// Hands the warmed items over at tic boundaries
+//
+
+void R_PrecacheTicker(void)
+{
+  unsigned int start;
+  int warmed;
+
+  if (precache_next >= precache_count)
+    return;
+
+  start = SDL_GetTicks();
+  warmed = SDL_AtomicGet(&precache_warmed);
+
+  while (precache_next < warmed && SDL_GetTicks() - start < PRECACHE_TIC_MS)
+    R_DecodePrecacheItem(&precache_items[precache_next++]);
+
+  if (precache_next >= precache_count)
+  {
+    lprintf(LO_DEBUG, "R_PrecacheTicker: %d items done in %u ms\n",
+            precache_count, SDL_GetTicks() - precache_starttime);
+    R_StopBackgroundPrecache();
+  }
+}
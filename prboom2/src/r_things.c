@@ -390,6 +390,16 @@ static void R_InitSpriteDefs(const char * const * namelist)
 static vissprite_t *vissprites, **vissprite_ptrs;  // killough
 static int num_vissprite, num_vissprite_alloc, num_vissprite_ptrs;
 
+// Scratch space for R_RadixSortVisSprites, two halves of
+// num_vissprite_alloc items each. Grown together with vissprites.
+typedef struct vissprite_sortitem_s
+{
+  unsigned int key;
+  vissprite_t *spr;
+} vissprite_sortitem_t;
+
+static vissprite_sortitem_t *vissprite_sortbuf;
+
 //
 // R_InitSprites
 // Called at program start.
@@ -429,6 +439,9 @@ static vissprite_t *R_NewVisSprite(void)
       //e6y: set all fields to zero
       memset(vissprites + num_vissprite_alloc_prev, 0,
         (num_vissprite_alloc - num_vissprite_alloc_prev)*sizeof(*vissprites));
+
+      free(vissprite_sortbuf);  // contents are per-frame, no preserving needed
+      vissprite_sortbuf = malloc(num_vissprite_alloc*2*sizeof(*vissprite_sortbuf));
     }
  return vissprites + num_vissprite++;
 }
@@ -504,95 +517,127 @@ static void R_SetSpritelights(int lightlevel)
 
 
 //
-// R_DrawVisSprite
-//  mfloorclip and mceilingclip should also be set.
+// R_SetupVisSpriteColumnVars
+// Picks the column drawer and translation for a vissprite.
+// Everything set here depends only on the colormap and the mobj flags,
+// so sprites sharing both can reuse the result.
 //
-// CPhipps - new wad lump handling, *'s to const*'s
-static void R_DrawVisSprite(vissprite_t *vis)
+
+static R_DrawColumn_f R_SetupVisSpriteColumnVars(const vissprite_t *vis,
+                                                 draw_column_vars_t *dcvars,
+                                                 enum draw_filter_type_e *filter)
 {
-  int      texturecolumn;
-  fixed_t  frac;
-  const rpatch_t *patch = R_CachePatchNum(vis->patch+firstspritelump);
   R_DrawColumn_f colfunc;
-  draw_column_vars_t dcvars;
-  enum draw_filter_type_e filter;
   enum draw_filter_type_e filterz;
 
-  R_SetDefaultDrawColumnVars(&dcvars);
+  R_SetDefaultDrawColumnVars(dcvars);
   if (vis->mobjflags & MF_PLAYERSPRITE) {
-    dcvars.edgetype = drawvars.patch_edges;
-    filter = drawvars.filterpatch;
+    dcvars->edgetype = drawvars.patch_edges;
+    *filter = drawvars.filterpatch;
     filterz = RDRAW_FILTER_POINT;
   } else {
-    dcvars.edgetype = drawvars.sprite_edges;
-    filter = drawvars.filtersprite;
+    dcvars->edgetype = drawvars.sprite_edges;
+    *filter = drawvars.filtersprite;
     filterz = drawvars.filterz;
   }
 
-  dcvars.colormap = vis->colormap;
-  dcvars.nextcolormap = dcvars.colormap; // for filtering -- POPE
+  dcvars->colormap = vis->colormap;
+  dcvars->nextcolormap = dcvars->colormap; // for filtering -- POPE
 
   // killough 4/11/98: rearrange and handle translucent sprites
   // mixed with translucent/non-translucenct 2s normals
 
-  if (!dcvars.colormap)   // NULL colormap = shadow draw
-    colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_FUZZ, filter, filterz);    // killough 3/14/98
+  if (!dcvars->colormap)   // NULL colormap = shadow draw
+    colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_FUZZ, *filter, filterz);    // killough 3/14/98
   else
     // [FG] colored blood and gibs
     if (vis->mobjflags & MF_COLOREDBLOOD)
       {
-        colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_TRANSLATED, filter, filterz);
-        dcvars.translation = (vis->mobjflags & MF_TRANSLATION1) ?
-                             colrngs[CR_BLUE2] : colrngs[CR_GREEN];
+        colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_TRANSLATED, *filter, filterz);
+        dcvars->translation = (vis->mobjflags & MF_TRANSLATION1) ?
+                              colrngs[CR_BLUE2] : colrngs[CR_GREEN];
       }
   else
     if (vis->mobjflags & MF_TRANSLATION)
       {
-        colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_TRANSLATED, filter, filterz);
-        dcvars.translation = translationtables - 256 +
+        colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_TRANSLATED, *filter, filterz);
+        dcvars->translation = translationtables - 256 +
           ((vis->mobjflags & MF_TRANSLATION) >> (MF_TRANSSHIFT-8) );
       }
     else
       if (vis->mobjflags & MF_TRANSLUCENT && general_translucency) // phares
         {
-          colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_TRANSLUCENT, filter, filterz);
+          colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_TRANSLUCENT, *filter, filterz);
           tranmap = main_tranmap;       // killough 4/11/98
         }
       else
-        colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_STANDARD, filter, filterz); // killough 3/14/98, 4/11/98
+        colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_STANDARD, *filter, filterz); // killough 3/14/98, 4/11/98
+
+  return colfunc;
+}
+
+//
+// R_DrawVisSpriteColumns
+//  mfloorclip and mceilingclip should also be set.
+//
+
+static void R_DrawVisSpriteColumns(const vissprite_t *vis,
+                                   const rpatch_t *patch,
+                                   R_DrawColumn_f colfunc,
+                                   draw_column_vars_t *dcvars,
+                                   enum draw_filter_type_e filter)
+{
+  int      texturecolumn;
+  fixed_t  frac;
 
 // proff 11/06/98: Changed for high-res
-  dcvars.iscale = FixedDiv (FRACUNIT, vis->scale);
-  dcvars.texturemid = vis->texturemid;
+  dcvars->iscale = FixedDiv (FRACUNIT, vis->scale);
+  dcvars->texturemid = vis->texturemid;
   frac = vis->startfrac;
   if (filter == RDRAW_FILTER_LINEAR)
     frac -= (FRACUNIT>>1);
   spryscale = vis->scale;
-  sprtopscreen = centeryfrac - FixedMul(dcvars.texturemid,spryscale);
+  sprtopscreen = centeryfrac - FixedMul(dcvars->texturemid,spryscale);
 
   // check to see if weapon is a vissprite
   if(vis->mobjflags & MF_PLAYERSPRITE)
   {
     // [FG] fix garbage lines at the top of weapon sprites
-    dcvars.iscale = pspriteiyscale;
-    dcvars.texturemid += FixedMul(((centery - viewheight/2)<<FRACBITS), dcvars.iscale);
+    dcvars->iscale = pspriteiyscale;
+    dcvars->texturemid += FixedMul(((centery - viewheight/2)<<FRACBITS), dcvars->iscale);
     sprtopscreen += (viewheight/2 - centery)<<FRACBITS;
   }
 
-  for (dcvars.x=vis->x1 ; dcvars.x<=vis->x2 ; dcvars.x++, frac += vis->xiscale)
+  for (dcvars->x=vis->x1 ; dcvars->x<=vis->x2 ; dcvars->x++, frac += vis->xiscale)
     {
       texturecolumn = frac>>FRACBITS;
-      dcvars.texu = frac;
+      dcvars->texu = frac;
 
       R_DrawMaskedColumn(
         patch,
         colfunc,
-        &dcvars,
+        dcvars,
         R_GetPatchColumnClamped(patch, texturecolumn),
         R_GetPatchColumnClamped(patch, texturecolumn-1),
         R_GetPatchColumnClamped(patch, texturecolumn+1)
       );
     }
+}
+
+//
+// R_DrawVisSprite
+//  mfloorclip and mceilingclip should also be set.
+//
+// CPhipps - new wad lump handling, *'s to const*'s
+static void R_DrawVisSprite(vissprite_t *vis)
+{
+  const rpatch_t *patch = R_CachePatchNum(vis->patch+firstspritelump);
+  R_DrawColumn_f colfunc;
+  draw_column_vars_t dcvars;
+  enum draw_filter_type_e filter;
+
+  colfunc = R_SetupVisSpriteColumnVars(vis, &dcvars, &filter);
+  R_DrawVisSpriteColumns(vis, patch, colfunc, &dcvars, filter);
   R_UnlockPatchNum(vis->patch+firstspritelump); // cph - release lump
 }
 
@@ -1202,6 +1247,87 @@ static void msort(vissprite_t **s, vissprite_t **t, int n)
     }
 }
 
+//
+// R_RadixSortVisSprites
+//
+// LSD radix sort for scenes with many sprites. msort is not stable:
+// its insertion sort keeps equal scales in input order, but every merge
+// puts equal scales from the second half in front of those from the
+// first. So the tie order it produces is "later insertion sort leaf
+// first, input order inside a leaf". Feeding the leaves to a stable
+// sort in reverse order reproduces that exactly, which keeps the
+// sprites_doom_order tie-breaking and the output pixel-identical.
+//
+
+#define RADIX_SORT_MIN_VISSPRITES 128
+
+static vissprite_sortitem_t *R_EmitSortLeaves(vissprite_t **s, int n,
+                                              vissprite_sortitem_t *d)
+{
+  if (n >= 16)
+    {
+      int n1 = n/2;
+
+      d = R_EmitSortLeaves(s + n1, n - n1, d);
+      return R_EmitSortLeaves(s, n1, d);
+    }
+
+  for (; n > 0; n--, s++, d++)
+    {
+      // biased and inverted, so ascending keys give descending scales
+      d->key = ~((unsigned int)(*s)->scale ^ 0x80000000u);
+      d->spr = *s;
+    }
+  return d;
+}
+
+static void R_RadixSortVisSprites(vissprite_t **s, int n)
+{
+  unsigned int count[4][256];
+  vissprite_sortitem_t *src = vissprite_sortbuf;
+  vissprite_sortitem_t *dst = vissprite_sortbuf + n;
+  int i, pass;
+
+  R_EmitSortLeaves(s, n, src);
+
+  memset(count, 0, sizeof(count));
+  for (i = 0; i < n; i++)
+    {
+      unsigned int key = src[i].key;
+      count[0][key & 0xff]++;
+      count[1][(key >> 8) & 0xff]++;
+      count[2][(key >> 16) & 0xff]++;
+      count[3][key >> 24]++;
+    }
+
+  for (pass = 0; pass < 4; pass++)
+    {
+      unsigned int *c = count[pass];
+      int shift = pass * 8;
+      unsigned int offset = 0;
+      vissprite_sortitem_t *tmp;
+
+      // all keys share this digit, the pass would not move anything
+      if (c[(src[0].key >> shift) & 0xff] == (unsigned int)n)
+        continue;
+
+      for (i = 0; i < 256; i++)
+        {
+          unsigned int num = c[i];
+          c[i] = offset;
+          offset += num;
+        }
+
+      for (i = 0; i < n; i++)
+        dst[c[(src[i].key >> shift) & 0xff]++] = src[i];
+
+      tmp = src; src = dst; dst = tmp;
+    }
+
+  for (i = 0; i < n; i++)
+    s[i] = src[i].spr;
+}
+
 void R_SortVisSprites (void)
 {
   if (num_vissprite)
@@ -1233,88 +1359,76 @@ void R_SortVisSprites (void)
       // killough 9/22/98: replace qsort with merge sort, since the keys
       // are roughly in order to begin with, due to BSP rendering.
 
-      msort(vissprite_ptrs, vissprite_ptrs + num_vissprite, num_vissprite);
+      if (num_vissprite < RADIX_SORT_MIN_VISSPRITES)
+        msort(vissprite_ptrs, vissprite_ptrs + num_vissprite, num_vissprite);
+      else
+        R_RadixSortVisSprites(vissprite_ptrs, num_vissprite);
     }
 }
 
 //
-// R_DrawSprite
+// R_ClipSpriteAgainstDrawSeg
+// Clips one sprite against one drawseg overlapping it, rendering the
+// masked mid texture first if the seg is behind the sprite.
 //
 
-static void R_DrawSprite (vissprite_t* spr)
+static void R_ClipSpriteAgainstDrawSeg(vissprite_t *spr, drawseg_t *ds)
 {
-  drawseg_t *ds;
   int     x;
   int     r1;
   int     r2;
   fixed_t scale;
   fixed_t lowscale;
 
-  for (x = spr->x1 ; x<=spr->x2 ; x++)
-    clipbot[x] = -2;
-  for (x = spr->x1 ; x<=spr->x2 ; x++)
-    cliptop[x] = -2;
-
-  // Scan drawsegs from end to start for obscuring segs.
-  // The first drawseg that has a greater scale is the clip seg.
-
-  // Modified by Lee Killough:
-  // (pointer check was originally nonportable
-  // and buggy, by going past LEFT end of array):
+  if (ds->scale1 > ds->scale2)
+  {
+    lowscale = ds->scale2;
+    scale = ds->scale1;
+  }
+  else
+  {
+    lowscale = ds->scale1;
+    scale = ds->scale2;
+  }
 
-  // e6y: optimization
-  if (drawsegs_xrange_size)
+  if (scale < spr->scale || (lowscale < spr->scale &&
+    !R_PointOnSegSide (spr->gx, spr->gy, ds->curline)))
   {
-    const drawseg_xrange_item_t *last = &drawsegs_xrange[drawsegs_xrange_count - 1];
-    drawseg_xrange_item_t *curr = &drawsegs_xrange[-1];
-    while (++curr <= last)
+    if (ds->maskedtexturecol)       // masked mid texture?
     {
-      // determine if the drawseg obscures the sprite
-      if (curr->x1 > spr->x2 || curr->x2 < spr->x1)
-        continue;      // does not cover sprite
+      r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
+      r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
+      R_RenderMaskedSegRange(ds, r1, r2);
+    }
+    return;                 // seg is behind sprite
+  }
 
-      ds = curr->user;
+  r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
+  r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
 
-      if (ds->scale1 > ds->scale2)
-      {
-        lowscale = ds->scale2;
-        scale = ds->scale1;
-      }
-      else
-      {
-        lowscale = ds->scale1;
-        scale = ds->scale2;
-      }
-
-      if (scale < spr->scale || (lowscale < spr->scale &&
-        !R_PointOnSegSide (spr->gx, spr->gy, ds->curline)))
-      {
-        if (ds->maskedtexturecol)       // masked mid texture?
-        {
-          r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-          r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
-          R_RenderMaskedSegRange(ds, r1, r2);
-        }
-        continue;               // seg is behind sprite
-      }
+  // clip this piece of the sprite
+  // killough 3/27/98: optimized and made much shorter
 
-      r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-      r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
+  if (ds->silhouette&SIL_BOTTOM && spr->gz < ds->bsilheight) //bottom sil
+    for (x=r1 ; x<=r2 ; x++)
+      if (clipbot[x] == -2)
+        clipbot[x] = ds->sprbottomclip[x];
 
-      // clip this piece of the sprite
-      // killough 3/27/98: optimized and made much shorter
+  if (ds->silhouette&SIL_TOP && spr->gzt > ds->tsilheight)   // top sil
+    for (x=r1 ; x<=r2 ; x++)
+      if (cliptop[x] == -2)
+        cliptop[x] = ds->sprtopclip[x];
+}
 
-      if (ds->silhouette&SIL_BOTTOM && spr->gz < ds->bsilheight) //bottom sil
-        for (x=r1 ; x<=r2 ; x++)
-          if (clipbot[x] == -2)
-            clipbot[x] = ds->sprbottomclip[x];
+//
+// R_FinishSpriteClip
+// Applies the deep water / fake ceiling clipping and fills in the
+// columns no drawseg has clipped.
+//
 
-      if (ds->silhouette&SIL_TOP && spr->gzt > ds->tsilheight)   // top sil
-        for (x=r1 ; x<=r2 ; x++)
-          if (cliptop[x] == -2)
-            cliptop[x] = ds->sprtopclip[x];
-    }
-  }
+static void R_FinishSpriteClip(vissprite_t *spr)
+{
+  int x;
 
   // killough 3/27/98:
   // Clip the sprite against deep water and/or fake ceilings.
@@ -1369,12 +1483,197 @@ static void R_DrawSprite (vissprite_t* spr)
   for (x = spr->x1 ; x<=spr->x2 ; x++)
     if (cliptop[x] == -2)
       cliptop[x] = -1;
+}
+
+//
+// R_DrawSprite
+//
+
+static void R_DrawSprite (vissprite_t* spr)
+{
+  int     x;
+
+  for (x = spr->x1 ; x<=spr->x2 ; x++)
+    clipbot[x] = -2;
+  for (x = spr->x1 ; x<=spr->x2 ; x++)
+    cliptop[x] = -2;
+
+  // Scan drawsegs from end to start for obscuring segs.
+  // The first drawseg that has a greater scale is the clip seg.
+
+  // Modified by Lee Killough:
+  // (pointer check was originally nonportable
+  // and buggy, by going past LEFT end of array):
+
+  // e6y: optimization
+  if (drawsegs_xrange_size)
+  {
+    const drawseg_xrange_item_t *last = &drawsegs_xrange[drawsegs_xrange_count - 1];
+    drawseg_xrange_item_t *curr = &drawsegs_xrange[-1];
+    while (++curr <= last)
+    {
+      // determine if the drawseg obscures the sprite
+      if (curr->x1 > spr->x2 || curr->x2 < spr->x1)
+        continue;      // does not cover sprite
+
+      R_ClipSpriteAgainstDrawSeg(spr, curr->user);
+    }
+  }
+
+  R_FinishSpriteClip(spr);
 
   mfloorclip = clipbot;
   mceilingclip = cliptop;
   R_DrawVisSprite (spr);
 }
 
+//
+// Sprite batching
+//
+// Runs of consecutive vissprites (in drawing order) that use the same
+// patch, colormap and translation flags and do not overlap horizontally
+// are clipped with a single pass over the drawsegs and drawn with one
+// patch lookup and one column drawer setup. Because the members cover
+// disjoint screen columns, the result is the same as drawing them one
+// by one. Shadow (fuzz) sprites are never batched, since the fuzz
+// pattern depends on the exact order columns are flushed in.
+//
+
+int r_sprite_batching;
+
+#define MAX_SPRITE_BATCH 64
+#define SPRITE_BATCH_FLAGS (MF_COLOREDBLOOD | MF_TRANSLATION | MF_TRANSLUCENT)
+
+static vissprite_t *sprite_batch[MAX_SPRITE_BATCH];
+
+static void R_SelectDrawsegXRange(int x1, int x2)
+{
+  int cx = SCREENWIDTH / 2;
+
+  if (x2 < cx)
+  {
+    drawsegs_xrange = drawsegs_xranges[1].items;
+    drawsegs_xrange_count = drawsegs_xranges[1].count;
+  }
+  else if (x1 >= cx)
+  {
+    drawsegs_xrange = drawsegs_xranges[2].items;
+    drawsegs_xrange_count = drawsegs_xranges[2].count;
+  }
+  else
+  {
+    drawsegs_xrange = drawsegs_xranges[0].items;
+    drawsegs_xrange_count = drawsegs_xranges[0].count;
+  }
+}
+
+//
+// R_CollectSpriteBatch
+// Gathers the run of batchable vissprites ending at vissprite_ptrs[last]
+// (vissprites are drawn from the end of the array) into sprite_batch.
+// Returns the number of sprites collected.
+//
+
+static int R_CollectSpriteBatch(int last)
+{
+  vissprite_t *first = vissprite_ptrs[last];
+  int count = 1;
+  int i, j;
+
+  sprite_batch[0] = first;
+
+  if (!first->colormap)
+    return count;
+
+  for (i = last - 1; i >= 0 && count < MAX_SPRITE_BATCH; i--)
+  {
+    vissprite_t *spr = vissprite_ptrs[i];
+
+    if (spr->patch != first->patch ||
+        spr->colormap != first->colormap ||
+        (spr->mobjflags & SPRITE_BATCH_FLAGS) != (first->mobjflags & SPRITE_BATCH_FLAGS))
+      break;
+
+    for (j = 0; j < count; j++)
+      if (spr->x1 <= sprite_batch[j]->x2 && spr->x2 >= sprite_batch[j]->x1)
+        break;
+
+    if (j < count)
+      break;   // overlaps an earlier member, so order matters
+
+    sprite_batch[count++] = spr;
+  }
+
+  return count;
+}
+
+//
+// R_DrawSpriteBatch
+//
+
+static void R_DrawSpriteBatch(vissprite_t **batch, int count)
+{
+  const rpatch_t *patch;
+  R_DrawColumn_f colfunc;
+  draw_column_vars_t dcvars;
+  enum draw_filter_type_e filter;
+  int bx1 = batch[0]->x1;
+  int bx2 = batch[0]->x2;
+  int i, x;
+
+  for (i = 0; i < count; i++)
+  {
+    vissprite_t *spr = batch[i];
+
+    if (spr->x1 < bx1)
+      bx1 = spr->x1;
+    if (spr->x2 > bx2)
+      bx2 = spr->x2;
+
+    for (x = spr->x1 ; x<=spr->x2 ; x++)
+      clipbot[x] = -2;
+    for (x = spr->x1 ; x<=spr->x2 ; x++)
+      cliptop[x] = -2;
+  }
+
+  R_SelectDrawsegXRange(bx1, bx2);
+
+  // Each member still sees the drawsegs in the same order as
+  // R_DrawSprite would present them
+  if (drawsegs_xrange_size)
+  {
+    const drawseg_xrange_item_t *last = &drawsegs_xrange[drawsegs_xrange_count - 1];
+    drawseg_xrange_item_t *curr = &drawsegs_xrange[-1];
+    while (++curr <= last)
+    {
+      if (curr->x1 > bx2 || curr->x2 < bx1)
+        continue;      // does not cover any sprite of the batch
+
+      for (i = 0; i < count; i++)
+      {
+        vissprite_t *spr = batch[i];
+
+        if (curr->x1 > spr->x2 || curr->x2 < spr->x1)
+          continue;
+
+        R_ClipSpriteAgainstDrawSeg(spr, curr->user);
+      }
+    }
+  }
+
+  for (i = 0; i < count; i++)
+    R_FinishSpriteClip(batch[i]);
+
+  mfloorclip = clipbot;
+  mceilingclip = cliptop;
+
+  patch = R_CachePatchNum(batch[0]->patch+firstspritelump);
+  colfunc = R_SetupVisSpriteColumnVars(batch[0], &dcvars, &filter);
+  for (i = 0; i < count; i++)
+    R_DrawVisSpriteColumns(batch[i], patch, colfunc, &dcvars, filter);
+  R_UnlockPatchNum(batch[0]->patch+firstspritelump);
+}
+
 //
 // R_DrawMasked
 //
@@ -1440,23 +1739,20 @@ void R_DrawMasked(void)
   {
     vissprite_t* spr = vissprite_ptrs[i];
 
-    if (spr->x2 < cx)
-    {
-      drawsegs_xrange = drawsegs_xranges[1].items;
-      drawsegs_xrange_count = drawsegs_xranges[1].count;
-    }
-    else if (spr->x1 >= cx)
-    {
-      drawsegs_xrange = drawsegs_xranges[2].items;
-      drawsegs_xrange_count = drawsegs_xranges[2].count;
-    }
-    else
+    if (r_sprite_batching)
     {
-      drawsegs_xrange = drawsegs_xranges[0].items;
-      drawsegs_xrange_count = drawsegs_xranges[0].count;
+      int count = R_CollectSpriteBatch(i);
+
+      if (count > 1)
+      {
+        R_DrawSpriteBatch(sprite_batch, count);
+        i -= count - 1;
+        continue;
+      }
     }
 
-    R_DrawSprite(vissprite_ptrs[i]);
+    R_SelectDrawsegXRange(spr->x1, spr->x2);
+    R_DrawSprite(spr);
   }
 
   // render any remaining masked mid textures
@@ -73,6 +73,8 @@ typedef enum {
 } sprite_doom_order_t;
 extern int sprites_doom_order;
 
+extern int r_sprite_batching;
+
 extern int health_bar;
 extern int health_bar_full_length;
 extern int health_bar_red;
@@ -141,6 +141,7 @@ static void STlib_drawNum
     return;
 
   x = n->x;
+  V_BeginPatchBatch();
 
   //jff 2/16/98 add color translation to digit output
   // in the special case of 0, you draw 0
@@ -165,6 +166,7 @@ static void STlib_drawNum
   if (neg)
     V_DrawNamePatch(x - w, n->y, FG, "STTMINUS", cm,
        (((cm!=CR_DEFAULT) && !sts_always_red) ? VPT_TRANS : VPT_NONE) | VPT_ALIGN_BOTTOM);
+  V_EndPatchBatch();
 }
 
 /*
@@ -82,6 +82,8 @@ int render_patches_scaley;
 // Each screen is [SCREENWIDTH*SCREENHEIGHT];
 screeninfo_t screens[NUM_SCREENS];
 
+int dirtyrows_top = 0, dirtyrows_bottom = INT_MAX;
+
 /* jff 4/24/98 initialize this at runtime */
 const byte *colrngs[CR_LIMIT];
 
@@ -245,6 +247,8 @@ static void FUNC_V_CopyRect(int srcscrn, int destscrn,
     I_Error ("V_CopyRect: Bad arguments");
 #endif
 
+  V_MarkRows(destscrn, y, y + height - 1);
+
   src = screens[srcscrn].data + screens[srcscrn].byte_pitch * y + x * pixel_depth;
   dest = screens[destscrn].data + screens[destscrn].byte_pitch * y + x * pixel_depth;
 
@@ -293,6 +297,8 @@ static void FUNC_V_FillFlat(int lump, int scrn, int x, int y, int width, int hei
 
   lump += firstflat;
 
+  V_MarkRows(scrn, y, y + height - 1);
+
   // killough 4/17/98:
   data = W_CacheLumpNum(lump);
 
@@ -437,6 +443,8 @@ static void V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
       return;
     }
 
+    V_MarkRows(scrn, y, y + patch->height - 1);
+
     w--; // CPhipps - note: w = width-1 now, speeds up flipping
 
     for (col=0 ; col<=w ; desttop++, col++, x++) {
@@ -674,6 +682,7 @@ static void V_DrawMemPatch(int x, int y, int scrn, const rpatch_t *patch,
         dcvars.dy = params->deltay1;
         dcvars.flags |= DRAW_COLUMN_ISPATCH; 
 
+        V_MarkRows(scrn, dcvars.yl, dcvars.yh);
         colfunc(&dcvars);
       }
     }
@@ -901,6 +910,8 @@ void V_SetPalette(int pal)
 static void V_FillRect8(int scrn, int x, int y, int width, int height, byte colour)
 {
   byte* dest = screens[scrn].data + x + y*screens[scrn].byte_pitch;
+
+  V_MarkRows(scrn, y, y + height - 1);
   while (height--) {
     memset(dest, colour, width);
     dest += screens[scrn].byte_pitch;
@@ -912,6 +923,8 @@ static void V_FillRect15(int scrn, int x, int y, int width, int height, byte col
   unsigned short* dest = (unsigned short *)screens[scrn].data + x + y*screens[scrn].short_pitch;
   int w;
   short c = VID_PAL15(colour, VID_COLORWEIGHTMASK);
+
+  V_MarkRows(scrn, y, y + height - 1);
   while (height--) {
     for (w=0; w<width; w++) {
       dest[w] = c;
@@ -925,6 +938,8 @@ static void V_FillRect16(int scrn, int x, int y, int width, int height, byte col
   unsigned short* dest = (unsigned short *)screens[scrn].data + x + y*screens[scrn].short_pitch;
   int w;
   short c = VID_PAL16(colour, VID_COLORWEIGHTMASK);
+
+  V_MarkRows(scrn, y, y + height - 1);
   while (height--) {
     for (w=0; w<width; w++) {
       dest[w] = c;
@@ -938,6 +953,8 @@ static void V_FillRect32(int scrn, int x, int y, int width, int height, byte col
   unsigned int* dest = (unsigned int *)screens[scrn].data + x + y*screens[scrn].int_pitch;
   int w;
   int c = VID_PAL32(colour, VID_COLORWEIGHTMASK);
+
+  V_MarkRows(scrn, y, y + height - 1);
   while (height--) {
     for (w=0; w<width; w++) {
       dest[w] = c;
@@ -1196,6 +1213,91 @@ void V_FreeScreens(void) {
     V_FreeScreen(&screens[i]);
 }
 
+//
+// V_MarkScreen, V_ClearDirtyRows
+//
+// Dirty row tracking for screens[0]; see V_MarkRows.
+//
+void V_MarkScreen(void)
+{
+  dirtyrows_top = 0;
+  dirtyrows_bottom = INT_MAX;
+}
+
+void V_ClearDirtyRows(void)
+{
+  dirtyrows_top = INT_MAX;
+  dirtyrows_bottom = -1;
+}
+
+//
+// V_ExpandPaletted
+//
+// 8 to 32 bit conversion for the present path. With AVX2 the palette
+// lookups are done eight at a time by a gather; otherwise four loads
+// are issued ahead of the stores.
+//
+
+#if defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define V_EXPAND_AVX2
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static void V_ExpandPalettedAVX2(unsigned int *dest, const byte *src, int count,
+                                 const unsigned int *palette)
+{
+  int x;
+
+  for (x = 0; x + 8 <= count; x += 8)
+  {
+    __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + x)));
+    _mm256_storeu_si256((__m256i *)(dest + x),
+                        _mm256_i32gather_epi32((const int *)palette, idx, 4));
+  }
+  for (; x < count; x++)
+    dest[x] = palette[src[x]];
+}
+#endif
+
+static void V_ExpandPalettedC(unsigned int *dest, const byte *src, int count,
+                              const unsigned int *palette)
+{
+  int x;
+
+  for (x = 0; x + 4 <= count; x += 4)
+  {
+    unsigned int p0 = palette[src[x+0]];
+    unsigned int p1 = palette[src[x+1]];
+    unsigned int p2 = palette[src[x+2]];
+    unsigned int p3 = palette[src[x+3]];
+    dest[x+0] = p0;
+    dest[x+1] = p1;
+    dest[x+2] = p2;
+    dest[x+3] = p3;
+  }
+  for (; x < count; x++)
+    dest[x] = palette[src[x]];
+}
+
+void V_ExpandPaletted(unsigned int *dest, const byte *src, int count,
+                      const unsigned int *palette)
+{
+  static void (*expand)(unsigned int *, const byte *, int, const unsigned int *);
+
+  if (!expand)
+  {
+    expand = V_ExpandPalettedC;
+#ifdef V_EXPAND_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      expand = V_ExpandPalettedAVX2;
+#endif
+  }
+
+  expand(dest, src, count, palette);
+}
+
 static void V_PlotPixel8(int scrn, int x, int y, byte color) {
   screens[scrn].data[x+screens[scrn].byte_pitch*y] = color;
 }
@@ -1253,6 +1355,8 @@ static void WRAP_V_DrawLine(fline_t* fl, int color)
   }
 #endif
 
+  V_MarkRows(0, MIN(fl->a.y, fl->b.y), MAX(fl->a.y, fl->b.y));
+
   dx = fl->b.x - fl->a.x;
   ax = 2 * (dx<0 ? -dx : dx);
   sx = dx<0 ? -1 : 1;
@@ -1404,6 +1508,8 @@ void WRAP_V_DrawLineWu(fline_t *fl, int color)
     return;
   }
 
+  V_MarkRows(0, fl->a.y, fl->b.y);
+
   // draw first pixel
   PUTDOT(fl->a.x, fl->a.y, color);
 
@@ -1806,6 +1912,26 @@ void V_ToggleFullscreen(void)
 #endif
 }
 
+void V_BeginPatchBatch(void)
+{
+#ifdef GL_DOOM
+  if (V_GetMode() == VID_MODEGL)
+  {
+    gld_BeginPatchBatch();
+  }
+#endif
+}
+
+void V_EndPatchBatch(void)
+{
+#ifdef GL_DOOM
+  if (V_GetMode() == VID_MODEGL)
+  {
+    gld_EndPatchBatch();
+  }
+#endif
+}
+
 void V_ChangeScreenResolution(void)
 {
   I_UpdateVideoMode();
@@ -226,6 +226,11 @@ extern V_DrawNumPatchPrecise_f V_DrawNumPatchPrecise;
 #define V_DrawNamePatch(x,y,s,n,t,f) V_DrawNumPatch(x,y,s,W_GetNumForName(n),t,f)
 #define V_DrawNamePatchPrecise(x,y,s,n,t,f) V_DrawNumPatchPrecise(x,y,s,W_GetNumForName(n),t,f)
 
+// Patches drawn in between may be drawn together in OpenGL, so nothing
+// but patches may be drawn in between
+void V_BeginPatchBatch(void);
+void V_EndPatchBatch(void);
+
 /* cph -
  * Functions to return width & height of a patch.
  * Doesn't really belong here, but is often used in conjunction with
@@ -287,6 +292,28 @@ extern V_DrawLineWu_f V_DrawLineWu;
 typedef void (*V_PlotPixelWu_f)(int scrn, int x, int y, byte color, int weight);
 extern V_PlotPixelWu_f V_PlotPixelWu;
 
+// Rows of screens[0] drawn to since the last V_ClearDirtyRows, so that
+// the present path only converts and uploads those. May exceed the screen.
+extern int dirtyrows_top, dirtyrows_bottom;
+
+inline static void V_MarkRows(int scrn, int top, int bottom)
+{
+  if (scrn == 0)
+  {
+    if (top < dirtyrows_top)
+      dirtyrows_top = top;
+    if (bottom > dirtyrows_bottom)
+      dirtyrows_bottom = bottom;
+  }
+}
+
+void V_MarkScreen(void);
+void V_ClearDirtyRows(void);
+
+// Expands count 8-bit pixels through a 32-bit palette
+void V_ExpandPaletted(unsigned int *dest, const byte *src, int count,
+                      const unsigned int *palette);
+
 void V_AllocScreen(screeninfo_t *scrn);
 void V_AllocScreens();
 void V_FreeScreen(screeninfo_t *scrn);
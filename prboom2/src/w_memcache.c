@@ -136,6 +136,15 @@ const void *W_CacheLumpNum(int lump)
   return cachelump[lump].cache;
 }
 
+/* W_MappedLumpNum
+ * Lumps are read into zone memory here, nothing is mapped
+ */
+
+const void *W_MappedLumpNum(int lump)
+{
+  return NULL;
+}
+
 const void *W_LockLumpNum(int lump)
 {
   return W_CacheLumpNum(lump);
@@ -286,6 +286,17 @@ const void* W_CacheLumpNum(int lump)
 }
 #endif
 
+/*
+ * W_MappedLumpNum
+ *
+ * W_CacheLumpNum above only computes an address into the mapping,
+ * so it is safe to call from other threads
+ */
+const void* W_MappedLumpNum(int lump)
+{
+  return W_CacheLumpNum(lump);
+}
+
 /*
  * W_LockLumpNum
  *
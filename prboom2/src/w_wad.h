@@ -155,6 +155,8 @@ void    W_ReadLump (int lump, void *dest);
 const void* W_CacheLumpNum (int lump);
 const void* W_LockLumpNum(int lump);
 void    W_UnlockLumpNum(int lump);
+// Lump data for readers on other threads, NULL unless WADs are memory mapped
+const void* W_MappedLumpNum(int lump);
 
 // CPhipps - convenience macros
 //#define W_CacheLumpNum(num) (W_CacheLumpNum)((num),1)
@@ -115,6 +115,10 @@ static memblock_t *blockbytag[PU_MAX];
 static int memory_size = 0;
 static int free_memory = 0;
 
+// live and high water bytes in blocks handed out, for benchmark reports
+static size_t used_memory = 0;
+static size_t peak_memory = 0;
+
 #ifdef INSTRUMENTED
 
 // statistics for evaluating performance
@@ -265,6 +269,12 @@ void Z_DumpHistory(char *buf)
 
 #endif
 
+// Most bytes that were allocated at once, headers not counted
+size_t Z_PeakMemory(void)
+{
+  return peak_memory;
+}
+
 void Z_Close(void)
 {
 #if 0
@@ -431,6 +441,9 @@ void *(Z_Malloc)(size_t size, int tag, void **user
     active_memory += block->size;
 #endif
   free_memory -= block->size;
+  used_memory += block->size;
+  if (used_memory > peak_memory)
+    peak_memory = used_memory;
 
 #ifdef INSTRUMENTED
   block->file = file;
@@ -500,6 +513,7 @@ void (Z_Free)(void *p
   block->next->prev = block->prev;
 
   free_memory += block->size;
+  used_memory -= block->size;
 #ifdef INSTRUMENTED
   if (block->tag >= PU_PURGELEVEL)
     purgable_memory -= block->size;
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Run a fixed demo suite through -timedemo in several modes and collect
+the -benchjson reports into one JSON document.
+
+Demos are listed in benchmark.csv (IWAD, PWAD, Demo; paths relative to
+the data directory, Demo may be a lump name like DEMO1). Every demo runs
+in every mode, first --warmup times with the results dropped, then
+--repeat times; the summary keeps each run and the median of each
+figure. The OpenGL mode is reported as unavailable if the executable
+was built without it. crusher.wad (a ceiling crushing over 1000
+corpses) is written by crusher.pl.
+
+  benchmark.py --exe ../build/prboom-plus --data ~/doom -o results.json
+"""
+import argparse
+import csv
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+MODES = {
+    'nodraw': ['-nodraw'],
+    'sw8':    ['-vidmode', '8bit', '-width', '640', '-height', '400'],
+    'sw32':   ['-vidmode', '32bit', '-width', '640', '-height', '400'],
+    'gl':     ['-vidmode', 'gl', '-width', '640', '-height', '400'],
+}
+
+FIGURES = ('tics_per_sec', 'frames_per_sec', 'frame_ms_p50',
+           'frame_ms_p99', 'frame_ms_max', 'peak_zone_bytes')
+
+def iterDemoSpecs(specs):
+    with open(specs, newline='') as f:
+        for row in csv.DictReader(f):
+            spec = dict((k, (v or '').strip()) for k, v in row.items())
+            if spec.get('Demo'):
+                yield spec
+
+def runDemo(exe, datadir, spec, mode):
+    """One -timedemo run; returns the parsed report or None."""
+    fd, report = tempfile.mkstemp(suffix='.json')
+    os.close(fd)
+    os.remove(report)
+    options = [
+        exe,
+        '-nosound',
+        '-nomouse',
+        '-nofullscreen',
+        '-window',
+        '-iwad', os.path.join(datadir, spec['IWAD']),
+        '-timedemo', spec['Demo'] if '.' not in spec['Demo']
+                     else os.path.join(datadir, spec['Demo']),
+        '-benchjson', report,
+    ]
+    if spec.get('PWAD'):
+        options.extend(['-file'] + [os.path.join(datadir, x)
+                                    for x in spec['PWAD'].split()])
+    options.extend(MODES[mode])
+    # the run always ends through I_Error, so the exit code says nothing
+    subprocess.call(options, cwd=datadir,
+                    stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        with open(report) as f:
+            return json.load(f)
+    except (IOError, ValueError):
+        return None
+    finally:
+        if os.path.exists(report):
+            os.remove(report)
+
+def benchmark(args, spec, mode):
+    name = '%s %s %s' % (spec['IWAD'], spec.get('PWAD', ''), spec['Demo'])
+    result = {'demo': ' '.join(name.split()), 'mode': mode}
+    runs = []
+    for i in range(args.warmup + args.repeat):
+        report = runDemo(args.exe, args.data, spec, mode)
+        if report is None or (mode == 'gl' and report['mode'] != 'OpenGL'):
+            result['error'] = 'unavailable' if report else 'no report'
+            return result
+        if i >= args.warmup:
+            runs.append(report)
+    result['runs'] = runs
+    result['median'] = dict((k, statistics.median(r[k] for r in runs))
+                            for k in FIGURES)
+    return result
+
+def run():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--exe', required=True, help='prboom-plus executable')
+    parser.add_argument('--data', default='.', help='directory with IWADs, PWADs and demos')
+    parser.add_argument('--specs', default=os.path.join(here, 'benchmark.csv'))
+    parser.add_argument('--modes', default=','.join(sorted(MODES)),
+                        help='comma separated subset of ' + ', '.join(sorted(MODES)))
+    parser.add_argument('--warmup', type=int, default=1)
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('-o', '--output', help='write JSON here instead of stdout')
+    args = parser.parse_args()
+    args.exe = os.path.abspath(args.exe)
+    args.data = os.path.abspath(args.data)
+
+    modes = [m for m in args.modes.split(',') if m]
+    for m in modes:
+        if m not in MODES:
+            parser.error("unknown mode '%s'" % m)
+
+    results = []
+    for spec in iterDemoSpecs(args.specs):
+        for mode in modes:
+            result = benchmark(args, spec, mode)
+            median = result.get('median')
+            print('%-40s %-7s %s' % (result['demo'], mode,
+                  '%.1f tics/s %.1f fps p50 %.2fms p99 %.2fms' %
+                  (median['tics_per_sec'], median['frames_per_sec'],
+                   median['frame_ms_p50'], median['frame_ms_p99'])
+                  if median else result['error']), file=sys.stderr)
+            results.append(result)
+
+    summary = {'warmup': args.warmup, 'repeat': args.repeat, 'results': results}
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(summary, f, indent=2)
+    else:
+        json.dump(summary, sys.stdout, indent=2)
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,232 @@
+/*
+ * checksector.c: differential check and benchmark of P_CheckSector.
+ *
+ * Linked by checksector.sh against two versions of p_map.c, with their
+ * PIT_ChangeSector replaced by the one below. It logs every thing the
+ * scan processes while the callback spawns, removes and moves things and
+ * starts nested scans, as blood, dropped items, gibs and line specials
+ * do in the game, so any change in processing order shows up as a
+ * different log. Sector membership comes from the harness instead of
+ * the blockmap; the list handling is the real p_map.c code.
+ *
+ *   checksector 0       one line per seed: seed, things processed, hash
+ *   checksector N       N things under a crusher for a minute of tics
+ */
+
+#include "config.h"
+#include "doomstat.h"
+#include "p_mobj.h"
+#include "p_map.h"
+#include "r_defs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// the harness manages its own memory
+#undef malloc
+#undef calloc
+#undef free
+#undef realloc
+
+extern msecnode_t *sector_list;
+msecnode_t *P_AddSecnode(sector_t *s, mobj_t *thing, msecnode_t *nextnode);
+
+#define NSEC   6
+#define NSEEDS 20000
+
+static sector_t secs[NSEC];
+static subsector_t subs[NSEC];
+static mobj_t **things;
+static int numthings, maxthings;
+static unsigned rng;
+static mobj_t *linking;
+static int extra[NSEC], numextra;
+static int depth, mutate = 1;
+static unsigned long processed, hash;
+
+static unsigned Random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+// Z_BMalloc/Z_BFree as a LIFO freelist, so freed nodes get reused the
+// way the block allocator reuses them
+typedef union freenode_u { union freenode_u *next; msecnode_t node; } freenode_t;
+static freenode_t *freenodes;
+
+void *Z_BMalloc(struct block_memory_alloc_s *zone)
+{
+  freenode_t *p = freenodes;
+
+  if (!p)
+    return malloc(sizeof(*p));
+  freenodes = p->next;
+  return p;
+}
+
+void Z_BFree(struct block_memory_alloc_s *zone, void *p)
+{
+  ((freenode_t *)p)->next = freenodes;
+  freenodes = p;
+}
+
+// P_CreateSecNodeList asks for the lines around the thing; hand it the
+// sectors the harness picked instead
+dboolean P_BlockLinesIterator(int x, int y, dboolean func(line_t *))
+{
+  int i;
+
+  for (i = 0; i < numextra; i++)
+    sector_list = P_AddSecnode(&secs[extra[i]], linking, sector_list);
+  return true;
+}
+
+int P_GetSafeBlockX(int coord) { return 0; }
+int P_GetSafeBlockY(int coord) { return 0; }
+
+// P_SetThingPosition: sector_list holds the thing's old nodes, if any
+static void Link(mobj_t *mo, int sector)
+{
+  int i;
+
+  mo->subsector = &subs[sector];
+  numextra = Random() % 3;
+  for (i = 0; i < numextra; i++)
+    extra[i] = Random() % NSEC;
+  linking = mo;
+  P_CreateSecNodeList(mo, 0, 0);
+  mo->touching_sectorlist = sector_list;
+  sector_list = NULL;
+}
+
+// P_UnsetThingPosition
+static void Unlink(mobj_t *mo)
+{
+  sector_list = mo->touching_sectorlist;
+  mo->touching_sectorlist = NULL;
+}
+
+static void Spawn(int sector)
+{
+  mobj_t *mo = calloc(1, sizeof(*mo));
+
+  if (numthings == maxthings)
+  {
+    maxthings = maxthings ? maxthings * 2 : 256;
+    things = realloc(things, maxthings * sizeof(*things));
+  }
+  mo->radius = 16 << FRACBITS;
+  mo->flags = (Random() % 16) ? 0 : MF_NOBLOCKMAP;
+  mo->health = numthings;     // the thing's id in the log
+  things[numthings++] = mo;
+  Link(mo, sector);
+}
+
+// P_RemoveMobj; MF_NOSECTOR marks it gone
+static void Remove(mobj_t *mo)
+{
+  Unlink(mo);
+  if (sector_list)
+  {
+    P_DelSeclist(sector_list);
+    sector_list = NULL;
+  }
+  mo->flags |= MF_NOSECTOR;
+}
+
+dboolean PIT_ChangeSector(mobj_t *thing)
+{
+  unsigned r;
+
+  processed++;
+  hash = hash * 33 + thing->health * 7 + depth;
+
+  if (!mutate)
+    return true;
+
+  r = Random() % 100;
+  if (r < 15)                 // blood, a dropped item
+    Spawn(Random() % NSEC);
+  else if (r < 25)            // crushed to nothing
+    Remove(thing);
+  else if (r < 30)            // something else goes away meanwhile
+  {
+    mobj_t *mo = things[Random() % numthings];
+    if (!(mo->flags & MF_NOSECTOR))
+      Remove(mo);
+  }
+  else if (r < 45)            // thrust into another sector
+  {
+    Unlink(thing);
+    Link(thing, Random() % NSEC);
+  }
+  else if (r < 48 && depth < 3) // a death triggers another mover
+  {
+    depth++;
+    P_CheckSector(&secs[Random() % NSEC], true);
+    depth--;
+  }
+  return true;
+}
+
+static void Clear(void)
+{
+  int i;
+
+  for (i = 0; i < numthings; i++)
+  {
+    if (!(things[i]->flags & MF_NOSECTOR))
+      Remove(things[i]);
+    free(things[i]);
+  }
+  numthings = 0;
+}
+
+int main(int argc, char **argv)
+{
+  int mode = argc > 1 ? atoi(argv[1]) : 0;
+  int i, n, seed;
+
+  for (i = 0; i < NSEC; i++)
+    subs[i].sector = &secs[i];
+
+  if (!mode)
+  {
+    for (seed = 1; seed <= NSEEDS; seed++)
+    {
+      rng = seed;
+      processed = 0;
+      hash = 5381;
+      n = 1 + Random() % 40;
+      for (i = 0; i < n; i++)
+        Spawn(Random() % NSEC);
+      for (i = 0; i < 3; i++)
+        P_CheckSector(&secs[Random() % NSEC], true);
+      printf("%d %lu %lu\n", seed, processed, hash);
+      Clear();
+    }
+  }
+  else
+  {
+    int tics = 35 * 60;
+    clock_t start;
+
+    rng = 1;
+    mutate = 0;
+    for (i = 0; i < mode; i++)
+    {
+      Spawn(0);
+      things[i]->flags = 0;
+    }
+    start = clock();
+    for (i = 0; i < tics; i++)
+      P_CheckSector(&secs[0], true);
+    printf("%d things, %d tics: %.1f ms, %lu processed\n", mode, tics,
+           (clock() - start) * 1000.0 / CLOCKS_PER_SEC, processed);
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Runs checksector.c against p_map.c as of REV and as in the working
+# tree: the per-seed logs must be identical, then both are timed with
+# things piled under a crusher. Symbols p_map.c needs but the harness
+# never reaches are defined as dummy data, so calling one crashes.
+#
+#   checksector.sh REV [CFLAGS...]
+#
+# CFLAGS must find config.h (the build directory) and the SDL headers:
+#   checksector.sh 54349b7~1 -I../build $(sdl2-config --cflags)
+
+set -e
+
+if [ $# -lt 1 ]; then
+  echo "usage: $0 REV [CFLAGS...]" >&2
+  exit 2
+fi
+rev=$1; shift
+
+here=$(cd "$(dirname "$0")" && pwd)
+src=$here/../src
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+cflags="-O2 -w -DHAVE_CONFIG_H -I$src $*"
+
+git -C "$here" show "$rev:prboom2/src/p_map.c" > "$tmp/old.c"
+cp "$src/p_map.c" "$tmp/new.c"
+cc $cflags -c "$here/checksector.c" -o "$tmp/harness.o"
+
+for v in old new; do
+  # the harness supplies PIT_ChangeSector
+  sed 's/^dboolean PIT_ChangeSector *(mobj_t\* *thing)$/dboolean PIT_ChangeSector(mobj_t* thing);\
+static dboolean PIT_ChangeSector_unused(mobj_t* thing)/' "$tmp/$v.c" > "$tmp/$v-h.c"
+  cc $cflags -c "$tmp/$v-h.c" -o "$tmp/$v.o"
+done
+
+: > "$tmp/stubs.c"
+for v in old new; do
+  cc "$tmp/harness.o" "$tmp/$v.o" -o "$tmp/$v" 2>&1 |
+    sed -n "s/.*undefined reference to [\`']\([^']*\)'.*/\1/p"
+done | sort -u | while read -r sym; do
+  echo "char $sym[1 << 16] __attribute__((aligned(64)));" >> "$tmp/stubs.c"
+done
+cc -c "$tmp/stubs.c" -o "$tmp/stubs.o"
+for v in old new; do
+  cc "$tmp/harness.o" "$tmp/$v.o" "$tmp/stubs.o" -o "$tmp/$v"
+done
+
+"$tmp/old" 0 > "$tmp/old.log"
+"$tmp/new" 0 > "$tmp/new.log"
+if cmp -s "$tmp/old.log" "$tmp/new.log"; then
+  echo "order: identical over $(wc -l < "$tmp/new.log") seeds," \
+       "$(awk '{ n += $2 } END { print n }' "$tmp/new.log") things processed"
+else
+  echo "order: DIFFERS"
+  diff "$tmp/old.log" "$tmp/new.log" | head
+  exit 1
+fi
+
+for n in 100 1000; do
+  echo "old: $("$tmp/old" $n)"
+  echo "new: $("$tmp/new" $n)"
+done
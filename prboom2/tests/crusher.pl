@@ -0,0 +1,117 @@
+#!/usr/bin/perl
+
+# Writes crusher.wad: MAP01 is one square sector holding 1000 corpses and
+# a few deaf imps, with an S1 crush-and-raise switch on the west wall next
+# to the player start. The DEMO1 lump (MBF format, so the Boom
+# P_CheckSector is used) presses the switch and then stands still, so the
+# whole demo is the ceiling crushing over the pile.
+#
+#   perl crusher.pl
+#   prboom-plus -iwad doom2.wad -file crusher.wad -timedemo DEMO1
+
+use strict;
+use warnings;
+
+my $WAD = "crusher.wad";
+my @LMPS = ("MAP01", "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES",
+	"SEGS", "SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP",
+	"DEMO1");
+my ($W, $H) = (1536, 1408);
+my $CORPSES = 1000;
+my $IMPS = 16;
+my $TICS = 35*120;
+
+my %lmp;
+
+# one sector, tag 1; no nodes needed for a single convex subsector and
+# the engine builds the blockmap itself
+$lmp{"SECTORS"} = pack("S2a8a8S3", 0, 128, "FLOOR4_8", "CEIL3_5", 192, 0, 1);
+$lmp{"REJECT"} = pack("C", 0);
+
+$lmp{"VERTEXES"} = pack("S2"x4,
+	0,  0,
+	0,  $H,
+	$W, $H,
+	$W, 0);
+
+# the west wall is the switch: S1 ceiling crush and raise (49), tag 1
+$lmp{"LINEDEFS"} = pack("S7"x4,
+	0, 1, 1, 49, 1, 0, 65535,
+	1, 2, 1, 0,  0, 1, 65535,
+	2, 3, 1, 0,  0, 2, 65535,
+	3, 0, 1, 0,  0, 3, 65535);
+
+$lmp{"SIDEDEFS"} = pack("S2a8a8a8S"x4,
+	0, 0, "-", "-", "SW1STRTN", 0,
+	0, 0, "-", "-", "STARTAN3", 0,
+	0, 0, "-", "-", "STARTAN3", 0,
+	0, 0, "-", "-", "STARTAN3", 0);
+
+$lmp{"SEGS"} = pack("S6"x4,
+	0, 1, 0x4000, 0, 0, 0,
+	1, 2, 0x0000, 1, 0, 0,
+	2, 3, 0xc000, 2, 0, 0,
+	3, 0, 0x8000, 3, 0, 0);
+
+$lmp{"SSECTORS"} = pack("S2", 4, 0);
+
+# player 1 facing the switch, within use range
+$lmp{"THINGS"} = pack("S5", 40, $H/2, 180, 1, 7);
+for (my $i = 0; $i < $CORPSES; $i++) {
+	# dead former human: not shootable, so it stays in the sector list
+	$lmp{"THINGS"}.=pack("S5", 160 + 32*($i % 40), 96 + 48*int($i / 40),
+		0, 18, 7);
+}
+for (my $i = 0; $i < $IMPS; $i++) {
+	# deaf imps get crushed and spawn blood while the list is scanned
+	$lmp{"THINGS"}.=pack("S5", 256 + 64*$i, $H - 64, 270, 3001, 7|8);
+}
+
+$lmp{"DEMO1"} = demo();
+
+open(F, ">$WAD");
+my $ptr = 12 + 16*scalar @LMPS;
+print F pack("a4L2", "PWAD", scalar @LMPS, 12);
+for (@LMPS) {
+	if (exists $lmp{$_}) {
+		print F pack("L2a8", $ptr, length $lmp{$_}, $_);
+		$ptr += length $lmp{$_};
+	} else {
+		print F pack("L2a8", $ptr, 0, $_);
+	}
+}
+for (@LMPS) { print F $lmp{$_} if exists $lmp{$_}; }
+close F;
+
+# MBF (v2.03) demo header as G_BeginRecording writes it, default options
+# with an all-zero comp vector, then one use press and $TICS idle tics
+sub demo
+{
+	my $options = pack("C10",
+		1,		# monsters_remember
+		1,		# variable_friction
+		0,		# weapon_recoil
+		1,		# allow_pushers
+		0,
+		1,		# player_bobbing
+		0, 0, 0,	# respawn, fast, nomonsters
+		0);		# demo_insurance
+	$options.=pack("N", 1993);	# rngseed
+	$options.=pack("C4n", 1, 0, 0, 0, 128);	# infighting, dogs, distfriend
+	$options.=pack("C6", 0, 1, 1, 0, 1, 0);
+	$options.=pack("C32", (0) x 32);	# comp[]
+	$options.=pack("C", 0);		# forceOldBsp
+	$options.=pack("C", 0) x (64 - length $options);
+
+	my $d = pack("Ca6C6", 203, "\x1dMBF\xe6\0", 0,
+		3, 1, 1, 0, 0);		# skill, episode, map, dm, consoleplayer
+	$d.=$options;
+	$d.=pack("C32", 1, (0) x 31);	# playeringame
+	$d.=pack("c2C2", 0, 0, 0, 0);
+	$d.=pack("c2C2", 0, 0, 0, 2);	# BT_USE
+	$d.=pack("c2C2", 0, 0, 0, 0) x $TICS;
+	$d.=pack("C", 0x80);
+	return $d;
+}
+
+__END__